@@ -0,0 +1,112 @@
+#include "admission_control.h"
+#include <algorithm>
+
+AdmissionControl::AdmissionControl(const AdmissionLimits& limits) : m_limits(limits) {}
+
+void AdmissionControl::setLimits(const AdmissionLimits& limits) {
+    std::lock_guard<std::mutex> lock(mtx);
+    m_limits = limits;
+}
+
+AdmissionLimits AdmissionControl::limits() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_limits;
+}
+
+AdmissionControl::Admission AdmissionControl::admit(const std::string& client, size_t urls, size_t bytes,
+                                                    size_t admittedUrls, size_t admittedBytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    rollWindow(Clock::now());
+    auto over = [](size_t limit, size_t pending, size_t added) {
+        return limit > 0 && pending + added > limit ? pending + added - limit : 0;
+    };
+    const size_t request_urls = admittedUrls + urls;
+    const size_t request_bytes = admittedBytes + bytes;
+    if ((m_limits.max_urls > 0 && request_urls > m_limits.max_urls) ||
+        (m_limits.max_bytes > 0 && request_bytes > m_limits.max_bytes) ||
+        (m_limits.client_max_urls > 0 && request_urls > m_limits.client_max_urls)) {
+        m_stats.rejected_too_large++;
+        return {Decision::TooLarge};
+    }
+    auto client_it = m_client_urls.find(client);
+    const size_t client_pending = client_it == m_client_urls.end() ? 0 : client_it->second;
+    if (size_t excess = over(m_limits.client_max_urls, client_pending, urls); excess > 0) {
+        m_stats.rejected_quota++;
+        return {Decision::QuotaExceeded, retryAfter(excess)};
+    }
+    const size_t excess_urls = over(m_limits.max_urls, m_stats.pending_urls, urls);
+    const size_t excess_bytes = over(m_limits.max_bytes, m_stats.pending_bytes, bytes);
+    if (excess_urls > 0 || excess_bytes > 0) {
+        m_stats.rejected_full++;
+        // Byte overflow is converted to URLs by the average pending length.
+        const size_t average = std::max<size_t>(m_stats.pending_bytes / std::max<size_t>(m_stats.pending_urls, 1), 1);
+        return {Decision::QueueFull, retryAfter(std::max(excess_urls, (excess_bytes + average - 1) / average))};
+    }
+    m_stats.pending_urls += urls;
+    m_stats.pending_bytes += bytes;
+    if (urls > 0) {
+        m_client_urls[client] += urls;
+    }
+    return {Decision::Admitted};
+}
+
+void AdmissionControl::cancel(const std::string& client, size_t urls, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    release(client, urls, bytes);
+}
+
+void AdmissionControl::assign(const int requestId, const std::string& client, size_t urls) {
+    if (urls == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    Request& request = m_requests[requestId];
+    request.client = client;
+    request.remaining += urls;
+}
+
+void AdmissionControl::finished(const Url& url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = m_requests.find(url.request_id);
+    if (it == m_requests.end()) {
+        return;
+    }
+    release(it->second.client, 1, url.url.size());
+    if (--it->second.remaining == 0) {
+        m_requests.erase(it);
+    }
+    rollWindow(Clock::now());
+    m_window_drained++;
+}
+
+AdmissionControl::Stats AdmissionControl::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_stats;
+}
+
+void AdmissionControl::release(const std::string& client, size_t urls, size_t bytes) {
+    m_stats.pending_urls -= std::min(urls, m_stats.pending_urls);
+    m_stats.pending_bytes -= std::min(bytes, m_stats.pending_bytes);
+    if (auto it = m_client_urls.find(client); it != m_client_urls.end()) {
+        it->second -= std::min(urls, it->second);
+        if (it->second == 0) {
+            m_client_urls.erase(it);
+        }
+    }
+}
+
+void AdmissionControl::rollWindow(Clock::time_point now) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_window_start);
+    if (elapsed < std::chrono::seconds(1)) {
+        return;
+    }
+    m_drain_rate = m_window_drained * 1000 / static_cast<size_t>(elapsed.count());
+    m_window_drained = 0;
+    m_window_start = now;
+}
+
+std::chrono::seconds AdmissionControl::retryAfter(size_t excess) const {
+    const size_t rate = std::max<size_t>(m_drain_rate, 1);
+    const auto seconds = static_cast<long long>((excess + rate - 1) / rate);
+    return std::clamp(std::chrono::seconds(seconds), std::chrono::seconds(1), kMaxRetryAfter);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "url.h"
+
+// Bounds on the URLs admitted but not yet checked and stored; 0 - unbounded.
+struct AdmissionLimits {
+    size_t max_urls = 0;
+    // Total length of the pending URLs.
+    size_t max_bytes = 0;
+    // Pending URLs of a single client.
+    size_t client_max_urls = 0;
+};
+
+// Admission control for /check_urls: a request is admitted only if its URLs
+// fit the room left under the limits, and the room comes back as their
+// results are stored. Rejections carry a hint of when to retry, based on how
+// fast the pending URLs have been draining.
+class AdmissionControl {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Decision {
+        Admitted,
+        // The service as a whole is saturated.
+        QueueFull,
+        // The client has too many URLs pending.
+        QuotaExceeded,
+        // The request alone exceeds a limit and will never be admitted.
+        TooLarge,
+    };
+    struct Admission {
+        Decision decision = Decision::Admitted;
+        std::chrono::seconds retry_after{0};
+    };
+    struct Stats {
+        size_t pending_urls = 0;
+        size_t pending_bytes = 0;
+        size_t rejected_full = 0;
+        size_t rejected_quota = 0;
+        size_t rejected_too_large = 0;
+    };
+
+    static constexpr std::chrono::seconds kMaxRetryAfter{60};
+
+    explicit AdmissionControl(const AdmissionLimits& limits = {});
+
+    void setLimits(const AdmissionLimits& limits);
+    [[nodiscard]] AdmissionLimits limits() const;
+
+    // Reserves room for a request of the client with urls URLs of bytes in
+    // total; the reservation must then be assigned or cancelled. A request
+    // admitted in chunks passes the URLs and bytes of the chunks admitted
+    // before, so that it is TooLarge by the same measure as a whole one.
+    Admission admit(const std::string& client, size_t urls, size_t bytes, size_t admittedUrls = 0,
+                    size_t admittedBytes = 0);
+    // Gives back a reservation that did not become a request.
+    void cancel(const std::string& client, size_t urls, size_t bytes);
+    // Ties the URLs reserved for the client to the request, so that each of
+    // them is released when its result is stored. Must precede the checks;
+    // a request fed in chunks is assigned each of them.
+    void assign(const int requestId, const std::string& client, size_t urls);
+    // Releases one URL of the request; URLs of requests that were never
+    // admitted (scheduled checks) are ignored.
+    void finished(const Url& url);
+
+    [[nodiscard]] Stats stats() const;
+
+   private:
+    struct Request {
+        std::string client;
+        size_t remaining = 0;
+    };
+
+    void release(const std::string& client, size_t urls, size_t bytes);
+    // Starts a new one-second window of the drain rate once the current one
+    // is over; mtx must be held.
+    void rollWindow(Clock::time_point now);
+    std::chrono::seconds retryAfter(size_t excess) const;
+
+    AdmissionLimits m_limits;
+    mutable std::mutex mtx;
+    Stats m_stats;
+    std::unordered_map<std::string, size_t> m_client_urls;
+    std::unordered_map<int, Request> m_requests;
+    Clock::time_point m_window_start = Clock::now();
+    size_t m_window_drained = 0;
+    // URLs released per second over the last complete window.
+    size_t m_drain_rate = 0;
+};
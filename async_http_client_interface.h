@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "url.h"
+
+class AsyncHttpClientInterface {
+   public:
+    // timings.total_us is the request time; a check that could not start
+    // reports zero timings.
+    using Callback = std::function<void(size_t httpStatus, const PhaseTimings& timings)>;
+
+    virtual ~AsyncHttpClientInterface() = default;
+
+    // Starts a check and returns immediately. The callback is invoked exactly
+    // once, from the client's own thread, when the check completes or fails.
+    virtual void check(const std::string& url, size_t timeout, Callback callback) = 0;
+};
@@ -0,0 +1,213 @@
+#include "batch_writer.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include "metrics.h"
+
+BatchWriter::BatchWriter(const std::shared_ptr<DatabaseInterface>& database,
+                         size_t batchSize, std::chrono::milliseconds maxLatency, size_t maxPending)
+    : db(database),
+      batch_size(std::max<size_t>(batchSize, 1)),
+      max_latency(maxLatency),
+      // A full queue is always a due batch, so the writer never waits out
+      // the latency while inserts wait for room.
+      max_pending(maxPending == 0 ? 0 : std::max(maxPending, batch_size)) {
+    thread = std::thread(&BatchWriter::writer, this);
+}
+
+BatchWriter::~BatchWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        m_stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+[[nodiscard]] size_t BatchWriter::getRequestId(const std::string& content) const {
+    return db->getRequestId(content);
+}
+
+bool BatchWriter::setRequestContent(const int requestId, const std::string& content, bool deflated) {
+    return db->setRequestContent(requestId, content, deflated);
+}
+
+bool BatchWriter::removeRequest(const int requestId) {
+    return db->removeRequest(requestId);
+}
+
+bool BatchWriter::insert(const Url& url) {
+    return insert(std::vector<Url>{url});
+}
+
+// Rows more than the bound go in at once when the queue is empty.
+bool BatchWriter::insert(const std::vector<Url>& urls) {
+    bool isDue = false;
+    {
+        std::unique_lock lock(mtx);
+        if (max_pending > 0) {
+            cv_room.wait(lock, [this, &urls] {
+                return m_pending.empty() || m_pending.size() + urls.size() <= max_pending;
+            });
+        }
+        if (!urls.empty()) {
+            m_arrivals.emplace_back(m_enqueued, std::chrono::steady_clock::now());
+        }
+        for (const auto& url : urls) {
+            m_pending.push_back(url);
+            m_last_row[url.request_id] = ++m_enqueued;
+        }
+        isDue = m_pending.size() >= batch_size;
+    }
+    if (isDue) {
+        cv.notify_one();
+    }
+    return true;
+}
+
+std::vector<Url> BatchWriter::find(const int requestId) {
+    flush(requestId);
+    return db->find(requestId);
+}
+
+std::vector<Url> BatchWriter::find(const int requestId, long long afterId, size_t limit,
+                                   const ResultFilter& filter) {
+    flush(requestId);
+    return db->find(requestId, afterId, limit, filter);
+}
+
+bool BatchWriter::requestIdExists(const int requestId) {
+    return db->requestIdExists(requestId);
+}
+
+int BatchWriter::lastRequestId() {
+    return db->lastRequestId();
+}
+
+std::optional<ResultTotals> BatchWriter::totals(long long sinceMillis) {
+    return db->totals(sinceMillis);
+}
+
+void BatchWriter::flush() {
+    std::unique_lock lock(mtx);
+    flushUntil(m_enqueued, lock);
+}
+
+void BatchWriter::flush(const int requestId) {
+    std::unique_lock lock(mtx);
+    if (auto it = m_last_row.find(requestId); it != m_last_row.end()) {
+        flushUntil(it->second, lock);
+    }
+}
+
+void BatchWriter::onDone(DoneListener listener) {
+    done_listener = std::move(listener);
+}
+
+void BatchWriter::flushUntil(size_t target, std::unique_lock<std::mutex>& lock) {
+    if (m_done >= target) {
+        return;
+    }
+    m_flush_until = std::max(m_flush_until, target);
+    cv.notify_one();
+    cv_committed.wait(lock, [this, target] { return m_done >= target; });
+}
+
+[[nodiscard]] size_t BatchWriter::commitCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_commits;
+}
+
+[[nodiscard]] size_t BatchWriter::rowCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_committed;
+}
+
+[[nodiscard]] size_t BatchWriter::lastCommitRows() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_last_commit_rows;
+}
+
+[[nodiscard]] size_t BatchWriter::failedRowCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_failed;
+}
+
+bool BatchWriter::commit(const std::vector<Url>& batch) {
+    for (int attempt = 1; attempt <= kInsertAttempts; attempt++) {
+        if (db->insert(batch)) {
+            return true;
+        }
+        if (attempt < kInsertAttempts) {
+            std::this_thread::sleep_for(kRetryDelay * attempt);
+        }
+    }
+    return false;
+}
+
+void BatchWriter::writer() {
+    std::unique_lock lock(mtx);
+    while (true) {
+        if (m_pending.empty()) {
+            if (m_stop) {
+                break;
+            }
+            cv.wait(lock, [this] { return !m_pending.empty() || m_stop; });
+            continue;
+        }
+        const auto deadline = m_arrivals.front().second + max_latency;
+        if (m_pending.size() < batch_size && !m_stop && m_flush_until <= m_done &&
+            std::chrono::steady_clock::now() < deadline) {
+            cv.wait_until(lock, deadline);
+            continue;
+        }
+
+        const size_t count = std::min(batch_size, m_pending.size());
+        std::vector<Url> batch(std::make_move_iterator(m_pending.begin()),
+                               std::make_move_iterator(m_pending.begin() + count));
+        m_pending.erase(m_pending.begin(), m_pending.begin() + count);
+        // Rows left over from a taken insert keep its time; later inserts
+        // date from their own, not from the batch just taken.
+        const size_t taken = m_enqueued - m_pending.size();
+        while (m_arrivals.size() > 1 && m_arrivals[1].first <= taken) {
+            m_arrivals.pop_front();
+        }
+        if (m_pending.empty()) {
+            m_arrivals.clear();
+        }
+
+        lock.unlock();
+        if (max_pending > 0) {
+            cv_room.notify_all();
+        }
+        const bool committed = commit(batch);
+        if (committed) {
+            metrics().db_commits.add();
+            metrics().db_commit_rows.observe(static_cast<uint64_t>(count));
+        } else {
+            metrics().db_failed_rows.add(count);
+            std::cerr << "Error: dropped " << count << " results the database did not take" << std::endl;
+        }
+        if (done_listener) {
+            done_listener(batch);
+        }
+        lock.lock();
+
+        m_done += count;
+        if (committed) {
+            m_committed += count;
+            m_commits++;
+            m_last_commit_rows = count;
+        } else {
+            m_failed += count;
+        }
+        for (const auto& url : batch) {
+            if (auto it = m_last_row.find(url.request_id); it != m_last_row.end() && it->second <= m_done) {
+                m_last_row.erase(it);
+            }
+        }
+        cv_committed.notify_all();
+    }
+}
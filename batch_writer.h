@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "database_interface.h"
+#include "url.h"
+
+// Group-commit stage in front of a database: insert() only queues the row,
+// and a writer thread commits queued rows in one transaction once batchSize
+// rows are waiting or the oldest one has waited maxLatency. With maxPending,
+// insert() waits while that many rows are queued, so a slow disk holds back
+// the checks instead of filling memory. A batch the
+// database refuses is retried a few times and then dropped; dropped rows
+// are counted in failedRowCount() and monitoring_db_failed_rows_total, and
+// the rows of every commit in monitoring_db_commit_rows.
+class BatchWriter : public DatabaseInterface {
+   public:
+    // Called on the writer thread with every batch once it is committed or
+    // dropped.
+    using DoneListener = std::function<void(const std::vector<Url>&)>;
+
+    // maxPending of 0 leaves the queue unbounded; a smaller one than
+    // batchSize is raised to it.
+    BatchWriter(const std::shared_ptr<DatabaseInterface>& database,
+                size_t batchSize, std::chrono::milliseconds maxLatency, size_t maxPending = 0);
+    ~BatchWriter() override;
+
+    [[nodiscard]] size_t getRequestId(const std::string& content) const override;
+    bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) override;
+    bool removeRequest(const int requestId) override;
+    bool insert(const Url& url) override;
+    bool insert(const std::vector<Url>& urls) override;
+    // Commit the rows queued so far for the request before reading; rows
+    // of other requests keep waiting for their batch.
+    std::vector<Url> find(const int requestId) override;
+    std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                          const ResultFilter& filter = {}) override;
+    bool requestIdExists(const int requestId) override;
+    int lastRequestId() override;
+    // Rows still queued are not counted yet.
+    std::optional<ResultTotals> totals(long long sinceMillis = 0) override;
+
+    // Blocks until every row queued before the call is committed or
+    // dropped.
+    void flush();
+    // Blocks until every row of the request queued before the call is
+    // committed or dropped.
+    void flush(const int requestId);
+    // Must be set before the first insert.
+    void onDone(DoneListener listener);
+
+    [[nodiscard]] size_t commitCount() const;
+    [[nodiscard]] size_t rowCount() const;
+    [[nodiscard]] size_t lastCommitRows() const;
+    [[nodiscard]] size_t failedRowCount() const;
+
+   private:
+    static constexpr int kInsertAttempts = 3;
+    static constexpr std::chrono::milliseconds kRetryDelay{50};
+
+    // Waits until rows up to target are done; lock holds mtx.
+    void flushUntil(size_t target, std::unique_lock<std::mutex>& lock);
+    void writer();
+    // Inserts the batch, retrying a failed insert; false if every attempt
+    // failed.
+    bool commit(const std::vector<Url>& batch);
+
+    std::shared_ptr<DatabaseInterface> db;
+    size_t batch_size;
+    std::chrono::milliseconds max_latency;
+    size_t max_pending;
+    DoneListener done_listener;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable cv_committed;
+    // Signalled as the writer takes rows off a bounded queue.
+    std::condition_variable cv_room;
+    std::deque<Url> m_pending;
+    // Count of rows ever queued as of the last row of each request that is
+    // not done yet.
+    std::unordered_map<int, size_t> m_last_row;
+    // Count of rows ever queued before each insert with rows still queued,
+    // and when it queued them; the front one dates the oldest queued row.
+    std::deque<std::pair<size_t, std::chrono::steady_clock::time_point>> m_arrivals;
+    size_t m_enqueued = 0;
+    // Rows taken off the queue, whether committed or dropped.
+    size_t m_done = 0;
+    size_t m_committed = 0;
+    size_t m_failed = 0;
+    size_t m_flush_until = 0;
+    size_t m_commits = 0;
+    size_t m_last_commit_rows = 0;
+    bool m_stop = false;
+    std::thread thread;
+};
@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+#include <charconv>
+#include <istream>
+#include <nlohmann/json.hpp>
+#include <regex>
+#include <string>
+#include <vector>
+#include "http_request_parser.h"
+#include "http_routes.h"
+#include "url_stream_parser.h"
+
+namespace {
+
+const std::string kGetRequest =
+    "GET /get_results/123456 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: dashboard/1.0\r\n"
+    "Accept: application/json\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+const std::string kPostRequest =
+    "POST /check_urls HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 42\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// The request handling HttpSession used before the zero-copy parser: an
+// istream over the streambuf, case-sensitive header prefixes and a regex
+// built for every GET.
+int legacyParse(const std::string& data) {
+    boost::asio::streambuf buffer;
+    std::ostream(&buffer) << data;
+
+    std::string method, uri, version, content_type;
+    size_t content_length = 0;
+    std::istream request_stream(&buffer);
+    request_stream >> method >> uri >> version;
+    std::string line;
+    std::getline(request_stream, line);
+    std::string header;
+    while (std::getline(request_stream, header)) {
+        if (!header.empty() && header.back() == '\r') {
+            header.pop_back();
+        }
+        if (header.empty()) {
+            break;
+        }
+        if (header.find("Content-Length:") == 0) {
+            content_length = std::stoi(header.substr(15));
+        }
+        if (header.find("Content-Type:") == 0) {
+            content_type = header.substr(13);
+        }
+    }
+    if (method == "GET") {
+        std::regex get_results_pattern("^/get_results/(\\d{1,9})$");
+        std::smatch matches;
+        if (std::regex_match(uri, matches, get_results_pattern)) {
+            return std::stoi(matches[1].str());
+        }
+        return 0;
+    }
+    return uri == "/check_urls" ? static_cast<int>(content_length) : 0;
+}
+
+int parse(HttpRequestParser& parser, const std::string& data) {
+    parser.reset();
+    if (parser.parse(data) != HttpRequestParser::Result::Complete) {
+        return 0;
+    }
+    const HttpRequest& request = parser.request();
+    const RouteEntry* entry = findRoute(request.method, request.path);
+    if (entry == nullptr) {
+        return 0;
+    }
+    if (entry->route == Route::GetResults) {
+        std::string_view id = request.path.substr(entry->path.size());
+        int requestId = 0;
+        std::from_chars(id.data(), id.data() + id.size(), requestId);
+        return requestId;
+    }
+    return static_cast<int>(request.content_length);
+}
+
+void BM_LegacyParseGet(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacyParse(kGetRequest));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LegacyParseGet);
+
+void BM_ParseGet(benchmark::State& state) {
+    HttpRequestParser parser;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse(parser, kGetRequest));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseGet);
+
+void BM_LegacyParsePost(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacyParse(kPostRequest));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LegacyParsePost);
+
+void BM_ParsePost(benchmark::State& state) {
+    HttpRequestParser parser;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse(parser, kPostRequest));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParsePost);
+
+// A /check_urls body of 10000 URLs.
+const std::string& urlsBody() {
+    static const std::string body = [] {
+        nlohmann::json urls = nlohmann::json::array();
+        for (int i = 0; i < 10000; i++) {
+            urls.push_back({{"url", "http://host" + std::to_string(i % 100) + ".test/path/" + std::to_string(i)}});
+        }
+        return nlohmann::json{{"urls", urls}}.dump();
+    }();
+    return body;
+}
+
+// What /check_urls did before the streaming scan: a DOM of the whole body
+// and a copy of its URLs.
+void BM_ParseUrlsDom(benchmark::State& state) {
+    for (auto _ : state) {
+        std::vector<std::string> urls;
+        nlohmann::json parsed = nlohmann::json::parse(urlsBody());
+        for (const auto& url_obj : parsed["urls"]) {
+            urls.push_back(url_obj["url"].get<std::string>());
+        }
+        benchmark::DoNotOptimize(urls.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * urlsBody().size()));
+}
+BENCHMARK(BM_ParseUrlsDom);
+
+// The body fed in 64 KiB pieces, taking 1000 URLs at a time.
+void BM_ScanUrlsStream(benchmark::State& state) {
+    const std::string_view body = urlsBody();
+    for (auto _ : state) {
+        UrlStreamParser parser;
+        for (size_t offset = 0; offset < body.size(); offset += 64 * 1024) {
+            parser.feed(body.substr(offset, 64 * 1024));
+            while (parser.pending() >= 1000) {
+                benchmark::DoNotOptimize(parser.take(1000).data());
+            }
+        }
+        benchmark::DoNotOptimize(parser.take().data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * body.size()));
+}
+BENCHMARK(BM_ScanUrlsStream);
+
+}  // namespace
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log_db.h"
+
+// The same workloads as bench_sqlite_db.cpp, against the log: compare
+// BM_LogDb* with BM_Sqlite* of the same name and arguments.
+namespace {
+
+const std::string kBenchDir = "bench_log_db";
+constexpr size_t kInsertBatch = 1000;
+
+void deleteBenchDb() {
+    std::filesystem::remove_all(kBenchDir);
+}
+
+std::vector<Url> makeRows(int requestId, size_t count) {
+    std::vector<Url> rows;
+    rows.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        rows.push_back(Url{requestId, "http://host" + std::to_string(i % 100) + ".test/" + std::to_string(i),
+                           200, static_cast<int>(i % 1000)});
+    }
+    return rows;
+}
+
+void BM_LogDbInsertBatched(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        deleteBenchDb();
+        auto db = std::make_unique<LogDb>(kBenchDir);
+        const int requestId = static_cast<int>(db->getRequestId("{}"));
+        const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+        state.ResumeTiming();
+        for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+            db->insert(rows);
+        }
+        state.PauseTiming();
+        db.reset();
+        state.ResumeTiming();
+    }
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_LogDbInsertBatched)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+void BM_LogDbInsertRow(benchmark::State& state) {
+    deleteBenchDb();
+    auto db = std::make_unique<LogDb>(kBenchDir);
+    const Url row{static_cast<int>(db->getRequestId("{}")), "http://host.test/", 200, 10};
+    for (auto _ : state) {
+        db->insert(row);
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LogDbInsertRow);
+
+void BM_LogDbFind(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<LogDb>(kBenchDir);
+    const int requestId = static_cast<int>(db->getRequestId("{}"));
+    const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        db->insert(std::vector<Url>(rows.begin(), rows.begin() + std::min(kInsertBatch, count - inserted)));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(requestId));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_LogDbFind)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+void BM_LogDbFindPage(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<LogDb>(kBenchDir);
+    const int requestId = static_cast<int>(db->getRequestId("{}"));
+    const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        db->insert(rows);
+    }
+    const auto middle = static_cast<long long>(count / 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(requestId, middle, 1000));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 1000));
+}
+BENCHMARK(BM_LogDbFindPage)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+void BM_LogDbFindAmongRequests(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<LogDb>(kBenchDir);
+    int middle = 0;
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        const int requestId = static_cast<int>(db->getRequestId("{}"));
+        db->insert(makeRows(requestId, kInsertBatch));
+        if (inserted <= count / 2) {
+            middle = requestId;
+        }
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(middle));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kInsertBatch));
+}
+BENCHMARK(BM_LogDbFindAmongRequests)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
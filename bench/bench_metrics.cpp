@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "metrics.h"
+
+namespace {
+
+// A single shared atomic, what the counters would cost without shards.
+std::atomic<uint64_t> shared_counter = 0;
+
+void BM_SharedAtomicAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        shared_counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedAtomicAdd)->ThreadRange(1, 16)->UseRealTime();
+
+Counter counter;
+
+void BM_CounterAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        counter.add();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CounterAdd)->ThreadRange(1, 16)->UseRealTime();
+
+Histogram histogram{1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+                    1000000, 2500000, 5000000, 10000000};
+
+// What a worker pays per check: the clock read and one observation.
+void BM_HistogramObserve(benchmark::State& state) {
+    for (auto _ : state) {
+        const auto started = std::chrono::steady_clock::now();
+        histogram.observe(std::chrono::steady_clock::now() - started + std::chrono::milliseconds(30));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistogramObserve)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_Scrape(benchmark::State& state) {
+    for (auto _ : state) {
+        MetricsWriter writer;
+        writer.write(metrics());
+        benchmark::DoNotOptimize(writer.text().data());
+    }
+}
+BENCHMARK(BM_Scrape);
+
+}  // namespace
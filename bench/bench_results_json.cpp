@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include "compression.h"
+#include "result_json.h"
+
+namespace {
+
+std::vector<Url> makeUrls(size_t count) {
+    std::vector<Url> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        urls.push_back(Url{1, "http://host" + std::to_string(i % 100) + ".test/" + std::to_string(i),
+                           200, static_cast<int>(i % 1000), "2025-10-15 10:30:45", static_cast<long long>(i + 1)});
+    }
+    return urls;
+}
+
+// Serializes the body of a full /get_results response of range(0) rows.
+void BM_ResultsJson(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const std::vector<Url> urls = makeUrls(count);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::string body = resultsJson("1", std::nullopt, urls);
+        bytes += body.size();
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_ResultsJson)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMicrosecond);
+
+// Gzips the body of 10 thousand rows at zlib level range(0); the counter
+// is the share of the body left to send.
+void BM_ResultsJsonGzip(benchmark::State& state) {
+    const int level = static_cast<int>(state.range(0));
+    const std::string body = resultsJson("1", std::nullopt, makeUrls(10000));
+    size_t compressed = 0;
+    for (auto _ : state) {
+        std::string encoded = compress(body, level, CompressionFormat::Gzip);
+        compressed = encoded.size();
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * body.size()));
+    state.counters["ratio"] = static_cast<double>(compressed) / static_cast<double>(body.size());
+}
+BENCHMARK(BM_ResultsJsonGzip)->Arg(1)->Arg(6)->Arg(9)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -0,0 +1,166 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sharded_sqlite_db.h"
+#include "sqlite_db.h"
+
+namespace {
+
+const std::string kBenchDbPath = "bench_sqlite_db.db";
+constexpr size_t kInsertBatch = 1000;
+
+void deleteBenchDb() {
+    for (const auto& suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(kBenchDbPath + suffix);
+    }
+}
+
+// The catalog of a sharded database and its shard files.
+void deleteShardedBenchDb() {
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        if (entry.path().filename().string().rfind(kBenchDbPath, 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+std::vector<Url> makeRows(int requestId, size_t count) {
+    std::vector<Url> rows;
+    rows.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        rows.push_back(Url{requestId, "http://host" + std::to_string(i % 100) + ".test/" + std::to_string(i),
+                           200, static_cast<int>(i % 1000)});
+    }
+    return rows;
+}
+
+// Inserts range(0) rows in transactions of kInsertBatch, the way
+// BatchWriter flushes them.
+void BM_SqliteInsertBatched(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        deleteBenchDb();
+        auto db = std::make_unique<SqliteDb>(kBenchDbPath, 0);
+        const int requestId = static_cast<int>(db->getRequestId("{}"));
+        const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+        state.ResumeTiming();
+        for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+            db->insert(rows);
+        }
+    }
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_SqliteInsertBatched)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+// One transaction per row, as with --flush-size 0.
+void BM_SqliteInsertRow(benchmark::State& state) {
+    deleteBenchDb();
+    auto db = std::make_unique<SqliteDb>(kBenchDbPath, 0);
+    const Url row{static_cast<int>(db->getRequestId("{}")), "http://host.test/", 200, 10};
+    for (auto _ : state) {
+        db->insert(row);
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_SqliteInsertRow);
+
+// Reads all range(0) rows of a request, as a full /get_results does.
+void BM_SqliteFind(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<SqliteDb>(kBenchDbPath, 1);
+    const int requestId = static_cast<int>(db->getRequestId("{}"));
+    const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        db->insert(std::vector<Url>(rows.begin(), rows.begin() + std::min(kInsertBatch, count - inserted)));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(requestId));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_SqliteFind)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+// Reads one 1000-row page from the middle of a request of range(0) rows.
+void BM_SqliteFindPage(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<SqliteDb>(kBenchDbPath, 1);
+    const int requestId = static_cast<int>(db->getRequestId("{}"));
+    const std::vector<Url> rows = makeRows(requestId, kInsertBatch);
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        db->insert(rows);
+    }
+    const auto middle = static_cast<long long>(count / 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(requestId, middle, 1000));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 1000));
+}
+BENCHMARK(BM_SqliteFindPage)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+// Reads the 1000 rows of one request from a table of range(0) rows spread
+// over requests of 1000 rows each, as /get_results does on a long-lived
+// database; the time should not grow with the table.
+void BM_SqliteFindAmongRequests(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    deleteBenchDb();
+    auto db = std::make_unique<SqliteDb>(kBenchDbPath, 1);
+    int middle = 0;
+    for (size_t inserted = 0; inserted < count; inserted += kInsertBatch) {
+        const int requestId = static_cast<int>(db->getRequestId("{}"));
+        db->insert(makeRows(requestId, kInsertBatch));
+        if (inserted <= count / 2) {
+            middle = requestId;
+        }
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->find(middle));
+    }
+    db.reset();
+    deleteBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kInsertBatch));
+}
+BENCHMARK(BM_SqliteFindAmongRequests)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMicrosecond);
+
+// Inserts 100000 rows of 64 requests in batches of kInsertBatch mixing all
+// of them, as BatchWriter flushes results of concurrent requests, into
+// range(0) shards; the batch is written to every shard in parallel.
+void BM_ShardedSqliteInsert(benchmark::State& state) {
+    constexpr size_t kRows = 100000;
+    constexpr int kRequests = 64;
+    ShardingConfig config;
+    config.shards = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        deleteShardedBenchDb();
+        auto db = std::make_unique<ShardedSqliteDb>(kBenchDbPath, config);
+        std::vector<Url> batch = makeRows(0, kInsertBatch);
+        std::vector<int> requests;
+        for (int i = 0; i < kRequests; i++) {
+            requests.push_back(static_cast<int>(db->getRequestId("{}")));
+        }
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i].request_id = requests[i % requests.size()];
+        }
+        state.ResumeTiming();
+        for (size_t inserted = 0; inserted < kRows; inserted += kInsertBatch) {
+            db->insert(batch);
+        }
+    }
+    deleteShardedBenchDb();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kRows));
+}
+BENCHMARK(BM_ShardedSqliteInsert)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
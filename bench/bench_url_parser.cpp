@@ -0,0 +1,168 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "database_interface.h"
+#include "http_client_interface.h"
+#include "url_parser.h"
+
+namespace {
+
+constexpr size_t kBatchSize = 10000;
+constexpr size_t kHosts = 100;
+
+class InstantHttpClient : public HttpClientInterface {
+   public:
+    [[nodiscard]] size_t getHttpStatus() const override { return 200; }
+    [[nodiscard]] long long getRequestTime() const override { return 1; }
+    [[nodiscard]] PhaseTimings getTimings() const override { return {}; }
+};
+
+std::unique_ptr<HttpClientInterface> instantClient(const std::string&, size_t) {
+    return std::make_unique<InstantHttpClient>();
+}
+
+// Counts inserted rows; waitFor() returns once a number of them arrived.
+class CountingDb : public DatabaseInterface {
+   public:
+    [[nodiscard]] size_t getRequestId(const std::string&) const override { return 0; }
+    bool setRequestContent(const int, const std::string&, bool) override { return true; }
+    bool removeRequest(const int) override { return true; }
+    bool insert(const Url&) override {
+        inserted.fetch_add(1, std::memory_order_release);
+        inserted.notify_one();
+        return true;
+    }
+    bool insert(const std::vector<Url>& urls) override {
+        inserted.fetch_add(urls.size(), std::memory_order_release);
+        inserted.notify_one();
+        return true;
+    }
+    std::vector<Url> find(const int) override { return {}; }
+    std::vector<Url> find(const int, long long, size_t, const ResultFilter&) override { return {}; }
+    bool requestIdExists(const int) override { return false; }
+    int lastRequestId() override { return 0; }
+
+    void waitFor(size_t count) {
+        for (size_t current = inserted.load(std::memory_order_acquire); current < count;
+             current = inserted.load(std::memory_order_acquire)) {
+            inserted.wait(current, std::memory_order_acquire);
+        }
+    }
+
+   private:
+    std::atomic<size_t> inserted = 0;
+};
+
+std::vector<std::string> makeBatch() {
+    std::vector<std::string> urls;
+    urls.reserve(kBatchSize);
+    for (size_t i = 0; i < kBatchSize; i++) {
+        urls.push_back("http://host" + std::to_string(i % kHosts) + ".test/" + std::to_string(i));
+    }
+    return urls;
+}
+
+// The dispatch UrlParser used before the ready ring: one FIFO under a
+// mutex, notify_all for every batch and a lock round trip for every pop.
+class LegacyDispatcher {
+   public:
+    LegacyDispatcher(size_t numThreads, const std::shared_ptr<DatabaseInterface>& database)
+        : db(database) {
+        for (size_t i = 0; i < numThreads; i++) {
+            threads.emplace_back(&LegacyDispatcher::worker, this);
+        }
+    }
+    ~LegacyDispatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    void addUrls(int requestId, const std::vector<std::string>& urls) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& url : urls) {
+            queue.push(Url{requestId, url});
+        }
+        cv.notify_all();
+    }
+
+   private:
+    void worker() {
+        while (true) {
+            Url url;
+            {
+                std::unique_lock lock(mtx);
+                cv.wait(lock, [this] { return !queue.empty() || stop; });
+                if (stop && queue.empty()) {
+                    break;
+                }
+                url = queue.front();
+                queue.pop();
+            }
+            auto httpClient = instantClient(url.url, 1);
+            url.http_status = httpClient->getHttpStatus();
+            url.response_time = httpClient->getRequestTime();
+            url.timings = httpClient->getTimings();
+            db->insert(url);
+        }
+    }
+
+    std::shared_ptr<DatabaseInterface> db;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::queue<Url> queue;
+    bool stop = false;
+    std::vector<std::thread> threads;
+};
+
+template <typename Dispatcher, typename... Args>
+void runBatches(benchmark::State& state, Args&&... args) {
+    auto db = std::make_shared<CountingDb>();
+    Dispatcher dispatcher(static_cast<size_t>(state.range(0)), db, std::forward<Args>(args)...);
+    const std::vector<std::string> batch = makeBatch();
+    size_t expected = 0;
+    int requestId = 0;
+    for (auto _ : state) {
+        dispatcher.addUrls(++requestId, batch);
+        expected += batch.size();
+        db->waitFor(expected);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(expected));
+}
+
+// Adapts UrlParser's constructor to the shape runBatches expects.
+class Parser : public UrlParser {
+   public:
+    Parser(size_t numThreads, const std::shared_ptr<DatabaseInterface>& database, const HostLimits& limits = {})
+        : UrlParser(numThreads, 1, database, instantClient, limits) {}
+};
+
+void BM_LegacyDispatch(benchmark::State& state) {
+    runBatches<LegacyDispatcher>(state);
+}
+BENCHMARK(BM_LegacyDispatch)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+void BM_Dispatch(benchmark::State& state) {
+    runBatches<Parser>(state);
+}
+BENCHMARK(BM_Dispatch)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+// With a concurrency cap every finished check goes back through the
+// scheduler lock.
+void BM_DispatchCapped(benchmark::State& state) {
+    runBatches<Parser>(state, HostLimits{8, 0});
+}
+BENCHMARK(BM_DispatchCapped)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "url_stats.h"
+
+namespace {
+
+std::vector<Url> checks(size_t urls) {
+    std::vector<Url> result;
+    result.reserve(urls);
+    for (size_t i = 0; i < urls; i++) {
+        Url url{1, "http://host" + std::to_string(i % 100) + ".example/page/" + std::to_string(i), 200};
+        url.timings.total_us = static_cast<long long>(5000 + i % 200000);
+        result.push_back(std::move(url));
+    }
+    return result;
+}
+
+// What a worker pays per result, by the number of URLs tracked.
+void BM_UrlStatsRecord(benchmark::State& state) {
+    UrlStats stats;
+    const auto urls = checks(static_cast<size_t>(state.range(0)));
+    size_t i = 0;
+    for (auto _ : state) {
+        stats.record(urls[i++ % urls.size()]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UrlStatsRecord)->Arg(1000)->Arg(100000);
+
+// /stats?url=: the same whatever the number of URLs tracked.
+void BM_UrlStatsSummary(benchmark::State& state) {
+    UrlStats stats;
+    const auto urls = checks(static_cast<size_t>(state.range(0)));
+    for (int round = 0; round < 20; round++) {
+        for (const auto& url : urls) {
+            stats.record(url);
+        }
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(stats.summary(urls[i++ % urls.size()].url));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UrlStatsSummary)->Arg(1000)->Arg(100000);
+
+}  // namespace
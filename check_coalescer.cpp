@@ -0,0 +1,67 @@
+#include "check_coalescer.h"
+
+CheckCoalescer::CheckCoalescer(std::chrono::milliseconds ttl, size_t maxCached)
+    : ttl(ttl), max_cached(maxCached) {}
+
+CheckCoalescer::Outcome CheckCoalescer::begin(Url& url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    m_stats.requested++;
+    if (ttl.count() > 0) {
+        expire(Clock::now());
+        if (auto it = results.find(url.url); it != results.end()) {
+            url.http_status = it->second.http_status;
+            url.response_time = it->second.response_time;
+            url.timings = it->second.timings;
+            m_stats.cached++;
+            return Outcome::Cached;
+        }
+    }
+    auto [it, inserted] = in_flight.try_emplace(url.url);
+    if (!inserted) {
+        it->second.push_back(url);
+        m_stats.joined++;
+        return Outcome::Joined;
+    }
+    m_stats.checked++;
+    return Outcome::Check;
+}
+
+std::vector<Url> CheckCoalescer::finish(const Url& url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<Url> waiters;
+    if (auto it = in_flight.find(url.url); it != in_flight.end()) {
+        waiters = std::move(it->second);
+        in_flight.erase(it);
+    }
+    for (auto& waiter : waiters) {
+        waiter.http_status = url.http_status;
+        waiter.response_time = url.response_time;
+        waiter.timings = url.timings;
+    }
+    if (ttl.count() > 0 && max_cached > 0) {
+        const auto now = Clock::now();
+        expire(now);
+        if (results.size() >= max_cached) {
+            results.erase(expiry.front().first);
+            expiry.pop_front();
+        }
+        const auto expires = now + ttl;
+        results.insert_or_assign(url.url, Result{url.http_status, url.response_time, url.timings, expires});
+        expiry.emplace_back(url.url, expires);
+    }
+    return waiters;
+}
+
+CheckCoalescer::Stats CheckCoalescer::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_stats;
+}
+
+// A URL is only cached while it is not in flight, so the expiry queue has
+// one entry per cached URL and its front is always the oldest.
+void CheckCoalescer::expire(Clock::time_point now) {
+    while (!expiry.empty() && expiry.front().second <= now) {
+        results.erase(expiry.front().first);
+        expiry.pop_front();
+    }
+}
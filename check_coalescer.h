@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "url.h"
+
+// Shares one network check between identical URLs: a URL that is already
+// being checked for another request waits for that check instead of
+// starting its own, and with a non-zero ttl a recent result is reused
+// outright. Every request still gets its own result.
+class CheckCoalescer {
+   public:
+    enum class Outcome {
+        // The caller checks the URL and then calls finish().
+        Check,
+        // The URL waits for a check in flight and is returned by its finish().
+        Joined,
+        // The URL has been filled in from a recent result.
+        Cached,
+    };
+
+    struct Stats {
+        // URLs that went through begin().
+        size_t requested = 0;
+        // Checks that went to the network.
+        size_t checked = 0;
+        size_t joined = 0;
+        size_t cached = 0;
+
+        // Share of URLs that did not need a check of their own.
+        [[nodiscard]] double dedupRatio() const {
+            return requested == 0 ? 0.0 : static_cast<double>(joined + cached) / requested;
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit CheckCoalescer(std::chrono::milliseconds ttl = {}, size_t maxCached = 65536);
+
+    Outcome begin(Url& url);
+    // Ends the check begun for url, which carries its result, and returns
+    // the URLs that joined it with the result filled in.
+    std::vector<Url> finish(const Url& url);
+
+    [[nodiscard]] Stats stats() const;
+
+   private:
+    struct Result {
+        int http_status = 0;
+        int response_time = 0;
+        PhaseTimings timings;
+        Clock::time_point expires;
+    };
+
+    void expire(Clock::time_point now);
+
+    std::chrono::milliseconds ttl;
+    size_t max_cached;
+    mutable std::mutex mtx;
+    // Waiters of the checks in flight, keyed by URL.
+    std::unordered_map<std::string, std::vector<Url>> in_flight;
+    std::unordered_map<std::string, Result> results;
+    // Cached URLs in the order they expire; every entry lives for ttl, so
+    // it is also insertion order.
+    std::deque<std::pair<std::string, Clock::time_point>> expiry;
+    Stats m_stats;
+};
@@ -0,0 +1,85 @@
+#include "compression.h"
+#include <zlib.h>
+#include <stdexcept>
+
+namespace {
+
+// deflateInit2 window bits: 15 for a zlib header, +16 for a gzip one.
+int windowBits(CompressionFormat format) {
+    return format == CompressionFormat::Gzip ? 15 + 16 : 15;
+}
+
+}  // namespace
+
+std::string compress(std::string_view data, int level, CompressionFormat format) {
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, windowBits(format), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {};
+    }
+    std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    const int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        return {};
+    }
+    return compressed;
+}
+
+std::optional<std::string> decompress(std::string_view data) {
+    z_stream stream{};
+    // +32 detects a zlib or a gzip header.
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return std::nullopt;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    std::string decompressed;
+    char buffer[16384];
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        decompressed.append(buffer, sizeof(buffer) - stream.avail_out);
+        if (result == Z_BUF_ERROR && stream.avail_in == 0) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        return std::nullopt;
+    }
+    return decompressed;
+}
+
+Deflater::Deflater(CompressionFormat format, int level) : m_stream(std::make_unique<z_stream>()) {
+    if (deflateInit2(m_stream.get(), level, Z_DEFLATED, windowBits(format), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Can't initialize deflate");
+    }
+}
+
+Deflater::~Deflater() {
+    deflateEnd(m_stream.get());
+}
+
+std::string Deflater::write(std::string_view data, bool finish) {
+    m_stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    m_stream->avail_in = static_cast<uInt>(data.size());
+    std::string compressed;
+    char buffer[16384];
+    // A flush is complete once deflate leaves room in the output; the end
+    // of the stream once it says so.
+    int result = Z_OK;
+    do {
+        m_stream->next_out = reinterpret_cast<Bytef*>(buffer);
+        m_stream->avail_out = sizeof(buffer);
+        result = deflate(m_stream.get(), finish ? Z_FINISH : Z_SYNC_FLUSH);
+        compressed.append(buffer, sizeof(buffer) - m_stream->avail_out);
+    } while (result == Z_OK && (finish || m_stream->avail_out == 0));
+    return compressed;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+struct z_stream_s;
+
+// Framing of a deflate stream: zlib (what HTTP calls "deflate") or gzip.
+enum class CompressionFormat { Zlib, Gzip };
+
+// Deflate of a whole buffer; level is zlib's 1-9.
+std::string compress(std::string_view data, int level = 6, CompressionFormat format = CompressionFormat::Zlib);
+// nullopt when data is not a valid zlib or gzip stream.
+std::optional<std::string> decompress(std::string_view data);
+
+// Deflate of data written in pieces. Every write flushes, so what it
+// returns completes everything written so far and can be sent at once; the
+// last write finishes the stream.
+class Deflater {
+   public:
+    // Throws if zlib cannot be initialized.
+    Deflater(CompressionFormat format, int level);
+    ~Deflater();
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    std::string write(std::string_view data, bool finish = false);
+
+   private:
+    std::unique_ptr<z_stream_s> m_stream;
+};
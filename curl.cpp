@@ -1,11 +1,40 @@
 #include "curl.h"
+#include <utility>
+
+PhaseTimings readPhaseTimings(CURL* easy) {
+    const std::pair<CURLINFO, long long PhaseTimings::*> infos[] = {
+        {CURLINFO_NAMELOOKUP_TIME_T, &PhaseTimings::namelookup_us},
+        {CURLINFO_CONNECT_TIME_T, &PhaseTimings::connect_us},
+        {CURLINFO_APPCONNECT_TIME_T, &PhaseTimings::appconnect_us},
+        {CURLINFO_PRETRANSFER_TIME_T, &PhaseTimings::pretransfer_us},
+        {CURLINFO_STARTTRANSFER_TIME_T, &PhaseTimings::starttransfer_us},
+        {CURLINFO_TOTAL_TIME_T, &PhaseTimings::total_us},
+    };
+    PhaseTimings timings;
+    for (const auto& [info, phase] : infos) {
+        curl_off_t micros = 0;
+        if (curl_easy_getinfo(easy, info, &micros) == CURLE_OK) {
+            timings.*phase = static_cast<long long>(micros);
+        }
+    }
+    return timings;
+}
 
 Curl::Curl(const std::string& url, const size_t timeout)
     : curl(curl_easy_init(), &curl_easy_cleanup) {
+    setOptions(url, timeout);
+}
+
+Curl::Curl(const std::string& url, const size_t timeout, const std::shared_ptr<CurlPool>& curlPool)
+    : pool(curlPool), curl(curlPool->acquire()) {
+    setOptions(url, timeout);
+}
+
+void Curl::setOptions(const std::string& url, const size_t timeout) {
     curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
     curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, timeout);
-};
+}
 
 [[nodiscard]] size_t Curl::getHttpStatus() const {
     const CURLcode res = curl_easy_perform(curl.get());
@@ -13,6 +42,11 @@ Curl::Curl(const std::string& url, const size_t timeout)
     if (res == CURLE_OK) {
         curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &httpCode);
     }
+    if (pool) {
+        long connects = 0;
+        curl_easy_getinfo(curl.get(), CURLINFO_NUM_CONNECTS, &connects);
+        pool->recordConnection(res == CURLE_OK && connects == 0);
+    }
 
     return httpCode;
 }
@@ -22,3 +56,7 @@ Curl::Curl(const std::string& url, const size_t timeout)
     curl_easy_getinfo(curl.get(), CURLINFO_TOTAL_TIME, &totalTime);
     return static_cast<long long>(totalTime * 1000.0);
 }
+
+[[nodiscard]] PhaseTimings Curl::getTimings() const {
+    return readPhaseTimings(curl.get());
+}
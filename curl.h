@@ -3,16 +3,27 @@
 #include <curl/curl.h>
 #include <memory>
 #include <string>
+#include "curl_pool.h"
 #include "http_client_interface.h"
+#include "url.h"
+
+// Phase timings of the transfer the handle last performed.
+PhaseTimings readPhaseTimings(CURL* easy);
 
 class Curl : public HttpClientInterface {
    public:
     Curl(const std::string& url, const size_t timeout);
+    Curl(const std::string& url, const size_t timeout, const std::shared_ptr<CurlPool>& curlPool);
     ~Curl() override = default;
     [[nodiscard]] size_t getHttpStatus() const override;
 
     [[nodiscard]] long long getRequestTime() const override;
 
+    [[nodiscard]] PhaseTimings getTimings() const override;
+
    private:
-    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl;
+    void setOptions(const std::string& url, const size_t timeout);
+
+    std::shared_ptr<CurlPool> pool;
+    CurlPool::Handle curl;
 };
@@ -0,0 +1,233 @@
+#include "curl_multi.h"
+#include "curl.h"
+#include <poll.h>
+
+CurlMulti::CurlMulti()
+    : work(boost::asio::make_work_guard(io_context)),
+      timer(io_context),
+      multi(curl_multi_init(), &curl_multi_cleanup) {
+    curl_multi_setopt(multi.get(), CURLMOPT_SOCKETFUNCTION, &CurlMulti::socketCallback);
+    curl_multi_setopt(multi.get(), CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi.get(), CURLMOPT_TIMERFUNCTION, &CurlMulti::timerCallback);
+    curl_multi_setopt(multi.get(), CURLMOPT_TIMERDATA, this);
+    thread = std::thread([this] { io_context.run(); });
+}
+
+CurlMulti::~CurlMulti() {
+    work.reset();
+    io_context.stop();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    // The reactor is stopped, so the rest of the teardown is single threaded.
+    stopping = true;
+    timer.cancel();
+    // Checks posted but not added yet own their transfer in the handler;
+    // running it fails them below like the ones in flight.
+    io_context.restart();
+    io_context.poll();
+    // Removing handles and cleaning up the multi handle closes the remaining
+    // connections through closeSocket, which still needs the socket map.
+    std::vector<Callback> aborted;
+    aborted.reserve(transfers.size());
+    for (auto& [easy, transfer] : transfers) {
+        curl_multi_remove_handle(multi.get(), easy);
+        aborted.push_back(std::move(transfer->callback));
+    }
+    transfers.clear();
+    multi.reset();
+    sockets.clear();
+    for (auto& callback : aborted) {
+        callback(0, PhaseTimings{});
+    }
+}
+
+void CurlMulti::check(const std::string& url, size_t timeout, Callback callback) {
+    auto transfer = std::make_unique<Transfer>(
+        Transfer{{curl_easy_init(), &curl_easy_cleanup}, std::move(callback)});
+    CURL* easy = transfer->easy.get();
+    curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT, static_cast<long>(timeout));
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_OPENSOCKETFUNCTION, &CurlMulti::openSocket);
+    curl_easy_setopt(easy, CURLOPT_OPENSOCKETDATA, this);
+    curl_easy_setopt(easy, CURLOPT_CLOSESOCKETFUNCTION, &CurlMulti::closeSocket);
+    curl_easy_setopt(easy, CURLOPT_CLOSESOCKETDATA, this);
+
+    boost::asio::post(io_context, [this, t = transfer.release()] {
+        add(std::unique_ptr<Transfer>(t));
+    });
+}
+
+void CurlMulti::add(std::unique_ptr<Transfer> transfer) {
+    CURL* easy = transfer->easy.get();
+    transfers.emplace(easy, std::move(transfer));
+    if (stopping) {
+        return;
+    }
+    if (curl_multi_add_handle(multi.get(), easy) != CURLM_OK) {
+        auto callback = std::move(transfers.at(easy)->callback);
+        transfers.erase(easy);
+        callback(0, PhaseTimings{});
+    }
+}
+
+int CurlMulti::socketCallback(CURL*, curl_socket_t fd, int what, void* userp, void*) {
+    auto* self = static_cast<CurlMulti*>(userp);
+    auto it = self->sockets.find(fd);
+    if (it == self->sockets.end()) {
+        return 0;
+    }
+    it->second->wanted = (what == CURL_POLL_REMOVE) ? 0 : what;
+    self->watch(it->second);
+    return 0;
+}
+
+int CurlMulti::timerCallback(CURLM*, long timeoutMs, void* userp) {
+    auto* self = static_cast<CurlMulti*>(userp);
+    self->timer.cancel();
+    if (timeoutMs < 0) {
+        return 0;
+    }
+    // curl_multi_socket_action must not be called from inside a callback, so
+    // even a zero timeout goes through the timer.
+    self->timer.expires_after(std::chrono::milliseconds(timeoutMs));
+    self->timer.async_wait([self](boost::system::error_code ec) {
+        if (!ec) {
+            self->onTimeout();
+        }
+    });
+    return 0;
+}
+
+curl_socket_t CurlMulti::openSocket(void* clientp, curlsocktype purpose, curl_sockaddr* address) {
+    auto* self = static_cast<CurlMulti*>(clientp);
+    if (purpose != CURLSOCKTYPE_IPCXN || address->socktype != SOCK_STREAM) {
+        return CURL_SOCKET_BAD;
+    }
+    auto socket = std::make_shared<Socket>(self->io_context);
+    boost::system::error_code ec;
+    if (address->family == AF_INET) {
+        socket->socket.open(boost::asio::ip::tcp::v4(), ec);
+    } else if (address->family == AF_INET6) {
+        socket->socket.open(boost::asio::ip::tcp::v6(), ec);
+    } else {
+        return CURL_SOCKET_BAD;
+    }
+    if (ec) {
+        return CURL_SOCKET_BAD;
+    }
+    curl_socket_t fd = socket->socket.native_handle();
+    self->sockets[fd] = std::move(socket);
+    return fd;
+}
+
+int CurlMulti::closeSocket(void* clientp, curl_socket_t fd) {
+    auto* self = static_cast<CurlMulti*>(clientp);
+    auto it = self->sockets.find(fd);
+    if (it == self->sockets.end()) {
+        return 0;
+    }
+    it->second->closed = true;
+    boost::system::error_code ec;
+    it->second->socket.close(ec);
+    self->sockets.erase(it);
+    return 0;
+}
+
+void CurlMulti::watch(const std::shared_ptr<Socket>& socket) {
+    if ((socket->wanted & CURL_POLL_IN) && !socket->reading) {
+        socket->reading = true;
+        socket->socket.async_wait(
+            boost::asio::ip::tcp::socket::wait_read,
+            [this, socket](boost::system::error_code ec) {
+                socket->reading = false;
+                if (!ec && !socket->closed && (socket->wanted & CURL_POLL_IN)) {
+                    onSocketEvent(socket, CURL_CSELECT_IN);
+                }
+            });
+    }
+    if ((socket->wanted & CURL_POLL_OUT) && !socket->writing) {
+        socket->writing = true;
+        socket->socket.async_wait(
+            boost::asio::ip::tcp::socket::wait_write,
+            [this, socket](boost::system::error_code ec) {
+                socket->writing = false;
+                if (!ec && !socket->closed && (socket->wanted & CURL_POLL_OUT)) {
+                    onSocketEvent(socket, CURL_CSELECT_OUT);
+                }
+            });
+    }
+}
+
+void CurlMulti::onSocketEvent(const std::shared_ptr<Socket>& socket, int event) {
+    if (stopping) {
+        return;
+    }
+    curl_socket_t fd = socket->socket.native_handle();
+    curl_multi_socket_action(multi.get(), fd, event, &running);
+    checkCompleted();
+    if (socket->closed) {
+        return;
+    }
+    // The asio reactor is edge triggered: if curl left bytes (or EOF) unread
+    // there will be no further notification, so look before waiting again.
+    pollfd pfd{fd, 0, 0};
+    if (socket->wanted & CURL_POLL_IN) {
+        pfd.events |= POLLIN;
+    }
+    if (socket->wanted & CURL_POLL_OUT) {
+        pfd.events |= POLLOUT;
+    }
+    if (pfd.events != 0 && ::poll(&pfd, 1, 0) > 0) {
+        int ready = 0;
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ready |= CURL_CSELECT_IN;
+        }
+        if (pfd.revents & POLLOUT) {
+            ready |= CURL_CSELECT_OUT;
+        }
+        if (ready != 0) {
+            boost::asio::post(io_context, [this, socket, ready] {
+                if (!socket->closed) {
+                    onSocketEvent(socket, ready);
+                }
+            });
+            return;
+        }
+    }
+    watch(socket);
+}
+
+void CurlMulti::onTimeout() {
+    if (stopping) {
+        return;
+    }
+    curl_multi_socket_action(multi.get(), CURL_SOCKET_TIMEOUT, 0, &running);
+    checkCompleted();
+}
+
+void CurlMulti::checkCompleted() {
+    int pending = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi.get(), &pending)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL* easy = message->easy_handle;
+        long httpCode = 0;
+        if (message->data.result == CURLE_OK) {
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &httpCode);
+        }
+        const PhaseTimings timings = readPhaseTimings(easy);
+        curl_multi_remove_handle(multi.get(), easy);
+
+        auto it = transfers.find(easy);
+        if (it == transfers.end()) {
+            continue;
+        }
+        auto transfer = std::move(it->second);
+        transfers.erase(it);
+        transfer->callback(static_cast<size_t>(httpCode), timings);
+    }
+}
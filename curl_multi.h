@@ -0,0 +1,58 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "async_http_client_interface.h"
+
+// Event-driven check engine: a single reactor thread drives libcurl through
+// curl_multi_socket_action, so thousands of checks can be in flight at once.
+// Checks still in flight when it is destroyed complete with status 0 on the
+// destroying thread; their callbacks must not start new checks.
+class CurlMulti : public AsyncHttpClientInterface {
+   public:
+    CurlMulti();
+    ~CurlMulti() override;
+
+    void check(const std::string& url, size_t timeout, Callback callback) override;
+
+   private:
+    struct Transfer {
+        std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> easy;
+        Callback callback;
+    };
+    struct Socket {
+        explicit Socket(boost::asio::io_context& ioContext) : socket(ioContext) {}
+        boost::asio::ip::tcp::socket socket;
+        int wanted = 0;
+        bool reading = false;
+        bool writing = false;
+        bool closed = false;
+    };
+
+    static int socketCallback(CURL* easy, curl_socket_t fd, int what, void* userp, void* socketp);
+    static int timerCallback(CURLM* multi, long timeoutMs, void* userp);
+    static curl_socket_t openSocket(void* clientp, curlsocktype purpose, curl_sockaddr* address);
+    static int closeSocket(void* clientp, curl_socket_t fd);
+
+    void add(std::unique_ptr<Transfer> transfer);
+    void watch(const std::shared_ptr<Socket>& socket);
+    void onSocketEvent(const std::shared_ptr<Socket>& socket, int event);
+    void onTimeout();
+    void checkCompleted();
+
+    boost::asio::io_context io_context;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+    boost::asio::steady_timer timer;
+    std::unordered_map<curl_socket_t, std::shared_ptr<Socket>> sockets;
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> transfers;
+    std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi;
+    int running = 0;
+    // Set once the reactor has stopped; nothing is driven through curl after.
+    bool stopping = false;
+    std::thread thread;
+};
@@ -0,0 +1,85 @@
+#include "curl_pool.h"
+#include "metrics.h"
+
+CurlPool::CurlPool(size_t maxSize, std::chrono::seconds maxIdle)
+    : max_size(maxSize),
+      max_idle(maxIdle),
+      share(curl_share_init(), &curl_share_cleanup) {
+    curl_share_setopt(share.get(), CURLSHOPT_LOCKFUNC, &CurlPool::lock);
+    curl_share_setopt(share.get(), CURLSHOPT_UNLOCKFUNC, &CurlPool::unlock);
+    curl_share_setopt(share.get(), CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlPool::~CurlPool() {
+    // Handles must be gone before the share they point at is cleaned up.
+    for (auto& [easy, since] : idle) {
+        curl_easy_cleanup(easy);
+    }
+}
+
+CurlPool::Handle CurlPool::acquire() {
+    CURL* easy = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        evictIdle(Clock::now());
+        if (!idle.empty()) {
+            easy = idle.back().first;
+            idle.pop_back();
+        }
+    }
+    if (easy != nullptr) {
+        metrics().curl_pool_hits.add();
+        curl_easy_reset(easy);
+    } else {
+        metrics().curl_pool_misses.add();
+        easy = curl_easy_init();
+    }
+    curl_easy_setopt(easy, CURLOPT_SHARE, share.get());
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+
+    return Handle(easy, [pool = shared_from_this()](CURL* easy) {
+        pool->release(easy);
+    });
+}
+
+void CurlPool::recordConnection(bool reused) {
+    if (reused) {
+        metrics().curl_connections_reused.add();
+    } else {
+        metrics().curl_connections_created.add();
+    }
+}
+
+void CurlPool::release(CURL* easy) {
+    if (easy == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto now = Clock::now();
+        evictIdle(now);
+        if (idle.size() < max_size) {
+            idle.emplace_back(easy, now);
+            return;
+        }
+    }
+    curl_easy_cleanup(easy);
+}
+
+void CurlPool::evictIdle(Clock::time_point now) {
+    // Handles are returned to the back, so the oldest ones are at the front.
+    while (!idle.empty() && now - idle.front().second > max_idle) {
+        curl_easy_cleanup(idle.front().first);
+        idle.pop_front();
+    }
+}
+
+void CurlPool::lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<CurlPool*>(userptr)->share_locks[data].lock();
+}
+
+void CurlPool::unlock(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<CurlPool*>(userptr)->share_locks[data].unlock();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Pool of reusable easy handles. All handles share one CURLSH with the DNS
+// cache and TLS sessions, so recurring checks against the same hosts skip
+// most of the handshake cost. Open connections are not shared: libcurl
+// does not support one connection cache used by threads at once, so each
+// handle keeps its own, which outlives curl_easy_reset and goes with the
+// handle back to the pool. Handle and connection reuse is counted in the
+// process-wide metrics.
+class CurlPool : public std::enable_shared_from_this<CurlPool> {
+   public:
+    using Handle = std::unique_ptr<CURL, std::function<void(CURL*)>>;
+
+    CurlPool(size_t maxSize, std::chrono::seconds maxIdle);
+    ~CurlPool();
+
+    // Returns a reset handle; it goes back to the pool when destroyed.
+    Handle acquire();
+    void recordConnection(bool reused);
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void release(CURL* easy);
+    void evictIdle(Clock::time_point now);
+    static void lock(CURL* easy, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlock(CURL* easy, curl_lock_data data, void* userptr);
+
+    size_t max_size;
+    std::chrono::seconds max_idle;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks;
+    std::unique_ptr<CURLSH, decltype(&curl_share_cleanup)> share;
+    std::mutex mtx;
+    std::deque<std::pair<CURL*, Clock::time_point>> idle;
+};
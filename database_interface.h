@@ -1,16 +1,65 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 #include "url.h"
 
+// Bounds on the phase timings of results, in microseconds and inclusive,
+// indexed like kPhases; a bound that is not set does not filter.
+struct ResultFilter {
+    std::array<std::optional<long long>, kPhases.size()> min_us;
+    std::array<std::optional<long long>, kPhases.size()> max_us;
+
+    [[nodiscard]] bool empty() const {
+        auto unset = [](const auto& bound) { return !bound; };
+        return std::all_of(min_us.begin(), min_us.end(), unset) &&
+               std::all_of(max_us.begin(), max_us.end(), unset);
+    }
+};
+
+// Counts over stored results; sums of several databases add up.
+struct ResultTotals {
+    uint64_t results = 0;
+    // Results with a 2xx or 3xx status.
+    uint64_t successes = 0;
+    uint64_t response_time_ms = 0;
+
+    ResultTotals& operator+=(const ResultTotals& other) {
+        results += other.results;
+        successes += other.successes;
+        response_time_ms += other.response_time_ms;
+        return *this;
+    }
+};
+
 class DatabaseInterface {
    public:
     virtual ~DatabaseInterface() = default;
 
     [[nodiscard]] virtual size_t getRequestId(const std::string& content) const = 0;
+    // Replaces the body kept with the request, for one created before its
+    // body was read to the end. A deflated body is a zlib stream already,
+    // kept as it is.
+    virtual bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) = 0;
+    // Takes back a request whose creation failed halfway, before any of
+    // its results were stored. Its id is not given out again.
+    virtual bool removeRequest(const int requestId) = 0;
     virtual bool insert(const Url& url) = 0;
+    virtual bool insert(const std::vector<Url>& urls) = 0;
     virtual std::vector<Url> find(const int requestId) = 0;
+    // Up to limit results of the request with id greater than afterId that
+    // pass the filter.
+    virtual std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                                  const ResultFilter& filter = {}) = 0;
     virtual bool requestIdExists(const int requestId) = 0;
+    // Highest request id stored, 0 if there is none.
+    virtual int lastRequestId() = 0;
+    // Totals of the results stored at or after sinceMillis (epoch
+    // milliseconds); nullopt if the storage cannot count them.
+    virtual std::optional<ResultTotals> totals(long long /*sinceMillis*/ = 0) { return std::nullopt; }
 };
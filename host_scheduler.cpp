@@ -0,0 +1,171 @@
+#include "host_scheduler.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+// Idle hosts are swept out every this many pushes.
+constexpr size_t kSweepInterval = 1024;
+}  // namespace
+
+HostScheduler::HostScheduler(const HostLimits& limits)
+    : limits(limits), burst(std::max(limits.rate_per_host, 1.0)) {}
+
+void HostScheduler::push(Url url) {
+    const auto now = Clock::now();
+    if (++pushes_since_sweep >= kSweepInterval) {
+        sweep(now);
+    }
+    std::string scratch;
+    const std::string_view key = hostKey(url.url, scratch);
+    auto it = hosts.find(key);
+    if (it == hosts.end()) {
+        it = hosts.emplace(std::string(key), Host{}).first;
+        it->second.tokens = burst;
+        it->second.refilled = now;
+    }
+    Host& host = it->second;
+    auto& requestQueue = host.requests[url.request_id];
+    if (requestQueue.empty()) {
+        host.request_ring.push_back(url.request_id);
+    }
+    requestQueue.push(std::move(url));
+    host.queued++;
+    queued++;
+    if (!host.in_ring && !isCapped(host)) {
+        host.in_ring = true;
+        ring.push_back(&*it);
+    }
+}
+
+std::optional<Url> HostScheduler::pop(Clock::time_point now) {
+    for (size_t i = 0, n = ring.size(); i < n; i++) {
+        auto* entry = ring.front();
+        ring.pop_front();
+        Host& host = entry->second;
+        host.tokens = tokensAt(host, now);
+        host.refilled = now;
+        if (!isReady(host)) {
+            ring.push_back(entry);
+            continue;
+        }
+
+        const int requestId = host.request_ring.front();
+        host.request_ring.pop_front();
+        auto requestIt = host.requests.find(requestId);
+        Url url = std::move(requestIt->second.front());
+        requestIt->second.pop();
+        if (requestIt->second.empty()) {
+            host.requests.erase(requestIt);
+        } else {
+            host.request_ring.push_back(requestId);
+        }
+
+        host.queued--;
+        queued--;
+        if (capsConcurrency()) {
+            host.in_flight++;
+        }
+        if (limits.rate_per_host > 0) {
+            host.tokens -= 1;
+        }
+        if (host.queued > 0 && !isCapped(host)) {
+            ring.push_back(entry);
+        } else {
+            host.in_ring = false;
+            if (isIdle(host, now)) {
+                hosts.erase(entry->first);
+            }
+        }
+        return url;
+    }
+    return std::nullopt;
+}
+
+void HostScheduler::done(const Url& url) {
+    if (!capsConcurrency()) {
+        return;
+    }
+    std::string scratch;
+    auto it = hosts.find(hostKey(url.url, scratch));
+    if (it == hosts.end()) {
+        return;
+    }
+    Host& host = it->second;
+    if (host.in_flight > 0) {
+        host.in_flight--;
+    }
+    if (host.in_ring) {
+        return;
+    }
+    if (host.queued > 0) {
+        host.in_ring = true;
+        ring.push_back(&*it);
+    } else if (isIdle(host, Clock::now())) {
+        hosts.erase(it);
+    }
+}
+
+[[nodiscard]] std::optional<HostScheduler::Clock::time_point> HostScheduler::nextReady(Clock::time_point now) const {
+    if (limits.rate_per_host <= 0) {
+        return std::nullopt;
+    }
+    std::optional<Clock::time_point> next;
+    for (const auto* entry : ring) {
+        const double missing = 1.0 - tokensAt(entry->second, now);
+        const auto at = now + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(std::max(missing, 0.0) / limits.rate_per_host));
+        if (!next || at < *next) {
+            next = at;
+        }
+    }
+    return next;
+}
+
+std::string_view HostScheduler::hostOf(std::string_view url) {
+    if (size_t scheme = url.find("://"); scheme != std::string_view::npos) {
+        url.remove_prefix(scheme + 3);
+    }
+    url = url.substr(0, url.find_first_of("/?#"));
+    if (size_t at = url.rfind('@'); at != std::string_view::npos) {
+        url.remove_prefix(at + 1);
+    }
+    return url;
+}
+
+std::string_view HostScheduler::hostKey(std::string_view url, std::string& scratch) {
+    const std::string_view host = hostOf(url);
+    if (std::none_of(host.begin(), host.end(), [](unsigned char c) { return std::isupper(c); })) {
+        return host;
+    }
+    scratch.assign(host);
+    std::transform(scratch.begin(), scratch.end(), scratch.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return scratch;
+}
+
+[[nodiscard]] double HostScheduler::tokensAt(const Host& host, Clock::time_point now) const {
+    if (limits.rate_per_host <= 0 || now <= host.refilled) {
+        return host.tokens;
+    }
+    const double elapsed = std::chrono::duration<double>(now - host.refilled).count();
+    return std::min(burst, host.tokens + elapsed * limits.rate_per_host);
+}
+
+[[nodiscard]] bool HostScheduler::isReady(const Host& host) const {
+    return !isCapped(host) && (limits.rate_per_host <= 0 || host.tokens >= 1);
+}
+
+// A host can be forgotten once nothing is queued or running against it and
+// its token bucket has refilled, since it would be recreated in that state.
+[[nodiscard]] bool HostScheduler::isIdle(const Host& host, Clock::time_point now) const {
+    return host.queued == 0 && host.in_flight == 0 &&
+           (limits.rate_per_host <= 0 || tokensAt(host, now) >= burst);
+}
+
+void HostScheduler::sweep(Clock::time_point now) {
+    pushes_since_sweep = 0;
+    std::erase_if(hosts, [this, now](const auto& entry) {
+        return !entry.second.in_ring && isIdle(entry.second, now);
+    });
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "url.h"
+
+struct HostLimits {
+    // Checks running against one host at a time; 0 - unlimited.
+    size_t max_per_host = 0;
+    // Checks started against one host per second; 0 - unlimited.
+    double rate_per_host = 0;
+};
+
+// Queue of pending checks grouped by host. pop() goes round-robin over the
+// hosts and, within a host, over the requests that have URLs on it, so one
+// large request against a single origin neither floods that origin nor
+// delays everyone else. Not thread-safe: UrlParser calls it under its lock.
+class HostScheduler {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit HostScheduler(const HostLimits& limits = {});
+
+    void push(Url url);
+    // Next URL whose host is under both limits, if any.
+    std::optional<Url> pop(Clock::time_point now);
+    // Must be called for every popped URL once its check is over when the
+    // concurrency per host is capped; otherwise it does nothing.
+    void done(const Url& url);
+    [[nodiscard]] bool capsConcurrency() const { return limits.max_per_host > 0; }
+
+    // When a rate-limited host gets its next token, if one is only waiting
+    // for that; hosts at their concurrency cap wait for done() instead.
+    [[nodiscard]] std::optional<Clock::time_point> nextReady(Clock::time_point now) const;
+    [[nodiscard]] bool empty() const { return queued == 0; }
+    [[nodiscard]] size_t size() const { return queued; }
+
+    static std::string_view hostOf(std::string_view url);
+
+   private:
+    struct Host {
+        std::unordered_map<int, std::queue<Url>> requests;
+        // Requests with queued URLs, in round-robin order.
+        std::deque<int> request_ring;
+        size_t queued = 0;
+        size_t in_flight = 0;
+        double tokens = 0;
+        Clock::time_point refilled;
+        bool in_ring = false;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+    using HostMap = std::unordered_map<std::string, Host, KeyHash, std::equal_to<>>;
+
+    // Lower-cased host of the URL; scratch holds it only when the URL has
+    // upper-case letters in its host.
+    static std::string_view hostKey(std::string_view url, std::string& scratch);
+    bool isCapped(const Host& host) const {
+        return capsConcurrency() && host.in_flight >= limits.max_per_host;
+    }
+    [[nodiscard]] double tokensAt(const Host& host, Clock::time_point now) const;
+    [[nodiscard]] bool isReady(const Host& host) const;
+    [[nodiscard]] bool isIdle(const Host& host, Clock::time_point now) const;
+    void sweep(Clock::time_point now);
+
+    HostLimits limits;
+    double burst;
+    HostMap hosts;
+    // Hosts with queued URLs that are not at their concurrency cap, in
+    // round-robin order; capped hosts rejoin it from done(). Map nodes do
+    // not move, so the ring points at them.
+    std::deque<HostMap::value_type*> ring;
+    size_t queued = 0;
+    size_t pushes_since_sweep = 0;
+};
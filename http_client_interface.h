@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include "url.h"
 
 class HttpClientInterface {
    public:
@@ -8,4 +9,6 @@ class HttpClientInterface {
 
     [[nodiscard]] virtual size_t getHttpStatus() const = 0;
     [[nodiscard]] virtual long long getRequestTime() const = 0;
+    // Phase timings of the check getHttpStatus() performed.
+    [[nodiscard]] virtual PhaseTimings getTimings() const = 0;
 };
@@ -0,0 +1,225 @@
+#include "http_request_parser.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+constexpr std::string_view kHeadEnd = "\r\n\r\n";
+// Heads larger than this are rejected instead of buffered forever.
+constexpr size_t kMaxHeadSize = 64 * 1024;
+
+std::string_view trimView(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+}  // namespace
+
+bool iequals(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); i++) {
+        char l = lhs[i];
+        char r = rhs[i];
+        if (l >= 'A' && l <= 'Z') {
+            l += 'a' - 'A';
+        }
+        if (r >= 'A' && r <= 'Z') {
+            r += 'a' - 'A';
+        }
+        if (l != r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string_view> queryParameter(std::string_view query, std::string_view name) {
+    while (!query.empty()) {
+        size_t end = query.find('&');
+        std::string_view pair = query.substr(0, end);
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) == name) {
+            return equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(end + 1);
+    }
+    return std::nullopt;
+}
+
+ContentEncoding negotiateEncoding(std::string_view acceptEncoding) {
+    // q-values; -1 for a coding not listed.
+    double gzip = -1;
+    double deflate = -1;
+    double any = -1;
+    while (!acceptEncoding.empty()) {
+        const size_t comma = acceptEncoding.find(',');
+        const std::string_view item = acceptEncoding.substr(0, comma);
+        acceptEncoding.remove_prefix(comma == std::string_view::npos ? acceptEncoding.size() : comma + 1);
+        const size_t semicolon = item.find(';');
+        const std::string_view coding = trimView(item.substr(0, semicolon));
+        double q = 1;
+        if (semicolon != std::string_view::npos) {
+            const std::string_view param = trimView(item.substr(semicolon + 1));
+            // A weight that cannot be read makes the coding unacceptable.
+            q = 0;
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                std::from_chars(param.data() + 2, param.data() + param.size(), q);
+            }
+        }
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip")) {
+            gzip = q;
+        } else if (iequals(coding, "deflate")) {
+            deflate = q;
+        } else if (coding == "*") {
+            any = q;
+        }
+    }
+    gzip = gzip < 0 ? any : gzip;
+    deflate = deflate < 0 ? any : deflate;
+    if (gzip > 0 && gzip >= deflate) {
+        return ContentEncoding::Gzip;
+    }
+    return deflate > 0 ? ContentEncoding::Deflate : ContentEncoding::Identity;
+}
+
+std::optional<std::string> percentDecode(std::string_view value) {
+    const auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    };
+    std::string decoded;
+    decoded.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '+') {
+            decoded += ' ';
+        } else if (value[i] != '%') {
+            decoded += value[i];
+        } else {
+            if (i + 2 >= value.size()) {
+                return std::nullopt;
+            }
+            const int high = hex(value[i + 1]);
+            const int low = hex(value[i + 2]);
+            if (high < 0 || low < 0) {
+                return std::nullopt;
+            }
+            decoded += static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+    }
+    return decoded;
+}
+
+HttpRequestParser::Result HttpRequestParser::parse(std::string_view data) {
+    // Empty lines before a request line are ignored (RFC 9112, 2.2).
+    size_t start = 0;
+    while (data.substr(start, 2) == "\r\n") {
+        start += 2;
+    }
+    // Restart a few bytes back in case the terminator straddles two reads.
+    size_t from = scanned_ >= kHeadEnd.size() ? scanned_ - (kHeadEnd.size() - 1) : 0;
+    size_t end = data.find(kHeadEnd, std::max(from, start));
+    if (end == std::string_view::npos) {
+        scanned_ = data.size();
+        return data.size() > kMaxHeadSize ? Result::Bad : Result::Incomplete;
+    }
+    header_size_ = end + kHeadEnd.size();
+    scanned_ = header_size_;
+    request_ = HttpRequest{};
+    return parseHead(data.substr(start, end + 2 - start));
+}
+
+void HttpRequestParser::reset() {
+    request_ = HttpRequest{};
+    scanned_ = 0;
+    header_size_ = 0;
+}
+
+HttpRequestParser::Result HttpRequestParser::parseHead(std::string_view head) {
+    size_t line_end = head.find("\r\n");
+    if (!parseRequestLine(head.substr(0, line_end))) {
+        return Result::Bad;
+    }
+    head.remove_prefix(line_end + 2);
+    while (!head.empty()) {
+        line_end = head.find("\r\n");
+        if (!parseHeader(head.substr(0, line_end))) {
+            return Result::Bad;
+        }
+        head.remove_prefix(line_end + 2);
+    }
+    return Result::Complete;
+}
+
+bool HttpRequestParser::parseRequestLine(std::string_view line) {
+    size_t method_end = line.find(' ');
+    if (method_end == std::string_view::npos || method_end == 0) {
+        return false;
+    }
+    size_t target_end = line.find(' ', method_end + 1);
+    if (target_end == std::string_view::npos || target_end == method_end + 1) {
+        return false;
+    }
+    request_.method = line.substr(0, method_end);
+    request_.target = line.substr(method_end + 1, target_end - method_end - 1);
+    request_.version = line.substr(target_end + 1);
+
+    size_t query_start = request_.target.find('?');
+    request_.path = request_.target.substr(0, query_start);
+    if (query_start != std::string_view::npos) {
+        request_.query = request_.target.substr(query_start + 1);
+    }
+    return true;
+}
+
+bool HttpRequestParser::parseHeader(std::string_view line) {
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return false;
+    }
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = trimView(line.substr(colon + 1));
+
+    if (iequals(name, "Content-Length")) {
+        // Conflicting lengths leave the end of the body in doubt.
+        size_t length = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+        if (ec != std::errc() || ptr != value.data() + value.size() ||
+            (request_.has_content_length && length != request_.content_length)) {
+            return false;
+        }
+        request_.content_length = length;
+        request_.has_content_length = true;
+        return true;
+    }
+    if (iequals(name, "Content-Type")) {
+        request_.content_type = value;
+    } else if (iequals(name, "Connection")) {
+        request_.connection = value;
+    } else if (iequals(name, "X-Client-Id")) {
+        request_.client_id = value;
+    } else if (iequals(name, "Accept-Encoding")) {
+        request_.accept_encoding = value;
+    } else if (iequals(name, "Transfer-Encoding")) {
+        request_.transfer_encoding = value;
+    }
+    return true;
+}
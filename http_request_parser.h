@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Request head as views into the receive buffer; valid until the buffer is
+// modified.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;
+    std::string_view path;
+    std::string_view query;
+    std::string_view version;
+    std::string_view content_type;
+    std::string_view connection;
+    // X-Client-Id: whose quota the request counts against.
+    std::string_view client_id;
+    std::string_view accept_encoding;
+    // Bodies are only ever framed by Content-Length; a request with any
+    // Transfer-Encoding is refused rather than misread.
+    std::string_view transfer_encoding;
+    size_t content_length = 0;
+    bool has_content_length = false;
+};
+
+// Incremental parser for the request line and headers. It allocates nothing:
+// repeated calls on a growing buffer resume the search for the end of the
+// head where the previous call stopped, and the parsed fields point into
+// the buffer itself.
+class HttpRequestParser {
+   public:
+    enum class Result { Complete, Incomplete, Bad };
+
+    Result parse(std::string_view data);
+    void reset();
+
+    [[nodiscard]] const HttpRequest& request() const { return request_; }
+    // Size of the request head including the empty line, once Complete.
+    [[nodiscard]] size_t headerSize() const { return header_size_; }
+
+   private:
+    Result parseHead(std::string_view head);
+    bool parseRequestLine(std::string_view line);
+    bool parseHeader(std::string_view line);
+
+    HttpRequest request_;
+    size_t scanned_ = 0;
+    size_t header_size_ = 0;
+};
+
+bool iequals(std::string_view lhs, std::string_view rhs);
+
+// Raw value of the first name=value pair in a query string.
+std::optional<std::string_view> queryParameter(std::string_view query, std::string_view name);
+// Codings a response body may be sent in.
+enum class ContentEncoding { Identity, Gzip, Deflate };
+
+// The coding of Accept-Encoding with the highest q-value, gzip on a tie;
+// Identity when neither gzip nor deflate is acceptable.
+ContentEncoding negotiateEncoding(std::string_view acceptEncoding);
+
+// Decodes %XX escapes and '+' of a query value; nullopt for a malformed
+// escape.
+std::optional<std::string> percentDecode(std::string_view value);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+enum class Route { GetResults, CheckUrls, Events, Stats, AddSchedules, RemoveSchedules, Metrics };
+
+struct RouteEntry {
+    std::string_view method;
+    std::string_view path;
+    // Prefix routes take a parameter in the rest of the path.
+    bool is_prefix;
+    Route route;
+};
+
+inline constexpr std::array<RouteEntry, 7> kRoutes{{
+    {"GET", "/get_results/", true, Route::GetResults},
+    {"POST", "/check_urls", false, Route::CheckUrls},
+    {"GET", "/events/", true, Route::Events},
+    {"GET", "/stats", false, Route::Stats},
+    {"POST", "/schedules", false, Route::AddSchedules},
+    {"DELETE", "/schedules/", true, Route::RemoveSchedules},
+    {"GET", "/metrics", false, Route::Metrics},
+}};
+
+constexpr const RouteEntry* findRoute(std::string_view method, std::string_view path) {
+    for (const auto& entry : kRoutes) {
+        if (entry.method != method) {
+            continue;
+        }
+        if (entry.is_prefix ? path.substr(0, entry.path.size()) == entry.path
+                            : path == entry.path) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
@@ -1,180 +1,1187 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <nlohmann/json.hpp>
-#include <regex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include "compression.h"
 #include "database_interface.h"
 #include "http_client_interface.h"
+#include "http_request_parser.h"
+#include "http_routes.h"
+#include "metrics.h"
+#include "monitor_scheduler.h"
+#include "result_cache.h"
+#include "result_json.h"
 #include "url_parser.h"
-#include "utils.h"
+#include "url_stream_parser.h"
 
 using boost::asio::ip::tcp;
 using json = nlohmann::json;
 
+struct HttpServerConfig {
+    // Threads of the pool that runs routing and database calls.
+    size_t blocking_threads = 4;
+    // How long a persistent connection may wait for its next request.
+    std::chrono::seconds keep_alive_timeout{5};
+    // Requests served on one connection before it is closed.
+    size_t keep_alive_max = 100;
+    // Budget of the cache of completed /get_results bodies; 0 disables it.
+    size_t result_cache_bytes = 64 * 1024 * 1024;
+    // Larger request bodies are answered 413 without being read (0 -
+    // unbounded).
+    size_t max_body_bytes = 256 * 1024 * 1024;
+    // URLs of a /check_urls body still being read that are admitted and
+    // queued together.
+    size_t ingest_chunk_urls = 1000;
+    // Whether /check_urls keeps the body with the request.
+    bool store_request_bodies = true;
+    // zlib level of the responses sent compressed to the clients that take
+    // gzip or deflate, 1-9 (0 - responses are never compressed).
+    int compression_level = 6;
+    // Smaller bodies are sent as they are; streamed results are compressed
+    // whatever their size.
+    size_t compression_min_bytes = 1024;
+};
+
+struct HttpResponse {
+    enum class Kind {
+        Body,
+        // The request's results are streamed page by page with chunked
+        // encoding instead of being sent in body.
+        ResultStream,
+        // Server-Sent Events with the results as they are checked.
+        EventStream,
+        // The /check_urls body is still being read; the session reads on
+        // and answers once it is scanned to the end.
+        Ingest,
+    };
+
+    std::string status;
+    std::string body;
+    Kind kind = Kind::Body;
+    int request_id = 0;
+    std::string_view content_type = "application/json; charset=UTF-8";
+    // Extra header lines, each ending with \r\n.
+    std::string headers = "";
+    // Coding body is already in.
+    ContentEncoding encoding = ContentEncoding::Identity;
+};
+
 class HttpSession : public std::enable_shared_from_this<HttpSession> {
    public:
-    HttpSession(tcp::socket socket, const std::shared_ptr<UrlParser>& urlParser, const std::shared_ptr<DatabaseInterface>& db)
-        : socket_(std::move(socket)), url_parser(urlParser), db(db) {}
+    HttpSession(tcp::socket socket, const std::shared_ptr<UrlParser>& urlParser, const std::shared_ptr<DatabaseInterface>& db,
+                const std::shared_ptr<ResultCache>& resultCache, const std::shared_ptr<MonitorScheduler>& scheduler,
+                boost::asio::thread_pool::executor_type blockingExecutor, const HttpServerConfig& config)
+        : socket_(std::move(socket)),
+          idle_timer_(socket_.get_executor()),
+          wait_timer_(socket_.get_executor()),
+          url_parser(urlParser),
+          db(db),
+          result_cache(resultCache),
+          scheduler(scheduler),
+          blocking_executor(blockingExecutor),
+          config_(config) {}
 
-    void start() { read_request(); }
+    ~HttpSession() {
+        if (listener_id_ != 0) {
+            url_parser->tracker()->unlisten(listen_request_id_, listener_id_);
+        }
+    }
+
+    void start() { wait_for_request(); }
 
    private:
+    static constexpr size_t kReadSize = 4096;
+    static constexpr size_t kIngestReadSize = 64 * 1024;
+    // Bodies kept while they are read are deflated at the fastest level, so
+    // that the compression keeps pace with the scan.
+    static constexpr int kIngestCompressionLevel = 1;
+    static constexpr size_t kDefaultPageSize = 1000;
+    static constexpr size_t kMaxPageSize = 10000;
+    static constexpr size_t kStreamPageSize = 1000;
+    static constexpr std::chrono::milliseconds kMaxWait{60000};
+    // Events an event stream client may lag behind before its result events
+    // give way to the latest progress.
+    static constexpr size_t kMaxQueuedEvents = 1024;
+    static constexpr std::chrono::milliseconds kCreationRetry{10};
+
+    void wait_for_request() {
+        auto self(shared_from_this());
+        idle_timer_.expires_after(config_.keep_alive_timeout);
+        idle_timer_.async_wait([this, self](boost::system::error_code ec) {
+            if (!ec) {
+                boost::system::error_code ignored;
+                socket_.close(ignored);
+            }
+        });
+        read_request();
+    }
+
+    // A pipelined request may already be waiting in buffer_, so parse what
+    // is there before reading from the socket.
     void read_request() {
+        switch (parser_.parse(buffer_)) {
+            case HttpRequestParser::Result::Complete:
+                idle_timer_.cancel();
+                read_body();
+                return;
+            case HttpRequestParser::Result::Bad:
+                idle_timer_.cancel();
+                keep_alive_ = false;
+                write_response("400 Bad Request", R"({"error": "Bad Request"})");
+                return;
+            case HttpRequestParser::Result::Incomplete:
+                break;
+        }
+        auto self(shared_from_this());
+        const size_t size = buffer_.size();
+        buffer_.resize(size + kReadSize);
+        socket_.async_read_some(
+            boost::asio::buffer(buffer_.data() + size, kReadSize),
+            [this, self, size](boost::system::error_code ec, std::size_t bytes) {
+                buffer_.resize(size + bytes);
+                if (!ec) {
+                    read_request();
+                }
+            });
+    }
+
+    void read_body() {
+        const HttpRequest& request = parser_.request();
+        keep_alive_ = (request.version == "HTTP/1.1") ? !iequals(request.connection, "close")
+                                                      : iequals(request.connection, "keep-alive");
+        encoding_ = config_.compression_level > 0 ? negotiateEncoding(request.accept_encoding)
+                                                  : ContentEncoding::Identity;
+        requests_served_++;
+        if (requests_served_ >= config_.keep_alive_max) {
+            keep_alive_ = false;
+        }
+
+        request_size_ = parser_.headerSize() + request.content_length;
+        // A chunked body would be read as the next request on the
+        // connection, so it is refused and the connection closed.
+        if (!request.transfer_encoding.empty()) {
+            keep_alive_ = false;
+            if (!request.has_content_length) {
+                write_response("411 Length Required", R"({"error": "Length Required"})");
+            } else {
+                write_response("501 Not Implemented", R"({"error": "Transfer-Encoding not supported"})");
+            }
+            return;
+        }
+        if (config_.max_body_bytes > 0 && request.content_length > config_.max_body_bytes) {
+            keep_alive_ = false;
+            write_response("413 Payload Too Large", R"({"error": "Request body too large"})");
+            return;
+        }
+        const size_t size = buffer_.size();
+        // The /check_urls body is scanned piece by piece as it is read, so
+        // only what already came with the head is in buffer_.
+        const RouteEntry* entry = findRoute(request.method, request.path);
+        if (entry != nullptr && entry->route == Route::CheckUrls) {
+            body_unread_ = request_size_ - std::min(size, request_size_);
+            handle_request();
+            return;
+        }
+        if (size >= request_size_) {
+            handle_request();
+            return;
+        }
+        // Grow the buffer once to fit the whole request and parse the head
+        // again, so its views point at storage that stays put while the body
+        // is read into the rest of it.
+        buffer_.resize(request_size_);
+        parser_.reset();
+        parser_.parse(buffer_);
+
         auto self(shared_from_this());
-        boost::asio::async_read_until(
-            socket_, buffer_, "\r\n\r\n",
+        boost::asio::async_read(
+            socket_, boost::asio::buffer(buffer_.data() + size, request_size_ - size),
             [this, self](boost::system::error_code ec, std::size_t) {
                 if (!ec) {
-                    std::istream request_stream(&buffer_);
-                    request_stream >> method_ >> uri_ >> version_;
+                    handle_request();
+                }
+            });
+    }
 
-                    std::string line;
-                    std::getline(request_stream, line);
+    // The part of the body in buffer_, all of it unless it is streamed.
+    [[nodiscard]] std::string_view body() const {
+        return std::string_view(buffer_).substr(parser_.headerSize(), parser_.request().content_length);
+    }
 
-                    std::string header;
-                    while (std::getline(request_stream, header)) {
-                        if (!header.empty() && header.back() == '\r') {
-                            header.pop_back();
-                        }
-                        if (header.empty()) {
-                            break;
-                        }
-                        if (header.find("Content-Length:") == 0) {
-                            content_length_ = std::stoi(header.substr(15));
-                        }
-                        if (header.find("Content-Type:") == 0) {
-                            content_type_ = header.substr(13);
-                            trim(content_type_);
-                        }
-                    }
+    void reset() {
+        buffer_.erase(0, std::min(request_size_, buffer_.size()));
+        parser_.reset();
+        response_.clear();
+        request_size_ = 0;
+        body_unread_ = 0;
+        ingest_.reset();
+        busy_ = {};
+        encoding_ = ContentEncoding::Identity;
+        deflater_.reset();
+        keep_alive_ = false;
+    }
 
-                    if (method_ == "POST" && content_length_ > 0) {
-                        read_body();
-                    } else {
-                        handle_request();
-                    }
+    // Routing touches the database and parses JSON, so it runs on the
+    // blocking pool; only the socket I/O stays on the session's strand.
+    void handle_request() {
+        if (!wait_for_completion()) {
+            route_request();
+        }
+    }
+
+    void route_request() {
+        run_blocking([this] { return route(); });
+    }
+
+    // Runs a step of the request on the blocking pool and goes on with what
+    // it answers. The time of every step of a request counts as its
+    // duration.
+    template <typename Step>
+    void run_blocking(Step step) {
+        auto self(shared_from_this());
+        boost::asio::post(blocking_executor, [this, self, step = std::move(step)] {
+            const auto started = std::chrono::steady_clock::now();
+            HttpResponse response = step();
+            if (response.kind == HttpResponse::Kind::Body && response.encoding == ContentEncoding::Identity &&
+                compresses(response.body.size())) {
+                response.body = encode(response.body);
+                response.encoding = encoding_;
+            }
+            busy_ += std::chrono::steady_clock::now() - started;
+            if (response.kind != HttpResponse::Kind::Ingest) {
+                metrics().http_request_duration.observe(busy_);
+            }
+            boost::asio::post(socket_.get_executor(), [this, self, response = std::move(response)] {
+                switch (response.kind) {
+                    case HttpResponse::Kind::Body:
+                        write_response(response.status, response.body, response.content_type, response.headers,
+                                       response.encoding);
+                        break;
+                    case HttpResponse::Kind::ResultStream:
+                        start_stream(response.request_id);
+                        break;
+                    case HttpResponse::Kind::EventStream:
+                        start_events(response.request_id);
+                        break;
+                    case HttpResponse::Kind::Ingest:
+                        read_ingest();
+                        break;
                 }
             });
+        });
     }
 
-    void read_body() {
+    // Long-poll: /get_results/{id}?wait=<ms> is held until the request is
+    // complete or the wait expires, and then answered as usual.
+    bool wait_for_completion() {
+        const HttpRequest& request = parser_.request();
+        const RouteEntry* entry = findRoute(request.method, request.path);
+        auto wait = queryParameter(request.query, "wait");
+        if (entry == nullptr || entry->route != Route::GetResults || !wait) {
+            return false;
+        }
+        auto request_id = parse_request_id(request.path.substr(entry->path.size()));
+        size_t wait_ms = 0;
+        if (!request_id || !parse_number(*wait, wait_ms) || wait_ms == 0) {
+            return false;
+        }
+        wait_deadline_ = std::chrono::steady_clock::now() +
+                         std::min<std::chrono::milliseconds>(std::chrono::milliseconds(wait_ms), kMaxWait);
+        return listen_for_completion(*request_id);
+    }
+
+    bool listen_for_completion(int request_id) {
         auto self(shared_from_this());
-        std::size_t bytes_already_in_buffer = buffer_.size();
-        std::size_t bytes_to_read =
-            (content_length_ > bytes_already_in_buffer)
-                ? (content_length_ - bytes_already_in_buffer)
-                : 0;
-
-        if (bytes_to_read > 0) {
-            boost::asio::async_read(
-                socket_, buffer_, boost::asio::transfer_exactly(bytes_to_read),
-                [this, self](boost::system::error_code ec, std::size_t) {
-                    if (!ec) {
-                        std::istream body_stream(&buffer_);
-                        body_.assign(std::istreambuf_iterator<char>(body_stream), {});
-                        handle_request();
+        std::weak_ptr<HttpSession> weak = self;
+        const size_t wait = ++wait_generation_;
+        listener_id_ = url_parser->tracker()->listen(request_id, [weak, wait](const RequestTracker::Event& event) {
+            if (!event.complete) {
+                return;
+            }
+            // The listener runs with the tracker locked, so the session it
+            // holds goes with the handler: dropping the last reference here
+            // would unlisten from the destructor on the same lock.
+            if (auto session = weak.lock()) {
+                auto executor = session->socket_.get_executor();
+                boost::asio::post(executor, [session = std::move(session), wait] {
+                    // Completion racing the deadline must not cut short the
+                    // next wait on the connection.
+                    if (session->wait_generation_ == wait) {
+                        session->wait_timer_.cancel();
                     }
                 });
-        } else {
-            std::istream body_stream(&buffer_);
-            body_.assign(std::istreambuf_iterator<char>(body_stream), {});
-            handle_request();
+            }
+        });
+        if (listener_id_ == 0) {
+            // A request still being created cannot be listened to yet, and
+            // is looked up again shortly rather than taken for complete.
+            const auto now = std::chrono::steady_clock::now();
+            if (!url_parser->tracker()->progress(request_id) || now >= wait_deadline_) {
+                return false;
+            }
+            wait_timer_.expires_at(std::min(now + kCreationRetry, wait_deadline_));
+            wait_timer_.async_wait([this, self, request_id](boost::system::error_code) {
+                if (!listen_for_completion(request_id)) {
+                    route_request();
+                }
+            });
+            return true;
         }
+        listen_request_id_ = request_id;
+        wait_timer_.expires_at(wait_deadline_);
+        wait_timer_.async_wait([this, self](boost::system::error_code) {
+            url_parser->tracker()->unlisten(listen_request_id_, listener_id_);
+            listener_id_ = 0;
+            wait_generation_++;
+            route_request();
+        });
+        return true;
     }
 
-    void handle_request() {
-        std::string response_body;
-        std::string status = "200 OK";
-
-        if (method_ == "GET") {
-            std::regex get_results_pattern("^/get_results/(\\d{1,9})$");
-            std::smatch matches;
-
-            if (std::regex_match(uri_, matches, get_results_pattern)) {
-                std::string id = matches[1].str();
-                int request_id = std::stoi(id);
-
-                if (!db->requestIdExists(request_id)) {
-                    status = "404 Not Found";
-                    response_body = R"({"error": "Request ID not found"})";
-                } else {
-                    json response_json = {{"request_id", id}};
-                    std::vector<Url> urls = db->find(request_id);
-                    for (const auto& url : urls) {
-                        response_json["urls"].push_back(
-                            {{"url", url.url},
-                             {"http_status", url.http_status},
-                             {"response_time", url.response_time},
-                             {"created_at", url.created_at}});
+    HttpResponse route() {
+        const HttpRequest& request = parser_.request();
+        if (request.method != "GET" && request.method != "POST" && request.method != "DELETE") {
+            return {"405 Method Not Allowed", R"({"error": "Method Not Allowed"})"};
+        }
+        if (request.method == "POST" && request.content_type.find("application/json") == std::string_view::npos) {
+            return {"415 Unsupported Media Type", R"({"error": "Unsupported Media Type"})"};
+        }
+        const RouteEntry* entry = findRoute(request.method, request.path);
+        if (entry == nullptr) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        switch (entry->route) {
+            case Route::GetResults:
+                return get_results(request.path.substr(entry->path.size()));
+            case Route::CheckUrls:
+                return check_urls();
+            case Route::Events:
+                return events(request.path.substr(entry->path.size()));
+            case Route::Stats:
+                return stats();
+            case Route::AddSchedules:
+                return add_schedules();
+            case Route::RemoveSchedules:
+                return remove_schedules(request.path.substr(entry->path.size()));
+            case Route::Metrics:
+                return metrics_text();
+        }
+        return {"404 Not Found", R"({"error": "Not Found"})"};
+    }
+
+    static std::optional<int> parse_request_id(std::string_view id) {
+        int request_id = 0;
+        if (id.empty() || id.size() > 9 || id.front() == '-' || !parse_number(id, request_id)) {
+            return std::nullopt;
+        }
+        return request_id;
+    }
+
+    HttpResponse get_results(std::string_view id) {
+        auto parsed_id = parse_request_id(id);
+        if (!parsed_id) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        const int request_id = *parsed_id;
+        const std::string_view query = parser_.request().query;
+        auto after = queryParameter(query, "after");
+        auto limit = queryParameter(query, "limit");
+        size_t wait_ms = 0;
+        if (auto wait = queryParameter(query, "wait"); wait && !parse_number(*wait, wait_ms)) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        const bool stream = queryParameter(query, "stream").has_value();
+        auto filter = parse_filter(query);
+        if (!filter) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        result_filter_ = *filter;
+        // Results of a schedule keep growing, so they are never complete.
+        const bool cacheable = result_cache && !stream && !after && !limit && filter->empty() &&
+                               !(scheduler && scheduler->isScheduled(request_id));
+        if (cacheable) {
+            // One lookup however it is found, so the hit rate is per request.
+            auto found = result_cache->getOrPlain(request_id, static_cast<int>(encoding_));
+            if (found.body && found.variant != 0) {
+                HttpResponse response{"200 OK", *found.body};
+                response.encoding = encoding_;
+                return response;
+            }
+            if (found.body) {
+                return cache_encoded(request_id, *found.body);
+            }
+        }
+        if (!db->requestIdExists(request_id)) {
+            return {"404 Not Found", R"({"error": "Request ID not found"})"};
+        }
+
+        if (stream) {
+            return {"200 OK", "", HttpResponse::Kind::ResultStream, request_id};
+        }
+        if (after || limit || !filter->empty()) {
+            return get_results_page(request_id, id, after, limit);
+        }
+
+        // Checked before reading, so a request that completes meanwhile is
+        // not cached with only part of its results. One still being created
+        // has progress too.
+        auto progress = url_parser->tracker()->progress(request_id);
+        std::string response_body = resultsJson(id, progress, db->find(request_id));
+        if (cacheable && !progress) {
+            result_cache->put(request_id, response_body);
+            return cache_encoded(request_id, std::move(response_body));
+        }
+        return {"200 OK", std::move(response_body)};
+    }
+
+    // A cached body compressed for the client; the compressed form is
+    // cached next to it, so the next hit is not compressed again.
+    HttpResponse cache_encoded(int request_id, std::string body) {
+        if (!compresses(body.size())) {
+            return {"200 OK", std::move(body)};
+        }
+        HttpResponse response{"200 OK", encode(body)};
+        response.encoding = encoding_;
+        result_cache->put(request_id, response.body, static_cast<int>(encoding_));
+        return response;
+    }
+
+    // Whether a body of size bytes goes to the client compressed.
+    [[nodiscard]] bool compresses(size_t size) const {
+        return encoding_ != ContentEncoding::Identity && size >= config_.compression_min_bytes;
+    }
+
+    [[nodiscard]] std::string encode(std::string_view body) const {
+        return compress(body, config_.compression_level, compression_format());
+    }
+
+    [[nodiscard]] CompressionFormat compression_format() const {
+        return encoding_ == ContentEncoding::Gzip ? CompressionFormat::Gzip : CompressionFormat::Zlib;
+    }
+
+    static std::string encoding_header(ContentEncoding encoding) {
+        return encoding == ContentEncoding::Gzip ? "Content-Encoding: gzip\r\n" : "Content-Encoding: deflate\r\n";
+    }
+
+    // Keyset pagination: the page holds results with id greater than
+    // `after` that pass the phase filter, and next_after is set while more
+    // may follow.
+    HttpResponse get_results_page(int request_id, std::string_view id,
+                                  std::optional<std::string_view> after,
+                                  std::optional<std::string_view> limit) {
+        long long after_id = 0;
+        size_t page_size = kDefaultPageSize;
+        if ((after && !parse_number(*after, after_id)) ||
+            (limit && (!parse_number(*limit, page_size) || page_size == 0))) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        page_size = std::min(page_size, kMaxPageSize);
+
+        json response_json = {{"request_id", id}, {"urls", json::array()}};
+        std::vector<Url> urls = db->find(request_id, after_id, page_size, result_filter_);
+        for (const auto& url : urls) {
+            response_json["urls"].push_back(urlJson(url));
+        }
+        if (urls.size() == page_size) {
+            response_json["next_after"] = urls.back().id;
+        }
+        return {"200 OK", response_json.dump()};
+    }
+
+    // min_<phase>=<us> and max_<phase>=<us>, e.g. min_connect_us=50000,
+    // keep the results whose phase timing is within the bounds; nullopt if
+    // a bound is not a number.
+    static std::optional<ResultFilter> parse_filter(std::string_view query) {
+        ResultFilter filter;
+        for (size_t i = 0; i < kPhases.size(); i++) {
+            const std::string name(kPhases[i].first);
+            for (auto [prefix, bound] : {std::pair{"min_", &filter.min_us[i]}, std::pair{"max_", &filter.max_us[i]}}) {
+                if (auto value = queryParameter(query, prefix + name)) {
+                    long long micros = 0;
+                    if (!parse_number(*value, micros)) {
+                        return std::nullopt;
                     }
-                    response_body = response_json.dump();
+                    *bound = micros;
                 }
-            } else {
-                status = "404 Not Found";
-                response_body = R"({"error": "Not Found"})";
-            }
-        } else if (method_ == "POST") {
-            if (content_type_.find("application/json") != std::string::npos) {
-                if (uri_ == "/check_urls") {
-                    try {
-                        json parsed = json::parse(body_);
-                        int requestId = db->getRequestId(body_);
-                        std::vector<std::string> urls;
-                        for (const auto& url_obj : parsed["urls"]) {
-                            urls.push_back(url_obj["url"].get<std::string>());
+            }
+        }
+        return filter;
+    }
+
+    template <typename T>
+    static bool parse_number(std::string_view value, T& number) {
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+        return !value.empty() && ec == std::errc() && ptr == value.data() + value.size();
+    }
+
+    // Streams the results page by page from the database, so memory stays
+    // flat however many rows the request has.
+    void start_stream(int request_id) {
+        std::string head = R"({"request_id": ")" + std::to_string(request_id) + R"(", "urls": [)";
+        std::string encoding_headers;
+        if (config_.compression_level > 0) {
+            encoding_headers = "Vary: Accept-Encoding\r\n";
+        }
+        // Every page is flushed through the stream, so the client can
+        // inflate each chunk as it arrives.
+        if (encoding_ != ContentEncoding::Identity) {
+            deflater_ = std::make_unique<Deflater>(compression_format(), config_.compression_level);
+            encoding_headers += encoding_header(encoding_);
+            head = deflater_->write(head);
+        }
+        response_ = "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: application/json; charset=UTF-8\r\n"
+                    "Transfer-Encoding: chunked\r\n" +
+                    encoding_headers +
+                    connection_header() +
+                    "\r\n" +
+                    chunk(head);
+
+        auto self(shared_from_this());
+        boost::asio::async_write(
+            socket_, boost::asio::buffer(response_),
+            [this, self, request_id](boost::system::error_code ec, std::size_t) {
+                if (ec) {
+                    finish_response(ec);
+                    return;
+                }
+                stream_page(request_id, 0);
+            });
+    }
+
+    void stream_page(int request_id, long long after_id) {
+        auto self(shared_from_this());
+        boost::asio::post(blocking_executor, [this, self, request_id, after_id] {
+            std::vector<Url> urls = db->find(request_id, after_id, kStreamPageSize, result_filter_);
+            std::string page;
+            for (const auto& url : urls) {
+                if (after_id != 0 || !page.empty()) {
+                    page += ',';
+                }
+                page += urlJson(url).dump();
+            }
+            const bool is_last = urls.size() < kStreamPageSize;
+            const long long next_after = urls.empty() ? after_id : urls.back().id;
+            if (is_last) {
+                page += "]}";
+            }
+            if (deflater_) {
+                page = deflater_->write(page, is_last);
+            }
+
+            boost::asio::post(socket_.get_executor(), [this, self, request_id, next_after, is_last, page = std::move(page)] {
+                // An empty chunk would end the body.
+                response_ = page.empty() ? std::string() : chunk(page);
+                if (is_last) {
+                    response_ += "0\r\n\r\n";
+                }
+                boost::asio::async_write(
+                    socket_, boost::asio::buffer(response_),
+                    [this, self, request_id, next_after, is_last](boost::system::error_code ec, std::size_t) {
+                        if (ec || is_last) {
+                            finish_response(ec);
+                        } else {
+                            stream_page(request_id, next_after);
                         }
-                        url_parser->addUrls(requestId, urls);
-                        response_body = R"({"status": "OK", "request_id": )" +
-                                        std::to_string(requestId) +
-                                        R"(, "count_urls": )" +
-                                        std::to_string(urls.size()) + "}";
-                    } catch (const std::exception& e) {
-                        status = "400 Bad Request";
-                        response_body = R"({"error": "Bad Request"})";
+                    });
+            });
+        });
+    }
+
+    HttpResponse events(std::string_view id) {
+        auto request_id = parse_request_id(id);
+        if (!request_id) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        if (!db->requestIdExists(*request_id)) {
+            return {"404 Not Found", R"({"error": "Request ID not found"})"};
+        }
+        return {"200 OK", "", HttpResponse::Kind::EventStream, *request_id};
+    }
+
+    // Server-Sent Events: a progress snapshot, then a result event for every
+    // URL as its check is stored, and a complete event, after which the
+    // connection is closed. Results stored before the subscription are
+    // counted in the snapshot and can be read from /get_results, as are the
+    // ones skipped for a client that does not keep up.
+    void start_events(int request_id) {
+        keep_alive_ = false;
+        events_.push_back("HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/event-stream\r\n"
+                          "Cache-Control: no-cache\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+
+        auto self(shared_from_this());
+        std::weak_ptr<HttpSession> weak = self;
+        listener_id_ = url_parser->tracker()->listen(request_id, [weak, request_id](const RequestTracker::Event& event) {
+            auto session = weak.lock();
+            if (!session) {
+                return;
+            }
+            json progress = progressJson(event.progress);
+            progress["request_id"] = request_id;
+            std::string progress_text = sse_event("progress", progress.dump());
+            std::string text;
+            if (event.result == nullptr) {
+                text = progress_text;
+            } else {
+                text = sse_event("result", json{{"url", event.result->url},
+                                                {"http_status", event.result->http_status},
+                                                {"response_time", event.result->response_time}}
+                                               .dump());
+            }
+            if (event.complete) {
+                text += sse_event("complete", progress.dump());
+            }
+            // Moved into the handler, so it is never released under the
+            // tracker lock (see listen_for_completion).
+            auto executor = session->socket_.get_executor();
+            boost::asio::post(executor, [session = std::move(session), text = std::move(text),
+                                         progress_text = std::move(progress_text),
+                                         complete = event.complete]() mutable {
+                session->push_event(std::move(text), std::move(progress_text), complete);
+            });
+        });
+        if (listener_id_ == 0) {
+            push_event(sse_event("complete", json{{"request_id", request_id}}.dump()), {}, true);
+        } else {
+            listen_request_id_ = request_id;
+            write_events();
+        }
+        watch_disconnect();
+    }
+
+    static std::string sse_event(std::string_view name, const std::string& data) {
+        return "event: " + std::string(name) + "\ndata: " + data + "\n\n";
+    }
+
+    // Once kMaxQueuedEvents wait for a slow client, further events are
+    // dropped and only the latest progress is kept, written after them. The
+    // last event is always queued and carries the final progress itself.
+    void push_event(std::string event, std::string progress, bool last) {
+        if (last || events_.size() < kMaxQueuedEvents) {
+            events_.push_back(std::move(event));
+        } else {
+            skipped_progress_ = std::move(progress);
+        }
+        if (last) {
+            skipped_progress_.clear();
+        }
+        events_done_ = events_done_ || last;
+        if (!writing_events_) {
+            write_events();
+        }
+    }
+
+    void write_events() {
+        if (events_.empty() && skipped_progress_.empty()) {
+            if (events_done_) {
+                finish_response({});
+            }
+            return;
+        }
+        response_.clear();
+        while (!events_.empty()) {
+            response_ += events_.front();
+            events_.pop_front();
+        }
+        response_ += skipped_progress_;
+        skipped_progress_.clear();
+        writing_events_ = true;
+        auto self(shared_from_this());
+        boost::asio::async_write(
+            socket_, boost::asio::buffer(response_),
+            [this, self](boost::system::error_code ec, std::size_t) {
+                writing_events_ = false;
+                if (ec) {
+                    finish_response(ec);
+                    return;
+                }
+                write_events();
+            });
+    }
+
+    // Nothing more is expected from an event stream client; the pending read
+    // keeps the session alive and ends it when the client goes away.
+    void watch_disconnect() {
+        auto self(shared_from_this());
+        buffer_.resize(kReadSize);
+        socket_.async_read_some(
+            boost::asio::buffer(buffer_),
+            [this, self](boost::system::error_code ec, std::size_t) {
+                if (ec) {
+                    boost::system::error_code ignored;
+                    socket_.close(ignored);
+                    return;
+                }
+                watch_disconnect();
+            });
+    }
+
+    static std::string chunk(const std::string& data) {
+        char size[20];
+        auto [end, ec] = std::to_chars(size, size + sizeof(size), data.size(), 16);
+        return std::string(size, end) + "\r\n" + data + "\r\n";
+    }
+
+    HttpResponse stats() {
+        const std::string_view query = parser_.request().query;
+        if (auto url = queryParameter(query, "url")) {
+            return url_stats(*url);
+        }
+        // Counting the stored results scans them, so it is asked for with
+        // since=<epoch ms>.
+        long long since_ms = 0;
+        auto since = queryParameter(query, "since");
+        if (since && !parse_number(*since, since_ms)) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        const auto checks = url_parser->checkStats();
+        json response_json = {{"checks",
+                               {{"requested", checks.requested},
+                                {"checked", checks.checked},
+                                {"joined", checks.joined},
+                                {"cached", checks.cached},
+                                {"dedup_ratio", checks.dedupRatio()}}}};
+        const auto admission = url_parser->admission()->stats();
+        response_json["admission"] = {{"pending_urls", admission.pending_urls},
+                                      {"pending_bytes", admission.pending_bytes},
+                                      {"rejected_queue_full", admission.rejected_full},
+                                      {"rejected_quota", admission.rejected_quota},
+                                      {"rejected_too_large", admission.rejected_too_large}};
+        response_json["urls_tracked"] = url_parser->urlStats()->size();
+        if (since) {
+            const auto totals = db->totals(since_ms);
+            if (!totals) {
+                return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+            }
+            response_json["results"] = {{"stored", totals->results},
+                                        {"successes", totals->successes},
+                                        {"response_time_ms", totals->response_time_ms}};
+        }
+        return {"200 OK", response_json.dump()};
+    }
+
+    // Rolling aggregates of one URL, given percent-encoded.
+    HttpResponse url_stats(std::string_view encoded) {
+        const auto url = percentDecode(encoded);
+        if (!url || url->empty()) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        const auto summary = url_parser->urlStats()->summary(*url);
+        if (!summary) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        json windows = json::object();
+        for (const auto& window : *summary) {
+            windows[std::string(window.name)] = {{"checks", window.checks},
+                                                 {"success_ratio", window.successRatio()},
+                                                 {"p50_us", window.p50_us},
+                                                 {"p95_us", window.p95_us},
+                                                 {"p99_us", window.p99_us}};
+        }
+        return {"200 OK", json{{"url", *url}, {"windows", std::move(windows)}}.dump()};
+    }
+
+    // Prometheus scrape; the per-thread shards are summed only here.
+    HttpResponse metrics_text() {
+        MetricsWriter writer;
+        writer.write(metrics());
+        writer.gauge("monitoring_queue_depth", "URLs waiting for a worker.",
+                     static_cast<double>(url_parser->queueDepth()));
+        writer.gauge("monitoring_workers", "Worker threads checking URLs.",
+                     static_cast<double>(url_parser->threadCount()));
+        const auto checks = url_parser->checkStats();
+        writer.counter("monitoring_checks_joined_total", "URLs that shared a check in flight.", checks.joined);
+        writer.counter("monitoring_checks_cached_total", "URLs answered from a recent result.", checks.cached);
+        const auto admission = url_parser->admission()->stats();
+        writer.gauge("monitoring_admission_pending_urls", "URLs admitted and not yet checked.",
+                     static_cast<double>(admission.pending_urls));
+        writer.gauge("monitoring_admission_pending_bytes", "Length of the URLs admitted and not yet checked.",
+                     static_cast<double>(admission.pending_bytes));
+        writer.counter("monitoring_admission_rejected_queue_full_total", "/check_urls rejected with 503.",
+                       admission.rejected_full);
+        writer.counter("monitoring_admission_rejected_quota_total", "/check_urls rejected with 429.",
+                       admission.rejected_quota);
+        writer.counter("monitoring_admission_rejected_too_large_total", "/check_urls rejected with 413.",
+                       admission.rejected_too_large);
+        if (result_cache) {
+            writer.counter("monitoring_result_cache_hits_total", "/get_results answered from the cache.",
+                           result_cache->hits());
+            writer.counter("monitoring_result_cache_misses_total", "/get_results that missed the cache.",
+                           result_cache->misses());
+        }
+        if (scheduler) {
+            writer.gauge("monitoring_schedules", "Recurring checks.", static_cast<double>(scheduler->size()));
+        }
+        return {"200 OK", writer.text(), HttpResponse::Kind::Body, 0, "text/plain; version=0.0.4"};
+    }
+
+    // /check_urls never holds its whole body: the body is scanned as it is
+    // read, and its URLs are admitted and queued in chunks under a request
+    // created with the first of them, while the rest is still arriving.
+    // A body read in one piece is admitted or turned away whole.
+    HttpResponse check_urls() {
+        ingest_ = std::make_unique<Ingest>();
+        ingest_->client = client_id();
+        return ingest(body());
+    }
+
+    // Reads the next piece of the body, or first waits for the admission of
+    // the chunk that was turned away.
+    void read_ingest() {
+        auto self(shared_from_this());
+        if (ingest_->retry_after.count() > 0) {
+            wait_timer_.expires_after(std::exchange(ingest_->retry_after, std::chrono::seconds(0)));
+            wait_timer_.async_wait([this, self](boost::system::error_code) {
+                run_blocking([this] { return ingest({}); });
+            });
+            return;
+        }
+        ingest_->piece.resize(std::min(kIngestReadSize, body_unread_));
+        socket_.async_read_some(
+            boost::asio::buffer(ingest_->piece),
+            [this, self](boost::system::error_code ec, std::size_t bytes) {
+                if (ec) {
+                    // The client is gone; what it sent so far is still
+                    // checked.
+                    if (ingest_->request_id != 0) {
+                        url_parser->tracker()->close(ingest_->request_id);
                     }
-                } else {
-                    status = "404 Not Found";
-                    response_body = R"({"error": "Not Found"})";
+                    return;
                 }
+                body_unread_ -= bytes;
+                run_blocking([this, bytes] { return ingest(std::string_view(ingest_->piece).substr(0, bytes)); });
+            });
+    }
+
+    // Scans a piece of the body and queues every chunk of URLs it completes;
+    // once the body is read, the URLs left go too and the request is
+    // answered.
+    HttpResponse ingest(std::string_view piece) {
+        Ingest& in = *ingest_;
+        const auto result = in.parser.feed(piece);
+        const bool read = body_unread_ == 0;
+        if (config_.store_request_bodies) {
+            // A body that does not come whole with the head is kept
+            // deflated as it arrives.
+            if (!read && !in.deflater) {
+                in.deflater = std::make_unique<Deflater>(CompressionFormat::Zlib, kIngestCompressionLevel);
+            }
+            if (in.deflater) {
+                in.body += in.deflater->write(piece, read);
             } else {
-                status = "415 Unsupported Media Type";
-                response_body = R"({"error": "Unsupported Media Type"})";
+                in.body.append(piece);
             }
-        } else {
-            status = "405 Method Not Allowed";
-            response_body = R"({"error": "Method Not Allowed"})";
-        }
-        std::string content_type = "application/json; charset=UTF-8";
-
-        std::string response = "HTTP/1.1 " + status +
-                               "\r\n"
-                               "Content-Type: " +
-                               content_type +
-                               "\r\n"
-                               "Content-Length: " +
-                               std::to_string(response_body.size()) +
-                               "\r\n"
-                               "Connection: close\r\n"
-                               "\r\n" +
-                               response_body;
+        }
+        if (result == UrlStreamParser::Result::Bad || (read && result != UrlStreamParser::Result::Complete)) {
+            return ingest_error("400 Bad Request", "Bad Request");
+        }
+        const size_t chunk_size = ingest_chunk_size();
+        while (!in.chunk.empty() || in.parser.pending() >= chunk_size || (read && in.parser.pending() > 0)) {
+            if (in.chunk.empty()) {
+                in.chunk = in.parser.take(read && in.request_id == 0 ? 0 : chunk_size);
+            }
+            size_t bytes = 0;
+            for (const auto& url : in.chunk) {
+                bytes += url.size();
+            }
+            // Admitted before the request is stored, so a rejected one
+            // leaves nothing behind; once its first URLs are queued, the
+            // rest wait for room.
+            const auto& admission = url_parser->admission();
+            const auto admitted = admission->admit(in.client, in.chunk.size(), bytes, in.count, in.bytes);
+            if (admitted.decision == AdmissionControl::Decision::TooLarge && in.request_id != 0) {
+                return ingest_error("413 Payload Too Large", "Too many URLs in one request");
+            }
+            if (admitted.decision != AdmissionControl::Decision::Admitted) {
+                if (in.request_id == 0) {
+                    return rejection(admitted);
+                }
+                in.retry_after = admitted.retry_after;
+                return {"", "", HttpResponse::Kind::Ingest};
+            }
+            if (in.request_id == 0 && !create_request()) {
+                admission->cancel(in.client, in.chunk.size(), bytes);
+                return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+            }
+            admission->assign(in.request_id, in.client, in.chunk.size());
+            url_parser->addUrls(in.request_id, in.chunk);
+            in.count += in.chunk.size();
+            in.bytes += bytes;
+            in.chunk.clear();
+        }
+        if (!read) {
+            return {"", "", HttpResponse::Kind::Ingest};
+        }
+        if (in.request_id == 0 && !create_request()) {
+            return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+        }
+        if (!in.body_stored && !db->setRequestContent(in.request_id, in.body, true)) {
+            return ingest_error("500 Internal Server Error", "Internal Server Error");
+        }
+        url_parser->tracker()->close(in.request_id);
+        return {"200 OK", R"({"status": "OK", "request_id": )" +
+                              std::to_string(in.request_id) +
+                              R"(, "count_urls": )" +
+                              std::to_string(in.count) + "}"};
+    }
+
+    // Stores the request with its body if it is read to the end by now, and
+    // keeps it open in the tracker until it is.
+    bool create_request() {
+        Ingest& in = *ingest_;
+        const bool whole = body_unread_ == 0 && !in.deflater;
+        in.body_stored = !config_.store_request_bodies || whole;
+        RequestTracker::Creation creation(*url_parser->tracker());
+        const int requestId = static_cast<int>(db->getRequestId(whole ? in.body : std::string()));
+        if (requestId == 0) {
+            return false;
+        }
+        in.request_id = requestId;
+        if (in.body_stored) {
+            in.body = std::string();
+        }
+        url_parser->tracker()->open(requestId);
+        return true;
+    }
+
+    // The URLs queued before an error are still checked, under the request
+    // id the error carries.
+    HttpResponse ingest_error(const std::string& status, const std::string& error) {
+        const int requestId = ingest_->request_id;
+        if (requestId == 0) {
+            return {status, R"({"error": ")" + error + R"("})"};
+        }
+        url_parser->tracker()->close(requestId);
+        return {status, R"({"error": ")" + error + R"(", "request_id": )" + std::to_string(requestId) + "}"};
+    }
+
+    // No chunk may exceed a limit on the pending URLs by itself.
+    size_t ingest_chunk_size() const {
+        size_t size = std::max<size_t>(config_.ingest_chunk_urls, 1);
+        const auto limits = url_parser->admission()->limits();
+        for (const size_t limit : {limits.max_urls, limits.client_max_urls}) {
+            if (limit > 0) {
+                size = std::min(size, limit);
+            }
+        }
+        return size;
+    }
+
+    // Quotas are kept per X-Client-Id, or per remote address without one.
+    std::string client_id() const {
+        if (!parser_.request().client_id.empty()) {
+            return std::string(parser_.request().client_id);
+        }
+        boost::system::error_code ec;
+        const auto endpoint = socket_.remote_endpoint(ec);
+        return ec ? std::string() : endpoint.address().to_string();
+    }
+
+    // 503 while the service is saturated and 429 while the client is over
+    // its quota, both with Retry-After; 413 for a request that can never fit.
+    static HttpResponse rejection(const AdmissionControl::Admission& admitted) {
+        switch (admitted.decision) {
+            case AdmissionControl::Decision::TooLarge:
+                return {"413 Payload Too Large", R"({"error": "Too many URLs in one request"})"};
+            case AdmissionControl::Decision::QuotaExceeded:
+            case AdmissionControl::Decision::QueueFull: {
+                const bool quota = admitted.decision == AdmissionControl::Decision::QuotaExceeded;
+                const std::string retry_after = std::to_string(admitted.retry_after.count());
+                HttpResponse response{quota ? "429 Too Many Requests" : "503 Service Unavailable",
+                                      std::string(R"({"error": ")") + (quota ? "Quota exceeded" : "Queue full") +
+                                          R"(", "retry_after": )" + retry_after + "}"};
+                response.headers = "Retry-After: " + retry_after + "\r\n";
+                return response;
+            }
+            case AdmissionControl::Decision::Admitted:
+                break;
+        }
+        return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+    }
+
+    // Every URL is checked once per its interval in seconds; the results
+    // accumulate under the returned request id.
+    HttpResponse add_schedules() {
+        if (!scheduler) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        std::vector<std::pair<std::string, std::chrono::milliseconds>> urls;
+        try {
+            json parsed = json::parse(body());
+            for (const auto& url_obj : parsed.at("urls")) {
+                const auto interval = url_obj.at("interval").get<long long>();
+                if (interval <= 0) {
+                    return {"400 Bad Request", R"({"error": "Bad Request"})"};
+                }
+                urls.emplace_back(url_obj.at("url").get<std::string>(), std::chrono::seconds(interval));
+            }
+        } catch (const std::exception& e) {
+            return {"400 Bad Request", R"({"error": "Bad Request"})"};
+        }
+        RequestTracker::Creation creation(*url_parser->tracker());
+        const int requestId = db->getRequestId(std::string(body()));
+        if (requestId == 0) {
+            return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+        }
+        // A request without its schedules would just look complete.
+        if (!scheduler->add(requestId, urls)) {
+            db->removeRequest(requestId);
+            return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+        }
+        return {"200 OK", R"({"status": "OK", "request_id": )" +
+                              std::to_string(requestId) +
+                              R"(, "count_urls": )" +
+                              std::to_string(urls.size()) + "}"};
+    }
+
+    HttpResponse remove_schedules(std::string_view id) {
+        auto request_id = parse_request_id(id);
+        std::optional<size_t> removed = 0;
+        if (scheduler && request_id) {
+            removed = scheduler->remove(*request_id);
+        }
+        if (!removed) {
+            return {"500 Internal Server Error", R"({"error": "Internal Server Error"})"};
+        }
+        if (*removed == 0) {
+            return {"404 Not Found", R"({"error": "Not Found"})"};
+        }
+        return {"200 OK", R"({"status": "OK", "removed": )" + std::to_string(*removed) + "}"};
+    }
+
+    void write_response(const std::string& status, const std::string& response_body,
+                        std::string_view content_type = "application/json; charset=UTF-8",
+                        const std::string& headers = "", ContentEncoding encoding = ContentEncoding::Identity) {
+        // The rest of a body answered before it was read cannot be told from
+        // the next request.
+        if (body_unread_ > 0) {
+            keep_alive_ = false;
+        }
+        response_ = "HTTP/1.1 " + status +
+                    "\r\n"
+                    "Content-Type: " +
+                    std::string(content_type) +
+                    "\r\n"
+                    "Content-Length: " +
+                    std::to_string(response_body.size()) +
+                    "\r\n" +
+                    headers +
+                    encoding_headers(response_body.size(), encoding) +
+                    connection_header() +
+                    "\r\n" +
+                    response_body;
 
         auto self(shared_from_this());
         boost::asio::async_write(
-            socket_, boost::asio::buffer(response),
-            [this, self](boost::system::error_code, std::size_t) {
-                socket_.close();
+            socket_, boost::asio::buffer(response_),
+            [this, self](boost::system::error_code ec, std::size_t) {
+                finish_response(ec);
             });
     }
 
+    void finish_response(boost::system::error_code ec) {
+        if (!ec && keep_alive_) {
+            reset();
+            wait_for_request();
+        } else {
+            boost::system::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_send, ignored);
+            socket_.close(ignored);
+        }
+    }
+
+    // Responses that may be compressed vary by Accept-Encoding, whether this
+    // one is or not.
+    std::string encoding_headers(size_t size, ContentEncoding encoding) const {
+        if (encoding != ContentEncoding::Identity) {
+            return "Vary: Accept-Encoding\r\n" + encoding_header(encoding);
+        }
+        if (config_.compression_level > 0 && size >= config_.compression_min_bytes) {
+            return "Vary: Accept-Encoding\r\n";
+        }
+        return "";
+    }
+
+    std::string connection_header() const {
+        if (!keep_alive_) {
+            return "Connection: close\r\n";
+        }
+        return "Connection: keep-alive\r\n"
+               "Keep-Alive: timeout=" + std::to_string(config_.keep_alive_timeout.count()) +
+               ", max=" + std::to_string(config_.keep_alive_max - requests_served_) + "\r\n";
+    }
+
     tcp::socket socket_;
-    boost::asio::streambuf buffer_;
-    std::string method_, uri_, version_, body_, content_type_;
-    size_t content_length_ = 0;
+    boost::asio::steady_timer idle_timer_;
+    boost::asio::steady_timer wait_timer_;
+    std::chrono::steady_clock::time_point wait_deadline_;
+    // Receive buffer; the parsed request is a set of views into it.
+    std::string buffer_;
+    HttpRequestParser parser_;
+    std::string response_;
+    size_t request_size_ = 0;
+    // Bytes of a streamed body not read from the socket yet.
+    size_t body_unread_ = 0;
+    // Time the request has spent on the blocking pool.
+    std::chrono::steady_clock::duration busy_{};
+    // Coding the client takes for the response, and the stream of a
+    // compressed /get_results?stream.
+    ContentEncoding encoding_ = ContentEncoding::Identity;
+    std::unique_ptr<Deflater> deflater_;
+    size_t requests_served_ = 0;
+    bool keep_alive_ = false;
+    // Registration with the request tracker of a long-poll or event stream.
+    int listen_request_id_ = 0;
+    size_t listener_id_ = 0;
+    // Long-poll the completion listener may still cancel wait_timer_ for;
+    // moves on when the wait ends.
+    size_t wait_generation_ = 0;
+    std::deque<std::string> events_;
+    // Progress at the last event dropped because events_ was full.
+    std::string skipped_progress_;
+    bool events_done_ = false;
+    bool writing_events_ = false;
+    // Phase bounds of the /get_results being served, for its pages.
+    ResultFilter result_filter_;
+    // State of the /check_urls body being read.
+    struct Ingest {
+        UrlStreamParser parser;
+        std::string client;
+        // The body read so far while it is to be stored, deflated by
+        // deflater unless it came whole with the head.
+        std::string body;
+        std::unique_ptr<Deflater> deflater;
+        bool body_stored = false;
+        // Receive buffer of the pieces read after the head.
+        std::string piece;
+        // URLs taken from the parser and waiting for admission.
+        std::vector<std::string> chunk;
+        std::chrono::seconds retry_after{0};
+        int request_id = 0;
+        // URLs queued so far and their total length.
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+    std::unique_ptr<Ingest> ingest_;
     std::shared_ptr<UrlParser> url_parser;
     std::shared_ptr<DatabaseInterface> db;
+    std::shared_ptr<ResultCache> result_cache;
+    std::shared_ptr<MonitorScheduler> scheduler;
+    boost::asio::thread_pool::executor_type blocking_executor;
+    HttpServerConfig config_;
 };
 
 class HttpServer {
@@ -186,28 +1193,58 @@ class HttpServer {
                std::function<std::unique_ptr<HttpClientInterface>(
                    const std::string&, size_t)>
                    httpClientFactory)
-        : acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
-          max_threads(maxThreads),
-          timeout(timeout) {
+        : HttpServer(io_context, port, database,
+                     std::make_shared<UrlParser>(maxThreads, timeout, database,
+                                                 std::move(httpClientFactory))) {}
 
-        db = database;
-        url_parser = std::make_shared<UrlParser>(max_threads, timeout, db, httpClientFactory);
+    // The io_context may be run on several threads: every session gets its
+    // own strand, and blocking work goes to a separate pool.
+    HttpServer(boost::asio::io_context& io_context, unsigned short port,
+               const std::shared_ptr<DatabaseInterface>& database,
+               const std::shared_ptr<UrlParser>& urlParser,
+               const HttpServerConfig& config = {},
+               const std::shared_ptr<MonitorScheduler>& scheduler = nullptr)
+        : io_context_(io_context),
+          config_(config),
+          blocking_pool(std::max<size_t>(config.blocking_threads, 1)),
+          acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
+          url_parser(urlParser),
+          db(database),
+          scheduler(scheduler) {
+        if (config.result_cache_bytes > 0) {
+            result_cache = std::make_shared<ResultCache>(config.result_cache_bytes);
+        }
+        // Requests stored before the start are complete, whatever is being
+        // created meanwhile.
+        url_parser->tracker()->seed(db->lastRequestId());
         accept();
     }
 
+    // nullptr when the cache is disabled.
+    [[nodiscard]] std::shared_ptr<ResultCache> resultCache() const { return result_cache; }
+    // The port actually bound, when constructed with port 0.
+    [[nodiscard]] unsigned short port() const { return acceptor_.local_endpoint().port(); }
+
    private:
     void accept() {
-        acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
-            if (!ec) {
-                std::make_shared<HttpSession>(std::move(socket), url_parser, db)->start();
-            }
-            accept();
-        });
+        acceptor_.async_accept(
+            boost::asio::make_strand(io_context_),
+            [this](boost::system::error_code ec, tcp::socket socket) {
+                if (!ec) {
+                    std::make_shared<HttpSession>(std::move(socket), url_parser, db, result_cache, scheduler,
+                                                  blocking_pool.get_executor(), config_)
+                        ->start();
+                }
+                accept();
+            });
     }
 
+    boost::asio::io_context& io_context_;
+    HttpServerConfig config_;
+    boost::asio::thread_pool blocking_pool;
     tcp::acceptor acceptor_;
-    size_t max_threads;
     std::shared_ptr<UrlParser> url_parser;
     std::shared_ptr<DatabaseInterface> db;
-    size_t timeout;
+    std::shared_ptr<ResultCache> result_cache;
+    std::shared_ptr<MonitorScheduler> scheduler;
 };
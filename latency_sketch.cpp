@@ -0,0 +1,138 @@
+#include "latency_sketch.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+template <typename T>
+void writeValue(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::string_view& data, T& value) {
+    if (data.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(T));
+    data.remove_prefix(sizeof(T));
+    return true;
+}
+
+}  // namespace
+
+uint16_t LatencySketch::bucketOf(uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return static_cast<uint16_t>(micros);
+    }
+    const unsigned exponent = static_cast<unsigned>(std::bit_width(micros)) - 1;
+    const uint64_t mantissa = (micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return static_cast<uint16_t>((exponent - kSubBucketBits + 1) * kSubBuckets + mantissa);
+}
+
+uint64_t LatencySketch::bucketLow(uint16_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const unsigned exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+    return (kSubBuckets + bucket % kSubBuckets) << (exponent - kSubBucketBits);
+}
+
+uint64_t LatencySketch::bucketHigh(uint16_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const unsigned exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+    return bucketLow(bucket) + (uint64_t{1} << (exponent - kSubBucketBits)) - 1;
+}
+
+void LatencySketch::add(uint64_t micros, uint32_t count) {
+    const uint16_t bucket = bucketOf(micros);
+    auto it = std::lower_bound(m_buckets.begin(), m_buckets.end(), bucket,
+                               [](const auto& entry, uint16_t b) { return entry.first < b; });
+    if (it != m_buckets.end() && it->first == bucket) {
+        it->second += count;
+    } else {
+        m_buckets.insert(it, {bucket, count});
+    }
+    m_count += count;
+}
+
+void LatencySketch::merge(const LatencySketch& other) {
+    if (other.m_buckets.empty()) {
+        return;
+    }
+    std::vector<std::pair<uint16_t, uint32_t>> merged;
+    merged.reserve(m_buckets.size() + other.m_buckets.size());
+    auto lhs = m_buckets.begin();
+    auto rhs = other.m_buckets.begin();
+    while (lhs != m_buckets.end() || rhs != other.m_buckets.end()) {
+        if (rhs == other.m_buckets.end() || (lhs != m_buckets.end() && lhs->first < rhs->first)) {
+            merged.push_back(*lhs++);
+        } else if (lhs == m_buckets.end() || rhs->first < lhs->first) {
+            merged.push_back(*rhs++);
+        } else {
+            merged.emplace_back(lhs->first, lhs->second + rhs->second);
+            ++lhs;
+            ++rhs;
+        }
+    }
+    m_buckets = std::move(merged);
+    m_count += other.m_count;
+}
+
+void LatencySketch::clear() {
+    m_buckets.clear();
+    m_count = 0;
+}
+
+uint64_t LatencySketch::quantile(double q) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    // Rank of the value, 1-based: the smallest value with at least q of
+    // the values at or below it.
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(m_count))));
+    uint64_t seen = 0;
+    for (const auto& [bucket, count] : m_buckets) {
+        seen += count;
+        if (seen >= rank) {
+            return (bucketLow(bucket) + bucketHigh(bucket)) / 2;
+        }
+    }
+    return (bucketLow(m_buckets.back().first) + bucketHigh(m_buckets.back().first)) / 2;
+}
+
+void LatencySketch::write(std::string& out) const {
+    writeValue(out, static_cast<uint32_t>(m_buckets.size()));
+    for (const auto& [bucket, count] : m_buckets) {
+        writeValue(out, bucket);
+        writeValue(out, count);
+    }
+}
+
+bool LatencySketch::read(std::string_view& data) {
+    clear();
+    uint32_t size = 0;
+    if (!readValue(data, size) || data.size() < size * (sizeof(uint16_t) + sizeof(uint32_t))) {
+        return false;
+    }
+    m_buckets.reserve(size);
+    for (uint32_t i = 0; i < size; i++) {
+        uint16_t bucket = 0;
+        uint32_t count = 0;
+        readValue(data, bucket);
+        readValue(data, count);
+        if (!m_buckets.empty() && m_buckets.back().first >= bucket) {
+            clear();
+            return false;
+        }
+        m_buckets.emplace_back(bucket, count);
+        m_count += count;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Log-linear histogram of latencies in microseconds, in the manner of HDR
+// histograms: values below 16 are exact, and every power of two above is
+// split into 16 buckets, so a quantile is off by at most 1/32 of its value.
+// Only non-empty buckets are kept, which for the latencies of one URL are
+// a few dozen, and two sketches merge by adding their buckets.
+class LatencySketch {
+   public:
+    void add(uint64_t micros, uint32_t count = 1);
+    void merge(const LatencySketch& other);
+    void clear();
+
+    [[nodiscard]] uint64_t count() const { return m_count; }
+    [[nodiscard]] bool empty() const { return m_count == 0; }
+    // Value at quantile q in [0, 1], as the middle of its bucket; 0 when
+    // empty.
+    [[nodiscard]] uint64_t quantile(double q) const;
+
+    // Appends a binary form that read() restores.
+    void write(std::string& out) const;
+    // Reads a sketch written at data and advances it; false if malformed.
+    bool read(std::string_view& data);
+
+    static uint16_t bucketOf(uint64_t micros);
+    static uint64_t bucketLow(uint16_t bucket);
+    static uint64_t bucketHigh(uint16_t bucket);
+
+   private:
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+
+    // (bucket, count), sorted by bucket.
+    std::vector<std::pair<uint16_t, uint32_t>> m_buckets;
+    uint64_t m_count = 0;
+};
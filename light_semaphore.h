@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Counting semaphore whose fast path is a CAS on the count; only threads
+// that find no permits take the mutex and sleep, and release(n) wakes at
+// most n of them. Used instead of std::counting_semaphore, which in
+// libstdc++ 12 can miss a wakeup and sleep forever (GCC PR 104928).
+class LightSemaphore {
+   public:
+    void release(size_t count = 1) {
+        if (count == 0) {
+            return;
+        }
+        permits.fetch_add(count);
+        if (waiters.load() == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+        }
+        if (count == 1) {
+            cv.notify_one();
+        } else {
+            cv.notify_all();
+        }
+    }
+
+    void acquire() {
+        if (tryAcquire()) {
+            return;
+        }
+        std::unique_lock lock(mtx);
+        waiters.fetch_add(1);
+        cv.wait(lock, [this] { return tryAcquire(); });
+        waiters.fetch_sub(1);
+    }
+
+    template <typename Clock, typename Duration>
+    bool tryAcquireUntil(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (tryAcquire()) {
+            return true;
+        }
+        std::unique_lock lock(mtx);
+        waiters.fetch_add(1);
+        const bool acquired = cv.wait_until(lock, deadline, [this] { return tryAcquire(); });
+        waiters.fetch_sub(1);
+        return acquired;
+    }
+
+    // A waiter checks the count after adding itself to waiters and release
+    // checks waiters after adding to the count; with both sides seq_cst at
+    // least one of them sees the other, so a permit never lands while its
+    // waiter goes to sleep unnoticed.
+    bool tryAcquire() {
+        size_t current = permits.load();
+        while (current > 0) {
+            if (permits.compare_exchange_weak(current, current - 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+   private:
+    std::atomic<size_t> permits = 0;
+    std::atomic<size_t> waiters = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
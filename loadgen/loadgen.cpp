@@ -0,0 +1,335 @@
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batch_writer.h"
+#include "curl.h"
+#include "curl_multi.h"
+#include "http_server.h"
+#include "sqlite_db.h"
+#include "stub_origin.h"
+
+using json = nlohmann::json;
+using tcp = boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct HttpReply {
+    int status = 0;
+    std::string body;
+};
+
+// One request per connection, which is what a dashboard or a script does.
+// A connection that fails gets status 0.
+HttpReply request(unsigned short port, const std::string& method, const std::string& target, const std::string& body = "") {
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port), ec);
+    if (ec) {
+        return {};
+    }
+    std::string text = method + " " + target + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n";
+    if (!body.empty()) {
+        text += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    text += "\r\n" + body;
+    boost::asio::write(socket, boost::asio::buffer(text), ec);
+    if (ec) {
+        return {};
+    }
+    std::string response;
+    boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+
+    HttpReply reply;
+    if (response.size() > 12) {
+        reply.status = std::atoi(response.c_str() + 9);
+    }
+    if (size_t body_pos = response.find("\r\n\r\n"); body_pos != std::string::npos) {
+        reply.body = response.substr(body_pos + 4);
+    }
+    return reply;
+}
+
+// Latency samples in microseconds.
+class Samples {
+   public:
+    void add(uint64_t micros) {
+        std::lock_guard<std::mutex> lock(mtx);
+        values.push_back(micros);
+    }
+    void add(Clock::duration elapsed) {
+        add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+
+    [[nodiscard]] json summary() {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::sort(values.begin(), values.end());
+        json result = {{"count", values.size()}};
+        for (const auto& [name, quantile] : {std::pair{"p50", 0.5}, {"p99", 0.99}, {"p999", 0.999}}) {
+            result[name] = percentile(quantile) / 1000.0;
+        }
+        result["max"] = values.empty() ? 0.0 : values.back() / 1000.0;
+        return result;
+    }
+
+   private:
+    [[nodiscard]] uint64_t percentile(double quantile) const {
+        if (values.empty()) {
+            return 0;
+        }
+        const auto rank = static_cast<size_t>(std::ceil(quantile * static_cast<double>(values.size())));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    }
+
+    std::mutex mtx;
+    std::vector<uint64_t> values;
+};
+
+struct Report {
+    Samples submit;
+    Samples get_results;
+    Samples completion;
+    Samples checks;
+    std::atomic<size_t> urls = 0;
+    std::atomic<size_t> ok = 0;
+    std::atomic<size_t> errors = 0;
+    std::atomic<size_t> timeouts = 0;
+    std::atomic<size_t> failed_requests = 0;
+};
+
+// Submits the batch and follows it to completion with long-poll or, with a
+// poll interval, with plain polling, and then reads it in full once.
+void runBatch(unsigned short port, unsigned short originPort, size_t batch, size_t batchSize,
+              std::chrono::milliseconds pollInterval, Report& report) {
+    json urls = json::array();
+    for (size_t i = 0; i < batchSize; i++) {
+        urls.push_back({{"url", "http://127.0.0.1:" + std::to_string(originPort) + "/" +
+                                    std::to_string(batch) + "/" + std::to_string(i)}});
+    }
+    const auto submitted = Clock::now();
+    HttpReply reply = request(port, "POST", "/check_urls", json{{"urls", urls}}.dump());
+    report.submit.add(Clock::now() - submitted);
+    if (reply.status != 200) {
+        report.failed_requests++;
+        return;
+    }
+    const std::string path = "/get_results/" + std::to_string(json::parse(reply.body)["request_id"].get<int>());
+
+    while (true) {
+        const auto polled = Clock::now();
+        reply = pollInterval.count() > 0 ? request(port, "GET", path) : request(port, "GET", path + "?wait=60000");
+        if (pollInterval.count() > 0) {
+            report.get_results.add(Clock::now() - polled);
+        }
+        if (reply.status != 200) {
+            report.failed_requests++;
+            break;
+        }
+        if (json::parse(reply.body).value("complete", false)) {
+            break;
+        }
+        std::this_thread::sleep_for(pollInterval);
+    }
+    report.completion.add(Clock::now() - submitted);
+
+    const auto read = Clock::now();
+    reply = request(port, "GET", path);
+    report.get_results.add(Clock::now() - read);
+    if (reply.status != 200) {
+        report.failed_requests++;
+        return;
+    }
+    for (const auto& url : json::parse(reply.body).value("urls", json::array())) {
+        report.urls++;
+        const int status = url["http_status"];
+        if (status == 0) {
+            report.timeouts++;
+        } else if (status >= 500) {
+            report.errors++;
+        } else {
+            report.ok++;
+        }
+        report.checks.add(static_cast<uint64_t>(url["response_time"].get<long long>()) * 1000);
+    }
+}
+
+// Runs batches until none are left. A reply that is not the JSON expected,
+// cut short or an error page of an overloaded server, fails its batch only.
+void runClient(unsigned short port, unsigned short originPort, std::atomic<size_t>& nextBatch, size_t batches,
+               size_t batchSize, std::chrono::milliseconds pollInterval, Report& report) {
+    for (size_t batch = nextBatch++; batch < batches; batch = nextBatch++) {
+        try {
+            runBatch(port, originPort, batch, batchSize, pollInterval, report);
+        } catch (const std::exception& e) {
+            report.failed_requests++;
+        }
+    }
+}
+
+}  // namespace
+
+int main(const int argc, char* argv[]) {
+    boost::program_options::options_description desc("Options");
+    desc.add_options()
+    ("help,h", "show help")
+    ("batches", boost::program_options::value<std::size_t>()->default_value(100), "batches submitted to /check_urls")
+    ("batch-size", boost::program_options::value<std::size_t>()->default_value(100), "URLs per batch")
+    ("clients", boost::program_options::value<std::size_t>()->default_value(4), "concurrent API clients")
+    ("poll-interval", boost::program_options::value<std::size_t>()->default_value(0), "milliseconds between /get_results polls (0 - long-poll with ?wait=)")
+    ("max-threads,m", boost::program_options::value<std::size_t>()->default_value(8), "service: max threads")
+    ("max-in-flight,f", boost::program_options::value<std::size_t>()->default_value(0), "service: max concurrent checks with curl_multi engine (0 - blocking check per thread)")
+    ("max-per-host", boost::program_options::value<std::size_t>()->default_value(0), "service: max concurrent checks against one host (0 - unlimited)")
+    ("timeout,t", boost::program_options::value<std::size_t>()->default_value(2), "service: check timeout in seconds")
+    ("flush-size", boost::program_options::value<std::size_t>()->default_value(100), "service: max results committed in one transaction")
+    ("io-threads", boost::program_options::value<std::size_t>()->default_value(2), "service: threads running the HTTP server")
+    ("database-path,d", boost::program_options::value<std::string>()->default_value("loadgen.db"), "service: database path, recreated for the run")
+    ("origin-latency", boost::program_options::value<std::size_t>()->default_value(20), "origin: mean response latency in milliseconds")
+    ("origin-distribution", boost::program_options::value<std::string>()->default_value("exponential"), "origin: latency distribution (fixed, uniform, exponential)")
+    ("origin-error-rate", boost::program_options::value<double>()->default_value(0.01), "origin: share of 500 responses")
+    ("origin-slow-rate", boost::program_options::value<double>()->default_value(0), "origin: share of slow responses")
+    ("origin-slow-latency", boost::program_options::value<std::size_t>()->default_value(1000), "origin: latency of slow responses in milliseconds")
+    ("origin-hang-rate", boost::program_options::value<double>()->default_value(0), "origin: share of requests never answered")
+    ("origin-threads", boost::program_options::value<std::size_t>()->default_value(2), "origin: threads")
+    ("json", "print the report as JSON");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+    boost::program_options::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    StubOriginConfig originConfig;
+    originConfig.latency = std::chrono::milliseconds(vm["origin-latency"].as<std::size_t>());
+    const auto distribution = vm["origin-distribution"].as<std::string>();
+    if (distribution == "fixed") {
+        originConfig.distribution = StubOriginConfig::Distribution::Fixed;
+    } else if (distribution == "uniform") {
+        originConfig.distribution = StubOriginConfig::Distribution::Uniform;
+    } else if (distribution == "exponential") {
+        originConfig.distribution = StubOriginConfig::Distribution::Exponential;
+    } else {
+        std::cerr << "Error: unknown distribution " << distribution << std::endl;
+        return 1;
+    }
+    originConfig.error_rate = vm["origin-error-rate"].as<double>();
+    originConfig.slow_rate = vm["origin-slow-rate"].as<double>();
+    originConfig.slow_latency = std::chrono::milliseconds(vm["origin-slow-latency"].as<std::size_t>());
+    originConfig.hang_rate = vm["origin-hang-rate"].as<double>();
+    originConfig.threads = vm["origin-threads"].as<std::size_t>();
+
+    const auto batches = vm["batches"].as<std::size_t>();
+    const auto batchSize = vm["batch-size"].as<std::size_t>();
+    const auto clients = std::max<std::size_t>(vm["clients"].as<std::size_t>(), 1);
+    const auto pollInterval = std::chrono::milliseconds(vm["poll-interval"].as<std::size_t>());
+    const auto maxThreads = vm["max-threads"].as<std::size_t>();
+    const auto maxInFlight = vm["max-in-flight"].as<std::size_t>();
+    HostLimits hostLimits;
+    hostLimits.max_per_host = vm["max-per-host"].as<std::size_t>();
+    const auto timeout = vm["timeout"].as<std::size_t>();
+    const auto flushSize = vm["flush-size"].as<std::size_t>();
+    const auto ioThreads = std::max<std::size_t>(vm["io-threads"].as<std::size_t>(), 1);
+    const auto databasePath = vm["database-path"].as<std::string>();
+
+    try {
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(databasePath + suffix);
+        }
+        StubOrigin origin(originConfig);
+
+        // The service is assembled the way main.cpp does it.
+        std::shared_ptr<DatabaseInterface> database = std::make_shared<SqliteDb>(databasePath);
+        std::shared_ptr<BatchWriter> batchWriter;
+        if (flushSize > 0) {
+            batchWriter = std::make_shared<BatchWriter>(database, flushSize, std::chrono::milliseconds(50), 10000);
+            database = batchWriter;
+        }
+        auto curlPool = std::make_shared<CurlPool>(16, std::chrono::seconds(60));
+        auto httpClientFactory = [curlPool](const std::string& url, size_t timeout) -> std::unique_ptr<HttpClientInterface> {
+            return std::make_unique<Curl>(url, timeout, curlPool);
+        };
+        std::shared_ptr<UrlParser> urlParser;
+        if (maxInFlight > 0) {
+            urlParser = std::make_shared<UrlParser>(maxThreads, timeout, database, std::make_shared<CurlMulti>(), maxInFlight, hostLimits);
+        } else {
+            urlParser = std::make_shared<UrlParser>(maxThreads, timeout, database, httpClientFactory, hostLimits);
+        }
+        if (batchWriter) {
+            urlParser->releaseAdmissionOnCommit(*batchWriter);
+        }
+        boost::asio::io_context ioContext;
+        HttpServer server(ioContext, 0, database, urlParser);
+        std::vector<std::thread> ioThreadPool;
+        for (std::size_t i = 0; i < ioThreads; i++) {
+            ioThreadPool.emplace_back([&ioContext] { ioContext.run(); });
+        }
+
+        Report report;
+        std::atomic<size_t> nextBatch = 0;
+        const auto started = Clock::now();
+        std::vector<std::thread> clientThreads;
+        for (size_t i = 0; i < clients; i++) {
+            clientThreads.emplace_back(runClient, server.port(), origin.port(), std::ref(nextBatch), batches, batchSize,
+                                       pollInterval, std::ref(report));
+        }
+        for (auto& thread : clientThreads) {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+        json result = {
+            {"seconds", seconds},
+            {"urls", report.urls.load()},
+            {"checks_per_second", seconds > 0 ? static_cast<double>(report.urls.load()) / seconds : 0.0},
+            {"ok", report.ok.load()},
+            {"errors", report.errors.load()},
+            {"timeouts", report.timeouts.load()},
+            {"failed_requests", report.failed_requests.load()},
+            {"latency_ms",
+             {{"check", report.checks.summary()},
+              {"check_urls", report.submit.summary()},
+              {"get_results", report.get_results.summary()},
+              {"batch_completion", report.completion.summary()}}},
+            {"origin", {{"served", origin.served()}, {"errors", origin.errors()}, {"hung", origin.hung()}}},
+        };
+
+        ioContext.stop();
+        for (auto& thread : ioThreadPool) {
+            thread.join();
+        }
+
+        if (vm.count("json")) {
+            std::cout << result.dump(2) << std::endl;
+        } else {
+            std::cout << "urls checked:      " << result["urls"] << " in " << seconds << " s\n"
+                      << "checks/sec:        " << result["checks_per_second"] << "\n"
+                      << "ok/5xx/timeouts:   " << result["ok"] << "/" << result["errors"] << "/" << result["timeouts"] << "\n"
+                      << "failed requests:   " << result["failed_requests"] << "\n"
+                      << "latency, ms         p50      p99     p999      max\n";
+            for (const auto& [name, summary] : result["latency_ms"].items()) {
+                std::printf("%-18s %8.2f %8.2f %8.2f %8.2f\n", name.c_str(), summary["p50"].get<double>(),
+                            summary["p99"].get<double>(), summary["p999"].get<double>(), summary["max"].get<double>());
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
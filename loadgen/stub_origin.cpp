@@ -0,0 +1,124 @@
+#include "stub_origin.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string_view>
+
+using boost::asio::ip::tcp;
+
+class StubOrigin::Session : public std::enable_shared_from_this<StubOrigin::Session> {
+   public:
+    Session(tcp::socket socket, StubOrigin& origin)
+        : socket_(std::move(socket)), timer_(socket_.get_executor()), origin_(origin) {}
+
+    void start() { read_request(); }
+
+   private:
+    void read_request() {
+        auto self(shared_from_this());
+        boost::asio::async_read_until(socket_, buffer_, "\r\n\r\n",
+                                      [this, self](boost::system::error_code ec, std::size_t size) {
+                                          if (ec) {
+                                              return;
+                                          }
+                                          // A HEAD response has no body, or
+                                          // the next one on the connection
+                                          // would start with it.
+                                          head_ = std::string_view(static_cast<const char*>(buffer_.data().data()),
+                                                                   std::min<size_t>(size, 5)) == "HEAD ";
+                                          buffer_.consume(size);
+                                          respond();
+                                      });
+    }
+
+    void respond() {
+        thread_local std::mt19937_64 random{std::random_device{}()};
+        const StubOriginConfig& config = origin_.config_;
+        const double roll = std::uniform_real_distribution<double>(0, 1)(random);
+        if (roll < config.hang_rate) {
+            origin_.hung_++;
+            // Keeps the connection open, unanswered, until the client gives up.
+            read_request();
+            return;
+        }
+        const bool error = roll < config.hang_rate + config.error_rate;
+        std::chrono::microseconds latency;
+        if (roll < config.hang_rate + config.error_rate + config.slow_rate && !error) {
+            latency = config.slow_latency;
+        } else {
+            latency = drawLatency(config, random);
+        }
+        timer_.expires_after(latency);
+        auto self(shared_from_this());
+        timer_.async_wait([this, self, error](boost::system::error_code ec) {
+            if (ec) {
+                return;
+            }
+            if (error) {
+                origin_.errors_++;
+            }
+            origin_.served_++;
+            response_ = error ? "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n"
+                              : "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n";
+            if (!error && !head_) {
+                response_ += "OK";
+            }
+            boost::asio::async_write(socket_, boost::asio::buffer(response_),
+                                     [this, self](boost::system::error_code ec, std::size_t) {
+                                         if (!ec) {
+                                             read_request();
+                                         }
+                                     });
+        });
+    }
+
+    static std::chrono::microseconds drawLatency(const StubOriginConfig& config, std::mt19937_64& random) {
+        const auto mean = static_cast<double>(std::chrono::microseconds(config.latency).count());
+        double micros = mean;
+        switch (config.distribution) {
+            case StubOriginConfig::Distribution::Fixed:
+                break;
+            case StubOriginConfig::Distribution::Uniform:
+                micros = std::uniform_real_distribution<double>(0, 2 * mean)(random);
+                break;
+            case StubOriginConfig::Distribution::Exponential:
+                if (mean > 0) {
+                    micros = std::exponential_distribution<double>(1 / mean)(random);
+                }
+                break;
+        }
+        return std::chrono::microseconds(static_cast<long long>(micros));
+    }
+
+    tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    boost::asio::streambuf buffer_;
+    std::string response_;
+    bool head_ = false;
+    StubOrigin& origin_;
+};
+
+StubOrigin::StubOrigin(const StubOriginConfig& config)
+    : config_(config), acceptor_(io_context_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)) {
+    port_ = acceptor_.local_endpoint().port();
+    accept();
+    for (size_t i = 0; i < std::max<size_t>(config.threads, 1); i++) {
+        threads_.emplace_back([this] { io_context_.run(); });
+    }
+}
+
+StubOrigin::~StubOrigin() {
+    io_context_.stop();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void StubOrigin::accept() {
+    acceptor_.async_accept(boost::asio::make_strand(io_context_), [this](boost::system::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            std::make_shared<Session>(std::move(socket), *this)->start();
+        }
+        accept();
+    });
+}
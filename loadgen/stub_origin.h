@@ -0,0 +1,54 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StubOriginConfig {
+    enum class Distribution { Fixed, Uniform, Exponential };
+
+    // Latency of a normal response: fixed, uniform in [0, 2 * mean] or
+    // exponential with this mean.
+    std::chrono::milliseconds latency{20};
+    Distribution distribution = Distribution::Exponential;
+    // Share of responses that are 500 Internal Server Error.
+    double error_rate = 0;
+    // Share of responses delayed by slow_latency instead.
+    double slow_rate = 0;
+    std::chrono::milliseconds slow_latency{2000};
+    // Share of requests that are never answered.
+    double hang_rate = 0;
+    size_t threads = 2;
+};
+
+// Local HTTP origin for load tests. Every request, whatever its path, is
+// answered after a latency drawn from the configured distribution, with a
+// 500 or not at all at the configured rates. Connections are kept alive.
+class StubOrigin {
+   public:
+    explicit StubOrigin(const StubOriginConfig& config);
+    ~StubOrigin();
+
+    [[nodiscard]] unsigned short port() const { return port_; }
+    [[nodiscard]] size_t served() const { return served_.load(); }
+    [[nodiscard]] size_t errors() const { return errors_.load(); }
+    [[nodiscard]] size_t hung() const { return hung_.load(); }
+
+   private:
+    class Session;
+
+    void accept();
+
+    StubOriginConfig config_;
+    boost::asio::io_context io_context_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    unsigned short port_ = 0;
+    std::atomic<size_t> served_ = 0;
+    std::atomic<size_t> errors_ = 0;
+    std::atomic<size_t> hung_ = 0;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,676 @@
+#include "log_db.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include "compression.h"
+#include "metrics.h"
+#include "timestamps.h"
+
+namespace {
+
+// One result. The URL follows the header, and the record is padded to 8
+// bytes so that every header is aligned in the map.
+struct RecordHeader {
+    // Whole record, padding included; 0 where the records of a segment end.
+    uint32_t size;
+    // crc32 of the record past this field.
+    uint32_t checksum;
+    int64_t id;
+    int64_t created_at;
+    int64_t timings[kPhases.size()];
+    int32_t request_id;
+    int32_t http_status;
+    int32_t response_time;
+    uint32_t url_size;
+};
+static_assert(sizeof(RecordHeader) == 88);
+
+// One request in the request log, followed by its body.
+struct RequestHeader {
+    uint32_t size;
+    uint32_t checksum;
+    int64_t created_at;
+    int32_t id;
+    uint32_t encoding;
+    uint32_t content_size;
+    uint32_t reserved;
+};
+static_assert(sizeof(RequestHeader) == 32);
+
+constexpr const char* kRequestLog = "requests.log";
+constexpr const char* kSegmentPrefix = "results-";
+constexpr const char* kSegmentSuffix = ".seg";
+
+// Bodies shorter than this are stored as they are.
+constexpr size_t kCompressMinSize = 128;
+constexpr uint32_t kEncodingRaw = 0;
+constexpr uint32_t kEncodingDeflate = 1;
+// A record without a body that takes the request back.
+constexpr uint32_t kEncodingRemoved = 2;
+constexpr uint64_t kRemovedRequest = UINT64_MAX;
+
+// Deflated body when compression is on and makes it smaller; empty when it
+// is stored as it is.
+std::string deflatedContent(const std::string& content, bool compressContent) {
+    if (!compressContent || content.size() < kCompressMinSize) {
+        return {};
+    }
+    std::string compressed = compress(content);
+    return compressed.size() < content.size() ? compressed : std::string();
+}
+
+constexpr size_t padded(size_t size) {
+    return (size + 7) & ~size_t{7};
+}
+
+uint32_t checksum(const char* record, size_t size) {
+    constexpr size_t skip = 2 * sizeof(uint32_t);
+    return static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(record + skip), static_cast<uInt>(size - skip)));
+}
+
+// Header of the record at offset, or nullopt where the valid records end.
+std::optional<RecordHeader> recordAt(const char* data, size_t end, size_t offset) {
+    RecordHeader header;
+    if (end - offset < sizeof(RecordHeader)) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, data + offset, sizeof(header));
+    if (header.size < sizeof(RecordHeader) || header.size % 8 != 0 || header.size > end - offset ||
+        header.url_size > header.size - sizeof(RecordHeader) ||
+        checksum(data + offset, header.size) != header.checksum) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+// Calls visit(header, offset) for every valid record; returns where they
+// end.
+template <typename Visit>
+size_t scan(const LogSegment& segment, const Visit& visit) {
+    size_t offset = sizeof(LogSegment::Header);
+    while (auto header = recordAt(segment.data(), segment.size(), offset)) {
+        visit(*header, offset);
+        offset += header->size;
+    }
+    return offset;
+}
+
+bool passes(const RecordHeader& header, const ResultFilter& filter) {
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        if ((filter.min_us[i] && header.timings[i] < *filter.min_us[i]) ||
+            (filter.max_us[i] && header.timings[i] > *filter.max_us[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+LogDb::LogDb(const std::string& directory, const LogDbConfig& config)
+    : m_directory(directory), m_config(config) {
+    if (m_config.segment_bytes <= sizeof(LogSegment::Header) + sizeof(RecordHeader) ||
+        m_config.segment_bytes > UINT32_MAX) {
+        throw std::invalid_argument("Log segments must hold a record and stay below 4 GiB");
+    }
+    std::filesystem::create_directories(m_directory);
+    openRequests();
+    openSegments();
+    const uint64_t seq = next_seq++;
+    auto segment = std::shared_ptr<LogSegment>(
+        LogSegment::create(segmentPath(seq), seq, m_config.segment_bytes, LogSegment::Header{}));
+    active = segment.get();
+    segments.emplace(seq, std::move(segment));
+}
+
+LogDb::~LogDb() {
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+    std::unique_lock lock(mtx);
+    if (active != nullptr) {
+        active->seal();
+    }
+    if (requests_fd >= 0) {
+        ::close(requests_fd);
+    }
+}
+
+std::string LogDb::segmentPath(uint64_t seq) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s%012llu%s", kSegmentPrefix, static_cast<unsigned long long>(seq), kSegmentSuffix);
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+void LogDb::openRequests() {
+    const std::string path = (std::filesystem::path(m_directory) / kRequestLog).string();
+    requests_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (requests_fd < 0) {
+        throw systemError("Can't open request log", path);
+    }
+    struct stat st {};
+    if (::fstat(requests_fd, &st) != 0) {
+        throw systemError("Can't stat request log", path);
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        return;
+    }
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, requests_fd, 0);
+    if (mapped == MAP_FAILED) {
+        throw systemError("Can't map request log", path);
+    }
+    const char* data = static_cast<const char*>(mapped);
+    size_t offset = 0;
+    while (size - offset >= sizeof(RequestHeader)) {
+        RequestHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (header.size < sizeof(RequestHeader) || header.size > size - offset ||
+            header.content_size > header.size - sizeof(RequestHeader) ||
+            header.id < 1 || header.id > static_cast<int32_t>(request_offsets.size() + 1) ||
+            checksum(data + offset, header.size) != header.checksum) {
+            break;
+        }
+        // An id seen before is a body that replaces the earlier one.
+        const uint64_t recordOffset = header.encoding == kEncodingRemoved ? kRemovedRequest : offset;
+        if (static_cast<size_t>(header.id) <= request_offsets.size()) {
+            request_offsets[static_cast<size_t>(header.id) - 1] = recordOffset;
+        } else {
+            request_offsets.push_back(recordOffset);
+        }
+        offset += header.size;
+    }
+    ::munmap(mapped, size);
+    // A request cut short by a crash was never acknowledged.
+    if (offset < size && ::ftruncate(requests_fd, static_cast<off_t>(offset)) != 0) {
+        throw systemError("Can't truncate request log", path);
+    }
+    requests_size = offset;
+}
+
+void LogDb::openSegments() {
+    for (const auto& entry : std::filesystem::directory_iterator(m_directory)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(kSegmentPrefix, 0) != 0 || !name.ends_with(kSegmentSuffix)) {
+            continue;
+        }
+        const std::string digits = name.substr(std::strlen(kSegmentPrefix),
+                                               name.size() - std::strlen(kSegmentPrefix) - std::strlen(kSegmentSuffix));
+        const uint64_t seq = std::stoull(digits);
+        segments.emplace(seq, std::shared_ptr<LogSegment>(LogSegment::open(entry.path().string(), seq)));
+        next_seq = std::max<uint64_t>(next_seq, seq + 1);
+    }
+    recoverCompactions();
+
+    std::unordered_map<int, std::vector<std::pair<int64_t, Ref>>> found;
+    for (auto& [seq, segment] : segments) {
+        const size_t end = scan(*segment, [&](const RecordHeader& header, size_t offset) {
+            found[header.request_id].emplace_back(header.id, Ref{segment.get(), static_cast<uint32_t>(offset)});
+            next_id = std::max<int64_t>(next_id, header.id + 1);
+        });
+        // Whatever follows the last valid record was being written when
+        // the process stopped.
+        if (end < segment->size()) {
+            segment->truncate(end);
+        }
+    }
+    for (auto& [requestId, records] : found) {
+        std::sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        auto& refs = index[requestId];
+        refs.reserve(records.size());
+        for (const auto& [id, ref] : records) {
+            refs.push_back(ref);
+        }
+    }
+}
+
+void LogDb::recoverCompactions() {
+    std::map<uint64_t, std::vector<uint64_t>> compactions;
+    std::set<uint64_t> broken;
+    for (const auto& [seq, segment] : segments) {
+        const auto& header = segment->header();
+        if ((header.flags & LogSegment::kCompacted) == 0) {
+            continue;
+        }
+        compactions[header.compaction].push_back(seq);
+        if ((header.flags & LogSegment::kComplete) == 0) {
+            broken.insert(header.compaction);
+        }
+    }
+    std::vector<uint64_t> obsolete;
+    for (const auto& [compaction, outputs] : compactions) {
+        const auto& header = segments.at(outputs.front())->header();
+        if (broken.count(compaction) > 0 || outputs.size() != header.outputs) {
+            // Interrupted: its inputs are all still there.
+            obsolete.insert(obsolete.end(), outputs.begin(), outputs.end());
+            continue;
+        }
+        for (const auto& [seq, segment] : segments) {
+            if (seq >= header.inputs_first && seq <= header.inputs_last &&
+                (segment->header().flags & LogSegment::kCompacted) == 0) {
+                obsolete.push_back(seq);
+            }
+        }
+    }
+    for (const uint64_t seq : obsolete) {
+        if (auto it = segments.find(seq); it != segments.end()) {
+            std::filesystem::remove(it->second->path());
+            segments.erase(it);
+        }
+    }
+}
+
+[[nodiscard]] size_t LogDb::getRequestId(const std::string& content) const {
+    const std::string compressed = deflatedContent(content, m_config.compress_content);
+    std::lock_guard<std::mutex> lock(requests_mtx);
+    const auto id = static_cast<int32_t>(request_offsets.size() + 1);
+    const uint64_t offset = requests_size;
+    if (!appendRequest(id, compressed.empty() ? content : compressed,
+                       compressed.empty() ? kEncodingRaw : kEncodingDeflate)) {
+        return 0;
+    }
+    request_offsets.push_back(offset);
+    return static_cast<size_t>(id);
+}
+
+bool LogDb::setRequestContent(const int requestId, const std::string& content, bool deflated) {
+    const std::string compressed = deflated ? std::string() : deflatedContent(content, m_config.compress_content);
+    std::lock_guard<std::mutex> lock(requests_mtx);
+    if (!requestOffset(requestId)) {
+        return false;
+    }
+    const uint64_t offset = requests_size;
+    if (!appendRequest(requestId, compressed.empty() ? content : compressed,
+                       deflated || !compressed.empty() ? kEncodingDeflate : kEncodingRaw)) {
+        return false;
+    }
+    request_offsets[static_cast<size_t>(requestId) - 1] = offset;
+    return true;
+}
+
+bool LogDb::removeRequest(const int requestId) {
+    std::lock_guard<std::mutex> lock(requests_mtx);
+    if (!requestOffset(requestId) || !appendRequest(requestId, "", kEncodingRemoved)) {
+        return false;
+    }
+    request_offsets[static_cast<size_t>(requestId) - 1] = kRemovedRequest;
+    return true;
+}
+
+[[nodiscard]] std::optional<uint64_t> LogDb::requestOffset(int requestId) const {
+    if (requestId < 1 || static_cast<size_t>(requestId) > request_offsets.size() ||
+        request_offsets[static_cast<size_t>(requestId) - 1] == kRemovedRequest) {
+        return std::nullopt;
+    }
+    return request_offsets[static_cast<size_t>(requestId) - 1];
+}
+
+bool LogDb::appendRequest(int32_t id, const std::string& stored, uint32_t encoding) const {
+    RequestHeader header{};
+    header.size = static_cast<uint32_t>(padded(sizeof(RequestHeader) + stored.size()));
+    header.created_at = nowMillis();
+    header.id = id;
+    header.encoding = encoding;
+    header.content_size = static_cast<uint32_t>(stored.size());
+    std::string bytes(header.size, '\0');
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), stored.data(), stored.size());
+    header.checksum = checksum(bytes.data(), bytes.size());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (::write(requests_fd, bytes.data(), bytes.size()) != static_cast<ssize_t>(bytes.size())) {
+        // A partial record would hide every later one from the scan, so
+        // the log is cut back to the last whole one.
+        [[maybe_unused]] const int rc = ::ftruncate(requests_fd, static_cast<off_t>(requests_size));
+        return false;
+    }
+    requests_size += bytes.size();
+    return true;
+}
+
+std::optional<std::string> LogDb::requestContent(const int requestId) {
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(requests_mtx);
+        auto found = requestOffset(requestId);
+        if (!found) {
+            return std::nullopt;
+        }
+        offset = *found;
+    }
+    RequestHeader header;
+    if (::pread(requests_fd, &header, sizeof(header), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(header))) {
+        return std::nullopt;
+    }
+    std::string content(header.content_size, '\0');
+    if (::pread(requests_fd, content.data(), content.size(), static_cast<off_t>(offset + sizeof(header))) !=
+        static_cast<ssize_t>(content.size())) {
+        return std::nullopt;
+    }
+    if (header.encoding == kEncodingDeflate) {
+        return decompress(content);
+    }
+    return content;
+}
+
+bool LogDb::requestIdExists(const int requestId) {
+    std::lock_guard<std::mutex> lock(requests_mtx);
+    return requestOffset(requestId).has_value();
+}
+
+int LogDb::lastRequestId() {
+    std::lock_guard<std::mutex> lock(requests_mtx);
+    return static_cast<int>(request_offsets.size());
+}
+
+bool LogDb::insert(const Url& url) {
+    return insert(std::vector<Url>{url});
+}
+
+bool LogDb::insert(const std::vector<Url>& urls) {
+    const auto started = std::chrono::steady_clock::now();
+    const size_t room = m_config.segment_bytes - sizeof(LogSegment::Header);
+    if (std::any_of(urls.begin(), urls.end(),
+                    [room](const Url& url) { return padded(sizeof(RecordHeader) + url.url.size()) > room; })) {
+        return false;
+    }
+    {
+        std::unique_lock lock(mtx);
+        std::vector<std::shared_ptr<LogSegment>> spares;
+        if (!reserveSegments(urls, spares)) {
+            return false;
+        }
+        for (const auto& url : urls) {
+            append(url, spares);
+        }
+    }
+    metrics().db_insert_duration.observe(std::chrono::steady_clock::now() - started);
+    metrics().db_rows.add(urls.size());
+    return true;
+}
+
+bool LogDb::reserveSegments(const std::vector<Url>& urls, std::vector<std::shared_ptr<LogSegment>>& spares) {
+    size_t free = active->sealed() ? 0 : active->capacity() - active->size();
+    size_t needed = 0;
+    for (const auto& url : urls) {
+        const size_t size = padded(sizeof(RecordHeader) + url.url.size());
+        if (size > free) {
+            needed++;
+            free = m_config.segment_bytes - sizeof(LogSegment::Header);
+        }
+        free -= size;
+    }
+    try {
+        for (size_t i = 0; i < needed; i++) {
+            const uint64_t seq = next_seq++;
+            spares.push_back(std::shared_ptr<LogSegment>(
+                LogSegment::create(segmentPath(seq), seq, m_config.segment_bytes, LogSegment::Header{})));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        for (const auto& spare : spares) {
+            std::error_code ec;
+            std::filesystem::remove(spare->path(), ec);
+        }
+        spares.clear();
+        return false;
+    }
+    return true;
+}
+
+// The record is laid out in a reused buffer and copied into the map in
+// one go; mtx is held exclusively.
+void LogDb::append(const Url& url, std::vector<std::shared_ptr<LogSegment>>& spares) {
+    RecordHeader header{};
+    header.size = static_cast<uint32_t>(padded(sizeof(RecordHeader) + url.url.size()));
+    header.id = next_id++;
+    header.created_at = nowMillis();
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        header.timings[i] = url.timings.*kPhases[i].second;
+    }
+    header.request_id = url.request_id;
+    header.http_status = url.http_status;
+    header.response_time = url.response_time;
+    header.url_size = static_cast<uint32_t>(url.url.size());
+    record.assign(header.size, '\0');
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), url.url.data(), url.url.size());
+    header.checksum = checksum(record.data(), record.size());
+    std::memcpy(record.data(), &header, sizeof(header));
+
+    size_t offset = active->append(record.data(), record.size());
+    if (offset == 0) {
+        rotate(spares);
+        offset = active->append(record.data(), record.size());
+    }
+    index[url.request_id].push_back(Ref{active, static_cast<uint32_t>(offset)});
+}
+
+void LogDb::rotate(std::vector<std::shared_ptr<LogSegment>>& spares) {
+    active->seal();
+    std::shared_ptr<LogSegment> segment = std::move(spares.front());
+    spares.erase(spares.begin());
+    active = segment.get();
+    segments.emplace(segment->seq(), std::move(segment));
+
+    if (m_config.compact_segments == 0) {
+        return;
+    }
+    const auto uncompacted = std::count_if(segments.begin(), segments.end(), [this](const auto& entry) {
+        return entry.second.get() != active && (entry.second->header().flags & LogSegment::kCompacted) == 0;
+    });
+    if (static_cast<size_t>(uncompacted) >= m_config.compact_segments && !compacting.exchange(true)) {
+        // The last compaction is done once compacting is false again.
+        if (compactor.joinable()) {
+            compactor.join();
+        }
+        try {
+            compactor = std::thread([this] {
+                compact();
+                compacting = false;
+            });
+        } catch (const std::system_error& e) {
+            std::cerr << "Error: can't start log compaction: " << e.what() << std::endl;
+            compacting = false;
+        }
+    }
+}
+
+bool LogDb::compact() {
+    std::lock_guard<std::mutex> guard(compaction_mtx);
+    try {
+        return compactSegments();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: log compaction failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// compaction_mtx is held.
+bool LogDb::compactSegments() {
+    // Sealed segments never change, so they are read without the lock.
+    std::vector<std::shared_ptr<LogSegment>> inputs;
+    {
+        std::shared_lock lock(mtx);
+        for (const auto& [seq, segment] : segments) {
+            if (segment.get() != active && (segment->header().flags & LogSegment::kCompacted) == 0) {
+                inputs.push_back(segment);
+            }
+        }
+    }
+    if (inputs.size() < 2) {
+        return false;
+    }
+
+    struct Entry {
+        int request_id;
+        int64_t id;
+        const LogSegment* segment;
+        uint32_t offset;
+        uint32_t size;
+    };
+    std::vector<Entry> entries;
+    for (const auto& segment : inputs) {
+        scan(*segment, [&](const RecordHeader& header, size_t offset) {
+            entries.push_back(Entry{header.request_id, header.id, segment.get(), static_cast<uint32_t>(offset), header.size});
+        });
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.request_id != rhs.request_id ? lhs.request_id < rhs.request_id : lhs.id < rhs.id;
+    });
+
+    LogSegment::Header header{};
+    header.flags = LogSegment::kCompacted;
+    header.inputs_first = inputs.front()->seq();
+    header.inputs_last = inputs.back()->seq();
+    std::vector<std::unique_ptr<LogSegment>> outputs;
+    std::unordered_map<int, std::vector<Ref>> refs;
+    // Outputs of a compaction that fails are removed rather than left for
+    // the next open to drop.
+    struct Cleanup {
+        std::vector<std::unique_ptr<LogSegment>>& outputs;
+        bool done = false;
+        ~Cleanup() {
+            if (done) {
+                return;
+            }
+            for (const auto& output : outputs) {
+                std::error_code ec;
+                std::filesystem::remove(output->path(), ec);
+            }
+        }
+    } cleanup{outputs};
+    for (const auto& entry : entries) {
+        size_t offset = outputs.empty() ? 0 : outputs.back()->append(entry.segment->data() + entry.offset, entry.size);
+        if (offset == 0) {
+            if (!outputs.empty()) {
+                outputs.back()->seal();
+            }
+            const uint64_t seq = next_seq++;
+            if (outputs.empty()) {
+                header.compaction = seq;
+            }
+            outputs.push_back(LogSegment::create(segmentPath(seq), seq, m_config.segment_bytes, header));
+            offset = outputs.back()->append(entry.segment->data() + entry.offset, entry.size);
+        }
+        refs[entry.request_id].push_back(Ref{outputs.back().get(), static_cast<uint32_t>(offset)});
+    }
+    // Only once every output is on disk do they replace the inputs; until
+    // then, opening the log drops them.
+    for (auto& output : outputs) {
+        output->seal();
+    }
+    for (auto& output : outputs) {
+        output->markComplete(static_cast<uint32_t>(outputs.size()));
+    }
+    cleanup.done = true;
+
+    {
+        std::unique_lock lock(mtx);
+        std::set<const LogSegment*> replaced;
+        for (const auto& segment : inputs) {
+            replaced.insert(segment.get());
+            segments.erase(segment->seq());
+        }
+        for (auto& [requestId, moved] : refs) {
+            auto& current = index[requestId];
+            std::vector<Ref> kept;
+            for (const auto& ref : current) {
+                if (replaced.count(ref.segment) == 0) {
+                    kept.push_back(ref);
+                }
+            }
+            // Results in segments before and after the inputs stay where
+            // they are.
+            if (!kept.empty()) {
+                moved.insert(moved.end(), kept.begin(), kept.end());
+                std::sort(moved.begin(), moved.end(), [](const Ref& lhs, const Ref& rhs) { return idOf(lhs) < idOf(rhs); });
+            }
+            current = std::move(moved);
+        }
+        for (auto& output : outputs) {
+            const uint64_t seq = output->seq();
+            segments.emplace(seq, std::shared_ptr<LogSegment>(std::move(output)));
+        }
+    }
+    for (const auto& segment : inputs) {
+        std::error_code ec;
+        std::filesystem::remove(segment->path(), ec);
+    }
+    return true;
+}
+
+size_t LogDb::segmentCount() const {
+    std::shared_lock lock(mtx);
+    return segments.size();
+}
+
+int64_t LogDb::idOf(const Ref& ref) {
+    int64_t id = 0;
+    std::memcpy(&id, ref.segment->data() + ref.offset + offsetof(RecordHeader, id), sizeof(id));
+    return id;
+}
+
+Url LogDb::decode(const Ref& ref) {
+    const char* record = ref.segment->data() + ref.offset;
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    Url url{header.request_id, std::string(record + sizeof(header), header.url_size), header.http_status,
+            header.response_time, formatMillis(header.created_at), header.id};
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        url.timings.*kPhases[i].second = header.timings[i];
+    }
+    return url;
+}
+
+std::vector<Url> LogDb::find(const int requestId) {
+    std::vector<Url> urls;
+    std::shared_lock lock(mtx);
+    auto it = index.find(requestId);
+    if (it == index.end()) {
+        return urls;
+    }
+    urls.reserve(it->second.size());
+    for (const auto& ref : it->second) {
+        urls.push_back(decode(ref));
+    }
+    return urls;
+}
+
+std::vector<Url> LogDb::find(const int requestId, long long afterId, size_t limit, const ResultFilter& filter) {
+    std::vector<Url> urls;
+    std::shared_lock lock(mtx);
+    auto it = index.find(requestId);
+    if (it == index.end()) {
+        return urls;
+    }
+    const auto& refs = it->second;
+    auto ref = std::partition_point(refs.begin(), refs.end(), [afterId](const Ref& r) { return idOf(r) <= afterId; });
+    for (; ref != refs.end() && urls.size() < limit; ++ref) {
+        if (!filter.empty()) {
+            RecordHeader header;
+            std::memcpy(&header, ref->segment->data() + ref->offset, sizeof(header));
+            if (!passes(header, filter)) {
+                continue;
+            }
+        }
+        urls.push_back(decode(*ref));
+    }
+    return urls;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "database_interface.h"
+#include "log_segment.h"
+#include "url.h"
+
+struct LogDbConfig {
+    // Capacity of a segment file; a full one is sealed and a new one
+    // started.
+    size_t segment_bytes = 64 * 1024 * 1024;
+    // Sealed segments that start a compaction in the background (0 - only
+    // compact() compacts).
+    size_t compact_segments = 8;
+    bool compress_content = false;
+};
+
+// Results kept in append-only segment files of fixed-layout records instead
+// of SQL tables, for deployments that only store results and read them
+// back by request. Records are copied into a memory-mapped segment and
+// read straight from the map through an in-memory index of request id to
+// record offsets, rebuilt by scanning the segments on open. Compaction
+// rewrites sealed segments so that the results of each request lie
+// together. Request bodies go to a log of their own.
+class LogDb : public DatabaseInterface {
+   public:
+    // Opens or creates the log in directory; throws if it cannot.
+    explicit LogDb(const std::string& directory, const LogDbConfig& config = {});
+    ~LogDb() override;
+    LogDb(const LogDb&) = delete;
+    LogDb& operator=(const LogDb&) = delete;
+
+    [[nodiscard]] size_t getRequestId(const std::string& content) const override;
+    // Appends the new body under the id of the request; the scan on open
+    // keeps the last body of each id.
+    bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) override;
+    bool removeRequest(const int requestId) override;
+    bool insert(const Url& url) override;
+    // Appends all rows or, if one cannot fit in a segment, none.
+    bool insert(const std::vector<Url>& urls) override;
+    std::vector<Url> find(const int requestId) override;
+    std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                          const ResultFilter& filter = {}) override;
+    bool requestIdExists(const int requestId) override;
+    int lastRequestId() override;
+    std::optional<std::string> requestContent(const int requestId);
+
+    // Rewrites the sealed segments not compacted yet into new ones holding
+    // the results of each request in a row; false if there were fewer than
+    // two or the new ones could not be written.
+    bool compact();
+    [[nodiscard]] size_t segmentCount() const;
+
+   private:
+    struct Ref {
+        const LogSegment* segment;
+        uint32_t offset;
+    };
+
+    void openRequests();
+    // Appends a request record of the body as stored in the encoding;
+    // requests_mtx must be held.
+    bool appendRequest(int32_t id, const std::string& stored, uint32_t encoding) const;
+    // Log offset of a live request; requests_mtx must be held.
+    [[nodiscard]] std::optional<uint64_t> requestOffset(int requestId) const;
+    void openSegments();
+    // Drops the leftovers of a compaction interrupted before it completed,
+    // or the segments replaced by one that completed.
+    void recoverCompactions();
+    std::string segmentPath(uint64_t seq) const;
+    // Creates the segments the rows will spill into once the active one is
+    // full, so that appending them cannot fail halfway; false if one could
+    // not be created. mtx must be held exclusively.
+    bool reserveSegments(const std::vector<Url>& urls, std::vector<std::shared_ptr<LogSegment>>& spares);
+    // Seals the active segment and starts the next of the spares; mtx must
+    // be held exclusively.
+    void rotate(std::vector<std::shared_ptr<LogSegment>>& spares);
+    // Callers check that the record fits in an empty segment, and reserve
+    // the segments it may need.
+    void append(const Url& url, std::vector<std::shared_ptr<LogSegment>>& spares);
+    // Writes the compacted segments and swaps them in; throws if a segment
+    // cannot be written.
+    bool compactSegments();
+    static int64_t idOf(const Ref& ref);
+    static Url decode(const Ref& ref);
+
+    std::string m_directory;
+    LogDbConfig m_config;
+
+    // getRequestId, const in the interface, appends to the request log.
+    mutable std::mutex requests_mtx;
+    int requests_fd = -1;
+    // Offset of each request in the log, by id - 1; kRemovedRequest for a
+    // removed one.
+    mutable std::vector<uint64_t> request_offsets;
+    mutable uint64_t requests_size = 0;
+
+    mutable std::shared_mutex mtx;
+    std::map<uint64_t, std::shared_ptr<LogSegment>> segments;
+    LogSegment* active = nullptr;
+    // Records of each request in id order.
+    std::unordered_map<int, std::vector<Ref>> index;
+    int64_t next_id = 1;
+    std::string record;
+    std::atomic<uint64_t> next_seq = 1;
+
+    std::mutex compaction_mtx;
+    std::atomic<bool> compacting = false;
+    std::thread compactor;
+};
@@ -0,0 +1,127 @@
+#include "log_segment.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = {'U', 'R', 'L', 'L', 'O', 'G', '\0', '\1'};
+
+std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+LogSegment::LogSegment(std::string path, uint64_t seq, int fd, char* data, size_t size, size_t capacity, bool sealed)
+    : m_path(std::move(path)), m_seq(seq), m_fd(fd), m_data(data), m_size(size), m_capacity(capacity), m_sealed(sealed) {}
+
+std::unique_ptr<LogSegment> LogSegment::create(const std::string& path, uint64_t seq, size_t capacity,
+                                               const Header& header) {
+    if (capacity <= sizeof(Header)) {
+        throw std::invalid_argument("Log segments need room for records");
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw systemError("Can't create log segment", path);
+    }
+    // The blocks are reserved up front: a write through the map that finds
+    // the disk full would fault instead of failing.
+    if (const int error = ::posix_fallocate(fd, 0, static_cast<off_t>(capacity)); error != 0) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        errno = error;
+        throw systemError("Can't allocate log segment", path);
+    }
+    void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        throw systemError("Can't map log segment", path);
+    }
+    Header stamped = header;
+    std::memcpy(stamped.magic, kMagic, sizeof(kMagic));
+    std::memcpy(data, &stamped, sizeof(Header));
+    return std::unique_ptr<LogSegment>(
+        new LogSegment(path, seq, fd, static_cast<char*>(data), sizeof(Header), capacity, false));
+}
+
+std::unique_ptr<LogSegment> LogSegment::open(const std::string& path, uint64_t seq) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        throw systemError("Can't open log segment", path);
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw systemError("Can't stat log segment", path);
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("Not a log segment: " + path);
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        throw systemError("Can't map log segment", path);
+    }
+    if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        ::munmap(data, size);
+        ::close(fd);
+        throw std::runtime_error("Not a log segment: " + path);
+    }
+    // The size is known only once the records are scanned; until then the
+    // whole file counts.
+    return std::unique_ptr<LogSegment>(new LogSegment(path, seq, fd, static_cast<char*>(data), size, size, true));
+}
+
+LogSegment::~LogSegment() {
+    ::munmap(m_data, m_capacity);
+    ::close(m_fd);
+}
+
+size_t LogSegment::append(const void* bytes, size_t count) {
+    if (m_sealed || count > m_capacity - m_size) {
+        return 0;
+    }
+    const size_t offset = m_size;
+    std::memcpy(m_data + offset, bytes, count);
+    m_size += count;
+    return offset;
+}
+
+void LogSegment::truncate(size_t size) {
+    if (size >= sizeof(Header) && size <= m_capacity && ::ftruncate(m_fd, static_cast<off_t>(size)) == 0) {
+        m_size = size;
+    }
+}
+
+void LogSegment::seal() {
+    if (m_sealed) {
+        return;
+    }
+    sync();
+    truncate(m_size);
+    m_sealed = true;
+}
+
+void LogSegment::markComplete(uint32_t outputs) {
+    Header updated = header();
+    updated.flags |= kComplete;
+    updated.outputs = outputs;
+    // Sealed segments are mapped read-only, so the header goes through the
+    // file.
+    if (::pwrite(m_fd, &updated, sizeof(Header), 0) == static_cast<ssize_t>(sizeof(Header))) {
+        ::fdatasync(m_fd);
+    }
+}
+
+void LogSegment::sync() {
+    ::msync(m_data, m_size, MS_SYNC);
+    ::fdatasync(m_fd);
+}
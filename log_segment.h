@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// One file of an append-only log, memory-mapped whole. A new segment is
+// created with its full capacity allocated on disk and filled by copying
+// records into the map; sealing truncates it to the bytes used. Records are read straight
+// from the map.
+class LogSegment {
+   public:
+    // Leading block of every segment file.
+    struct Header {
+        char magic[8];
+        uint32_t flags;
+        // Segments written by the compaction that wrote this one; set when
+        // it completes.
+        uint32_t outputs;
+        // Sequence number of the first output of the compaction.
+        uint64_t compaction;
+        // Sequence numbers of the segments the compaction replaces.
+        uint64_t inputs_first;
+        uint64_t inputs_last;
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(Header) == 64);
+
+    // Written by compaction, not by inserts.
+    static constexpr uint32_t kCompacted = 1;
+    // The compaction that wrote the segment finished writing it.
+    static constexpr uint32_t kComplete = 2;
+
+    // Throws if the file cannot be created or mapped.
+    static std::unique_ptr<LogSegment> create(const std::string& path, uint64_t seq, size_t capacity,
+                                              const Header& header);
+    // Maps an existing segment for reading; throws if it is not one.
+    static std::unique_ptr<LogSegment> open(const std::string& path, uint64_t seq);
+    ~LogSegment();
+    LogSegment(const LogSegment&) = delete;
+    LogSegment& operator=(const LogSegment&) = delete;
+
+    [[nodiscard]] uint64_t seq() const { return m_seq; }
+    [[nodiscard]] const std::string& path() const { return m_path; }
+    [[nodiscard]] const Header& header() const { return *reinterpret_cast<const Header*>(m_data); }
+    [[nodiscard]] const char* data() const { return m_data; }
+    // Bytes in use, header included.
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] size_t capacity() const { return m_capacity; }
+    [[nodiscard]] bool sealed() const { return m_sealed; }
+
+    // Offset of the bytes appended; 0 if they do not fit.
+    size_t append(const void* bytes, size_t count);
+    // Truncates the file to size bytes, what an interrupted append left
+    // past them is dropped.
+    void truncate(size_t size);
+    // Truncates the file to the bytes used and flushes it; nothing can be
+    // appended afterwards.
+    void seal();
+    // Rewrites the flags and outputs of the header and flushes them.
+    void markComplete(uint32_t outputs);
+    // Flushes the map and the file to disk.
+    void sync();
+
+   private:
+    LogSegment(std::string path, uint64_t seq, int fd, char* data, size_t size, size_t capacity, bool sealed);
+
+    std::string m_path;
+    uint64_t m_seq;
+    int m_fd;
+    char* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    bool m_sealed;
+};
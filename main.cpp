@@ -1,11 +1,21 @@
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <regex>
 #include <string>
+#include <thread>
+#include <vector>
+#include "batch_writer.h"
 #include "curl.h"
+#include "curl_multi.h"
 #include "http_server.h"
+#include "log_db.h"
+#include "monitor_scheduler.h"
+#include "schedule_store.h"
+#include "sharded_sqlite_db.h"
 #include "sqlite_db.h"
+#include "url_stats_store.h"
 
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
@@ -16,7 +26,38 @@ int main(const int argc, char* argv[]) {
     ("help,h", "show help")
     ("max-threads,m", boost::program_options::value<std::size_t>()->default_value(1), "max threads")
     ("database-path,d", boost::program_options::value<std::string>()->default_value("monitoring.db"), "database path")
+    ("compress-requests", boost::program_options::value<bool>()->default_value(true), "store request bodies zlib-compressed")
+    ("store-requests", boost::program_options::value<bool>()->default_value(true), "keep /check_urls bodies with their requests; false keeps memory flat however large the body")
+    ("max-body-size", boost::program_options::value<std::size_t>()->default_value(256), "max megabytes of a request body; larger ones are answered 413 (0 - unbounded)")
+    ("ingest-chunk", boost::program_options::value<std::size_t>()->default_value(1000), "URLs of a /check_urls body still being read that are queued together")
+    ("compression-level", boost::program_options::value<int>()->default_value(6), "zlib level 1-9 of responses sent gzip or deflate to clients that accept it (0 - never compress)")
+    ("compression-min-size", boost::program_options::value<std::size_t>()->default_value(1024), "bytes below which a response is sent uncompressed")
+    ("storage", boost::program_options::value<std::string>()->default_value("sqlite"), "result storage: sqlite, or log - append-only segment files in <database-path>.log")
+    ("log-segment-size", boost::program_options::value<std::size_t>()->default_value(64), "megabytes of one segment file of the log storage")
+    ("db-shards", boost::program_options::value<std::size_t>()->default_value(0), "database files results are spread over, each with its own writer (0 - one file)")
+    ("partition-hours", boost::program_options::value<std::size_t>()->default_value(24), "hours of requests sharing a partition of the sharded database")
+    ("retain-partitions", boost::program_options::value<std::size_t>()->default_value(0), "partitions of the sharded database kept; older ones are deleted with their requests (0 - keep all)")
+    ("db-readers", boost::program_options::value<std::size_t>()->default_value(4), "read-only database connections (0 - reads share the writer connection)")
     ("timeout,t", boost::program_options::value<std::size_t>()->default_value(10), "timeout in seconds")
+    ("max-in-flight,f", boost::program_options::value<std::size_t>()->default_value(0), "max concurrent checks with curl_multi engine (0 - blocking check per thread)")
+    ("max-per-host", boost::program_options::value<std::size_t>()->default_value(8), "max concurrent checks against one host (0 - unlimited)")
+    ("host-rate", boost::program_options::value<double>()->default_value(0), "max checks started against one host per second (0 - unlimited)")
+    ("result-ttl", boost::program_options::value<std::size_t>()->default_value(0), "milliseconds a check result is reused for the same URL (0 - only checks in flight are shared)")
+    ("curl-pool-size", boost::program_options::value<std::size_t>()->default_value(16), "max idle curl handles kept for reuse (0 - no pool)")
+    ("curl-pool-idle", boost::program_options::value<std::size_t>()->default_value(60), "seconds an idle curl handle is kept in the pool")
+    ("flush-size", boost::program_options::value<std::size_t>()->default_value(100), "max results committed in one transaction (0 - commit every result)")
+    ("flush-latency", boost::program_options::value<std::size_t>()->default_value(50), "max time in milliseconds a result waits for its commit")
+    ("flush-queue", boost::program_options::value<std::size_t>()->default_value(10000), "max results waiting for their commit; checks wait for room beyond it (0 - unbounded)")
+    ("io-threads", boost::program_options::value<std::size_t>()->default_value(1), "threads running the HTTP server")
+    ("keep-alive-timeout", boost::program_options::value<std::size_t>()->default_value(5), "seconds an idle HTTP connection is kept open")
+    ("keep-alive-max", boost::program_options::value<std::size_t>()->default_value(100), "max requests served on one HTTP connection")
+    ("result-cache-size", boost::program_options::value<std::size_t>()->default_value(64), "megabytes of cached results of completed requests (0 - no cache)")
+    ("max-queue-urls", boost::program_options::value<std::size_t>()->default_value(1000000), "max URLs accepted and not yet checked; /check_urls answers 503 beyond it (0 - unbounded)")
+    ("max-queue-bytes", boost::program_options::value<std::size_t>()->default_value(256), "max megabytes of URLs accepted and not yet checked (0 - unbounded)")
+    ("client-max-urls", boost::program_options::value<std::size_t>()->default_value(0), "max URLs of one client (X-Client-Id or address) not yet checked; /check_urls answers 429 beyond it (0 - unbounded)")
+    ("stats-checkpoint", boost::program_options::value<std::size_t>()->default_value(60), "seconds between checkpoints of the per-URL stats to the database (0 - stats start empty on restart)")
+    ("schedule-tick", boost::program_options::value<std::size_t>()->default_value(100), "resolution of recurring checks in milliseconds")
+    ("schedule-jitter", boost::program_options::value<double>()->default_value(0.1), "max share of its interval the first run of a recurring check is delayed by")
     ("port,p", boost::program_options::value<unsigned short>()->default_value(8080), "HTTP server port");
 
     boost::program_options::variables_map vm;
@@ -30,18 +71,128 @@ int main(const int argc, char* argv[]) {
 
     const auto maxThreads = vm["max-threads"].as<std::size_t>();
     const auto databasePath = vm["database-path"].as<std::string>();
+    const auto compressRequests = vm["compress-requests"].as<bool>();
+    const auto storeRequests = vm["store-requests"].as<bool>();
+    const auto maxBodySize = vm["max-body-size"].as<std::size_t>();
+    const auto ingestChunk = vm["ingest-chunk"].as<std::size_t>();
+    const auto compressionLevel = vm["compression-level"].as<int>();
+    const auto compressionMinSize = vm["compression-min-size"].as<std::size_t>();
+    if (compressionLevel < 0 || compressionLevel > 9) {
+        std::cerr << "Error: compression level must be 0-9" << std::endl;
+        return 1;
+    }
+    const auto dbReaders = vm["db-readers"].as<std::size_t>();
+    const auto storage = vm["storage"].as<std::string>();
+    if (storage != "sqlite" && storage != "log") {
+        std::cerr << "Error: unknown storage " << storage << std::endl;
+        return 1;
+    }
+    LogDbConfig logConfig;
+    logConfig.segment_bytes = vm["log-segment-size"].as<std::size_t>() * 1024 * 1024;
+    logConfig.compress_content = compressRequests;
+    ShardingConfig sharding;
+    sharding.shards = vm["db-shards"].as<std::size_t>();
+    sharding.partition = std::chrono::hours(vm["partition-hours"].as<std::size_t>());
+    sharding.retained_partitions = vm["retain-partitions"].as<std::size_t>();
+    sharding.compress_content = compressRequests;
     const auto timeout = vm["timeout"].as<std::size_t>();
+    const auto maxInFlight = vm["max-in-flight"].as<std::size_t>();
+    HostLimits hostLimits;
+    hostLimits.max_per_host = vm["max-per-host"].as<std::size_t>();
+    hostLimits.rate_per_host = vm["host-rate"].as<double>();
+    const auto resultTtl = std::chrono::milliseconds(vm["result-ttl"].as<std::size_t>());
+    const auto curlPoolSize = vm["curl-pool-size"].as<std::size_t>();
+    const auto curlPoolIdle = vm["curl-pool-idle"].as<std::size_t>();
+    const auto flushSize = vm["flush-size"].as<std::size_t>();
+    const auto flushLatency = vm["flush-latency"].as<std::size_t>();
+    const auto flushQueue = vm["flush-queue"].as<std::size_t>();
+    const auto ioThreads = vm["io-threads"].as<std::size_t>();
+    const auto keepAliveTimeout = vm["keep-alive-timeout"].as<std::size_t>();
+    const auto keepAliveMax = vm["keep-alive-max"].as<std::size_t>();
+    const auto resultCacheSize = vm["result-cache-size"].as<std::size_t>();
+    AdmissionLimits admissionLimits;
+    admissionLimits.max_urls = vm["max-queue-urls"].as<std::size_t>();
+    admissionLimits.max_bytes = vm["max-queue-bytes"].as<std::size_t>() * 1024 * 1024;
+    admissionLimits.client_max_urls = vm["client-max-urls"].as<std::size_t>();
+    const auto statsCheckpoint = std::chrono::seconds(vm["stats-checkpoint"].as<std::size_t>());
+    const auto scheduleTick = std::chrono::milliseconds(vm["schedule-tick"].as<std::size_t>());
+    const auto scheduleJitter = vm["schedule-jitter"].as<double>();
     const auto port = vm["port"].as<unsigned short>();
 
     try {
         boost::asio::io_context ioContext;
-        auto database = std::make_shared<SqliteDb>(databasePath);
-        auto httpClientFactory = [](const std::string& url, size_t timeout) -> std::unique_ptr<HttpClientInterface> {
+        std::shared_ptr<DatabaseInterface> database;
+        std::shared_ptr<ShardedSqliteDb> shardedDatabase;
+        if (storage == "log") {
+            database = std::make_shared<LogDb>(databasePath + ".log", logConfig);
+        } else if (sharding.shards > 0) {
+            // Readers of the catalog and of every shard file.
+            sharding.read_connections = std::max<std::size_t>(dbReaders / sharding.shards, 1);
+            shardedDatabase = std::make_shared<ShardedSqliteDb>(databasePath, sharding);
+            database = shardedDatabase;
+        } else {
+            database = std::make_shared<SqliteDb>(databasePath, dbReaders, compressRequests);
+        }
+        std::shared_ptr<BatchWriter> batchWriter;
+        if (flushSize > 0) {
+            batchWriter = std::make_shared<BatchWriter>(database, flushSize, std::chrono::milliseconds(flushLatency),
+                                                        flushQueue);
+            database = batchWriter;
+        }
+        std::shared_ptr<CurlPool> curlPool;
+        if (curlPoolSize > 0) {
+            curlPool = std::make_shared<CurlPool>(curlPoolSize, std::chrono::seconds(curlPoolIdle));
+        }
+        auto httpClientFactory = [curlPool](const std::string& url, size_t timeout) -> std::unique_ptr<HttpClientInterface> {
+            if (curlPool) {
+                return std::make_unique<Curl>(url, timeout, curlPool);
+            }
             return std::make_unique<Curl>(url, timeout);
         };
-        HttpServer server(ioContext, port, maxThreads, database, timeout, httpClientFactory);
+        std::shared_ptr<UrlParser> urlParser;
+        if (maxInFlight > 0) {
+            urlParser = std::make_shared<UrlParser>(maxThreads, timeout, database, std::make_shared<CurlMulti>(), maxInFlight, hostLimits, resultTtl);
+        } else {
+            urlParser = std::make_shared<UrlParser>(maxThreads, timeout, database, httpClientFactory, hostLimits, resultTtl);
+        }
+        urlParser->admission()->setLimits(admissionLimits);
+        if (batchWriter) {
+            urlParser->releaseAdmissionOnCommit(*batchWriter);
+        }
+        if (statsCheckpoint.count() > 0) {
+            urlParser->urlStats()->persistTo(std::make_shared<UrlStatsStore>(databasePath), statsCheckpoint);
+        }
+        auto scheduler = std::make_shared<MonitorScheduler>(
+            std::make_shared<ScheduleStore>(databasePath),
+            [urlParser](int requestId, const std::vector<std::string>& urls) { urlParser->addUrls(requestId, urls); },
+            scheduleTick, scheduleJitter);
+        HttpServerConfig serverConfig;
+        // Blocking request handling is bounded by the database connections
+        // anyway, so the pool gets one thread per reader.
+        serverConfig.blocking_threads = dbReaders;
+        serverConfig.keep_alive_timeout = std::chrono::seconds(keepAliveTimeout);
+        serverConfig.keep_alive_max = keepAliveMax;
+        serverConfig.result_cache_bytes = resultCacheSize * 1024 * 1024;
+        serverConfig.max_body_bytes = maxBodySize * 1024 * 1024;
+        serverConfig.ingest_chunk_urls = ingestChunk;
+        serverConfig.store_request_bodies = storeRequests;
+        serverConfig.compression_level = compressionLevel;
+        serverConfig.compression_min_bytes = compressionMinSize;
+        HttpServer server(ioContext, port, database, urlParser, serverConfig, scheduler);
+        // Cached bodies of requests dropped with their partition would
+        // still be served.
+        if (shardedDatabase && server.resultCache()) {
+            shardedDatabase->onDrop([cache = server.resultCache()](int firstKeptId) { cache->eraseBefore(firstKeptId); });
+        }
 
+        std::vector<std::thread> ioThreadPool;
+        for (std::size_t i = 1; i < ioThreads; i++) {
+            ioThreadPool.emplace_back([&ioContext] { ioContext.run(); });
+        }
         ioContext.run();
+        for (auto& thread : ioThreadPool) {
+            thread.join();
+        }
     } catch (std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
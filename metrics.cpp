@@ -0,0 +1,147 @@
+#include "metrics.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+size_t metricShard() {
+    static std::atomic<size_t> next_shard = 0;
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+[[nodiscard]] uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(std::initializer_list<uint64_t> bounds) : bucket_count(bounds.size()) {
+    if (bounds.size() > kMaxBuckets) {
+        throw std::invalid_argument("too many histogram buckets");
+    }
+    std::copy(bounds.begin(), bounds.end(), this->bounds.begin());
+}
+
+void Histogram::observe(uint64_t micros) {
+    const size_t bucket = std::lower_bound(bounds.begin(), bounds.begin() + bucket_count, micros) - bounds.begin();
+    Shard& shard = shards[metricShard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+[[nodiscard]] Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.bounds.assign(bounds.begin(), bounds.begin() + bucket_count);
+    snapshot.cumulative.assign(bucket_count + 1, 0);
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i <= bucket_count; i++) {
+            snapshot.cumulative[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i <= bucket_count; i++) {
+        snapshot.cumulative[i] += snapshot.cumulative[i - 1];
+    }
+    return snapshot;
+}
+
+Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+namespace {
+void appendNumber(std::string& out, uint64_t value) {
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+void appendSeconds(std::string& out, uint64_t micros) {
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<double>(micros) / 1e6);
+    out.append(buffer, end);
+}
+}  // namespace
+
+void MetricsWriter::header(std::string_view name, std::string_view help, std::string_view type) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void MetricsWriter::counter(std::string_view name, std::string_view help, uint64_t value) {
+    header(name, help, "counter");
+    out.append(name).append(" ");
+    appendNumber(out, value);
+    out.append("\n");
+}
+
+void MetricsWriter::secondsCounter(std::string_view name, std::string_view help, uint64_t micros) {
+    header(name, help, "counter");
+    out.append(name).append(" ");
+    appendSeconds(out, micros);
+    out.append("\n");
+}
+
+void MetricsWriter::gauge(std::string_view name, std::string_view help, double value) {
+    header(name, help, "gauge");
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(name).append(" ").append(buffer, end).append("\n");
+}
+
+void MetricsWriter::histogram(std::string_view name, std::string_view help, const Histogram::Snapshot& snapshot) {
+    histogram(name, help, snapshot, appendSeconds);
+}
+
+void MetricsWriter::countHistogram(std::string_view name, std::string_view help,
+                                   const Histogram::Snapshot& snapshot) {
+    histogram(name, help, snapshot, appendNumber);
+}
+
+void MetricsWriter::histogram(std::string_view name, std::string_view help, const Histogram::Snapshot& snapshot,
+                              void (*append)(std::string&, uint64_t)) {
+    header(name, help, "histogram");
+    for (size_t i = 0; i < snapshot.bounds.size(); i++) {
+        out.append(name).append("_bucket{le=\"");
+        append(out, snapshot.bounds[i]);
+        out.append("\"} ");
+        appendNumber(out, snapshot.cumulative[i]);
+        out.append("\n");
+    }
+    out.append(name).append("_bucket{le=\"+Inf\"} ");
+    appendNumber(out, snapshot.cumulative.back());
+    out.append("\n").append(name).append("_sum ");
+    append(out, snapshot.sum);
+    out.append("\n").append(name).append("_count ");
+    appendNumber(out, snapshot.cumulative.back());
+    out.append("\n");
+}
+
+void MetricsWriter::write(const Metrics& metrics) {
+    counter("monitoring_checks_total", "URL checks sent to the network.", metrics.checks.value());
+    histogram("monitoring_check_duration_seconds", "Duration of URL checks.", metrics.check_duration.snapshot());
+    secondsCounter("monitoring_worker_busy_seconds_total", "Time worker threads spent handling URLs.",
+                   metrics.worker_busy_micros.value());
+    counter("monitoring_db_rows_total", "Result rows inserted into the database.", metrics.db_rows.value());
+    counter("monitoring_db_failed_rows_total", "Result rows dropped after the database refused them.",
+            metrics.db_failed_rows.value());
+    histogram("monitoring_db_insert_duration_seconds", "Duration of database inserts, single rows and batches.",
+              metrics.db_insert_duration.snapshot());
+    counter("monitoring_db_commits_total", "Transactions committed by the batched writer.",
+            metrics.db_commits.value());
+    countHistogram("monitoring_db_commit_rows", "Result rows in each transaction of the batched writer.",
+                   metrics.db_commit_rows.snapshot());
+    counter("monitoring_curl_pool_hits_total", "Easy handles taken from the curl pool.",
+            metrics.curl_pool_hits.value());
+    counter("monitoring_curl_pool_misses_total", "Easy handles created when the curl pool had none.",
+            metrics.curl_pool_misses.value());
+    counter("monitoring_curl_connections_reused_total", "Checks sent over a connection kept by the curl pool.",
+            metrics.curl_connections_reused.value());
+    counter("monitoring_curl_connections_created_total", "Checks that opened a new connection through the curl pool.",
+            metrics.curl_connections_created.value());
+    histogram("monitoring_http_request_duration_seconds", "Time to produce HTTP API responses.",
+              metrics.http_request_duration.snapshot());
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Counters and fixed-bucket histograms for /metrics. Every thread updates
+// its own shard, a cache line of relaxed atomics, so hot paths on different
+// threads never contend on a line; the shards are summed only on scrape.
+inline constexpr size_t kMetricShards = 16;
+
+// Shard of the calling thread; threads are spread over the shards round-robin.
+size_t metricShard();
+
+class Counter {
+   public:
+    void add(uint64_t n = 1) {
+        shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t value() const;
+
+   private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Shard {
+        std::atomic<uint64_t> value = 0;
+    };
+
+    std::array<Shard, kMetricShards> shards;
+};
+
+// Observations are in microseconds and exported in seconds, or plain
+// counts written with MetricsWriter::countHistogram.
+class Histogram {
+   public:
+    static constexpr size_t kMaxBuckets = 15;
+
+    struct Snapshot {
+        std::vector<uint64_t> bounds;
+        // Observations at or below each bound, then the total.
+        std::vector<uint64_t> cumulative;
+        uint64_t sum = 0;
+    };
+
+    // Upper bounds of the buckets in microseconds, ascending.
+    Histogram(std::initializer_list<uint64_t> bounds);
+
+    void observe(uint64_t micros);
+    void observe(std::chrono::steady_clock::duration elapsed) {
+        observe(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+    [[nodiscard]] Snapshot snapshot() const;
+
+   private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Shard {
+        // The last slot counts observations above every bound.
+        std::array<std::atomic<uint64_t>, kMaxBuckets + 1> counts{};
+        std::atomic<uint64_t> sum = 0;
+    };
+
+    std::array<uint64_t, kMaxBuckets> bounds{};
+    size_t bucket_count = 0;
+    std::array<Shard, kMetricShards> shards;
+};
+
+// Metrics of the hot paths, shared by the whole process.
+struct Metrics {
+    Counter checks;
+    Histogram check_duration{1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+                             1000000, 2500000, 5000000, 10000000};
+    Counter worker_busy_micros;
+    Counter db_rows;
+    // Rows dropped after the database refused their batch.
+    Counter db_failed_rows;
+    Histogram db_insert_duration{10, 50, 100, 250, 500, 1000, 2500, 5000,
+                                 10000, 25000, 50000, 100000};
+    // Transactions of the batched writer and the rows each one held.
+    Counter db_commits;
+    Histogram db_commit_rows{1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000};
+    // Easy handles taken from the curl pool and created for want of one.
+    Counter curl_pool_hits;
+    Counter curl_pool_misses;
+    // Connections checks through the pool reused and opened.
+    Counter curl_connections_reused;
+    Counter curl_connections_created;
+    Histogram http_request_duration{100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                    50000, 100000, 250000, 500000, 1000000};
+};
+
+Metrics& metrics();
+
+inline uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count());
+}
+
+// Prometheus text exposition format.
+class MetricsWriter {
+   public:
+    void counter(std::string_view name, std::string_view help, uint64_t value);
+    // Counter of time kept in microseconds, written in seconds.
+    void secondsCounter(std::string_view name, std::string_view help, uint64_t micros);
+    void gauge(std::string_view name, std::string_view help, double value);
+    void histogram(std::string_view name, std::string_view help, const Histogram::Snapshot& snapshot);
+    // Histogram of plain counts, written as they are.
+    void countHistogram(std::string_view name, std::string_view help, const Histogram::Snapshot& snapshot);
+    // Writes the process-wide metrics.
+    void write(const Metrics& metrics);
+
+    [[nodiscard]] const std::string& text() const { return out; }
+
+   private:
+    void header(std::string_view name, std::string_view help, std::string_view type);
+    void histogram(std::string_view name, std::string_view help, const Histogram::Snapshot& snapshot,
+                   void (*append)(std::string&, uint64_t));
+
+    std::string out;
+};
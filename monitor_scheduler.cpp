@@ -0,0 +1,123 @@
+#include "monitor_scheduler.h"
+#include <algorithm>
+
+MonitorScheduler::MonitorScheduler(const std::shared_ptr<ScheduleStore>& store, Dispatch dispatch,
+                                   std::chrono::milliseconds tick, double jitter)
+    : store(store),
+      dispatch(std::move(dispatch)),
+      tick(std::max(tick, std::chrono::milliseconds(1))),
+      jitter(std::clamp(jitter, 0.0, 1.0)) {
+    if (store) {
+        for (const auto& schedule : store->load()) {
+            insert(schedule);
+        }
+    }
+    thread = std::thread(&MonitorScheduler::run, this);
+}
+
+MonitorScheduler::~MonitorScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        m_stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool MonitorScheduler::add(int requestId, const std::vector<std::pair<std::string, std::chrono::milliseconds>>& urls) {
+    std::vector<Schedule> added;
+    added.reserve(urls.size());
+    for (const auto& [url, interval] : urls) {
+        added.push_back(Schedule{0, requestId, url, interval});
+    }
+    if (store && !store->add(added)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& schedule : added) {
+        if (!store) {
+            schedule.id = next_id++;
+        }
+        insert(schedule);
+    }
+    return true;
+}
+
+// Schedules the store still has would come back on restart, so they are
+// kept running until they are gone from it.
+std::optional<size_t> MonitorScheduler::remove(int requestId) {
+    if (store && !store->remove(requestId)) {
+        return std::nullopt;
+    }
+    std::unique_lock lock(mtx);
+    auto it = by_request.find(requestId);
+    if (it == by_request.end()) {
+        return 0;
+    }
+    const size_t removed = it->second.size();
+    for (const uint64_t id : it->second) {
+        wheel.remove(id);
+        schedules.erase(id);
+    }
+    by_request.erase(it);
+    // Runs taken off the wheel before may still be on their way.
+    dispatched.wait(lock, [this] { return !dispatching; });
+    return removed;
+}
+
+[[nodiscard]] bool MonitorScheduler::isScheduled(int requestId) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return by_request.contains(requestId);
+}
+
+[[nodiscard]] size_t MonitorScheduler::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return schedules.size();
+}
+
+// Called with mtx held, or from the constructor.
+void MonitorScheduler::insert(const Schedule& schedule) {
+    const auto id = static_cast<uint64_t>(schedule.id);
+    const uint64_t interval = std::max<uint64_t>(schedule.interval / tick, 1);
+    const auto maxDelay = static_cast<uint64_t>(static_cast<double>(interval) * jitter);
+    const uint64_t delay = maxDelay == 0 ? 0 : std::uniform_int_distribution<uint64_t>(0, maxDelay)(random);
+    const uint64_t due = tickAt(Clock::now()) + delay;
+    schedules.insert_or_assign(id, Entry{schedule.request_id, schedule.url, interval, due});
+    by_request[schedule.request_id].push_back(id);
+    wheel.add(id, due);
+}
+
+[[nodiscard]] uint64_t MonitorScheduler::tickAt(Clock::time_point time) const {
+    return static_cast<uint64_t>((time - start) / tick);
+}
+
+// Runs that fall behind, say while the machine was suspended, are skipped
+// rather than fired back to back.
+void MonitorScheduler::run() {
+    std::unique_lock lock(mtx);
+    std::unordered_map<int, std::vector<std::string>> due;
+    while (!m_stop) {
+        const uint64_t now = tickAt(Clock::now());
+        wheel.advance(now, [&](uint64_t id) {
+            Entry& entry = schedules.at(id);
+            due[entry.request_id].push_back(entry.url);
+            entry.due = std::max(entry.due + entry.interval, now + 1);
+            wheel.add(id, entry.due);
+        });
+        if (!due.empty()) {
+            dispatching = true;
+            lock.unlock();
+            for (const auto& [requestId, urls] : due) {
+                dispatch(requestId, urls);
+            }
+            due.clear();
+            lock.lock();
+            dispatching = false;
+            dispatched.notify_all();
+            continue;
+        }
+        cv.wait_until(lock, start + wheel.nextTick() * tick, [this] { return m_stop; });
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "schedule_store.h"
+#include "timing_wheel.h"
+
+// Runs recurring checks: every URL of a schedule is handed to dispatch once
+// per its interval, under the request the schedule was created with, so
+// its results accumulate there. Schedules are kept in a timing wheel with
+// tick resolution; the first run of each is delayed by a random share of
+// its interval up to jitter, which spreads schedules created or restored
+// together over time instead of firing them on the same tick forever.
+class MonitorScheduler {
+   public:
+    using Clock = std::chrono::steady_clock;
+    using Dispatch = std::function<void(int requestId, const std::vector<std::string>& urls)>;
+
+    // store may be null, in which case schedules are not persisted.
+    MonitorScheduler(const std::shared_ptr<ScheduleStore>& store, Dispatch dispatch,
+                     std::chrono::milliseconds tick = std::chrono::milliseconds(100),
+                     double jitter = 0.1);
+    ~MonitorScheduler();
+
+    // Schedules every URL with its interval under the request.
+    bool add(int requestId, const std::vector<std::pair<std::string, std::chrono::milliseconds>>& urls);
+    // Returns the number of schedules removed, or nothing if they could not
+    // be removed from the store. No run of them is dispatched once it
+    // returns, so it must not be called from dispatch.
+    std::optional<size_t> remove(int requestId);
+    [[nodiscard]] bool isScheduled(int requestId) const;
+    [[nodiscard]] size_t size() const;
+
+   private:
+    struct Entry {
+        int request_id;
+        std::string url;
+        uint64_t interval;
+        uint64_t due;
+    };
+
+    void insert(const Schedule& schedule);
+    [[nodiscard]] uint64_t tickAt(Clock::time_point time) const;
+    void run();
+
+    std::shared_ptr<ScheduleStore> store;
+    Dispatch dispatch;
+    std::chrono::milliseconds tick;
+    double jitter;
+    Clock::time_point start = Clock::now();
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    // Signalled when a round of runs has been dispatched.
+    std::condition_variable dispatched;
+    bool m_stop = false;
+    bool dispatching = false;
+    TimingWheel wheel;
+    std::unordered_map<uint64_t, Entry> schedules;
+    std::unordered_map<int, std::vector<uint64_t>> by_request;
+    long long next_id = 1;
+    std::mt19937_64 random{std::random_device{}()};
+    std::thread thread;
+};
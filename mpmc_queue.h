@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's
+// array-based design): every cell carries a sequence number that tells
+// producers and consumers whose turn it is, so push and pop are a CAS on
+// their own position counter plus one store.
+template <typename T>
+class MpmcQueue {
+   public:
+    // The capacity is rounded up to a power of two.
+    explicit MpmcQueue(size_t capacity)
+        : mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+          cells(std::make_unique<Cell[]>(mask + 1)) {
+        for (size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // False when the queue is full.
+    bool tryPush(T&& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // False when the queue is empty.
+    bool tryPop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] size_t capacity() const { return mask + 1; }
+
+    // Exact only while no push or pop is running.
+    [[nodiscard]] size_t sizeApprox() const {
+        const size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        const size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+   private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    // The two positions live on separate cache lines, so producers and
+    // consumers do not invalidate each other's counter.
+    alignas(kCacheLine) std::atomic<size_t> enqueue_pos = 0;
+    alignas(kCacheLine) std::atomic<size_t> dequeue_pos = 0;
+};
@@ -0,0 +1,123 @@
+#include "request_tracker.h"
+#include <algorithm>
+
+RequestTracker::Creation::Creation(RequestTracker& tracker) : m_tracker(tracker) {
+    std::lock_guard<std::mutex> lock(m_tracker.mtx);
+    m_floor = m_tracker.max_seen_id;
+    m_tracker.creation_floors.insert(m_floor);
+}
+
+RequestTracker::Creation::~Creation() {
+    std::lock_guard<std::mutex> lock(m_tracker.mtx);
+    m_tracker.creation_floors.erase(m_tracker.creation_floors.find(m_floor));
+}
+
+void RequestTracker::seed(const int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    seen(requestId);
+}
+
+void RequestTracker::add(const int requestId, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    entries[requestId].progress.total += count;
+    seen(requestId);
+}
+
+void RequestTracker::open(const int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries[requestId].open = true;
+    seen(requestId);
+}
+
+void RequestTracker::seen(const int requestId) {
+    max_seen_id = std::max(max_seen_id, requestId);
+}
+
+bool RequestTracker::isCreating(const int requestId) const {
+    return !creation_floors.empty() && requestId > *creation_floors.begin() && !entries.contains(requestId);
+}
+
+void RequestTracker::close(const int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(requestId);
+    if (it == entries.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    entry.open = false;
+    if (entry.progress.done < entry.progress.total) {
+        return;
+    }
+    const Event event{nullptr, entry.progress, true};
+    for (const auto& [id, listener] : entry.listeners) {
+        listener(event);
+    }
+    entries.erase(it);
+}
+
+void RequestTracker::started(const int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (auto it = entries.find(requestId); it != entries.end()) {
+        it->second.progress.in_flight++;
+    }
+}
+
+void RequestTracker::finished(const Url& url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(url.request_id);
+    if (it == entries.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    entry.progress.done++;
+    if (entry.progress.in_flight > 0) {
+        entry.progress.in_flight--;
+    }
+    const Event event{&url, entry.progress, !entry.open && entry.progress.done >= entry.progress.total};
+    for (const auto& [id, listener] : entry.listeners) {
+        listener(event);
+    }
+    if (event.complete) {
+        entries.erase(it);
+    }
+}
+
+[[nodiscard]] std::optional<RequestTracker::Progress> RequestTracker::progress(const int requestId) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(requestId);
+    if (it == entries.end()) {
+        return isCreating(requestId) ? std::optional<Progress>(Progress{}) : std::nullopt;
+    }
+    return it->second.progress;
+}
+
+[[nodiscard]] bool RequestTracker::isComplete(const int requestId) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return !entries.contains(requestId) && !isCreating(requestId);
+}
+
+size_t RequestTracker::listen(const int requestId, Listener listener) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(requestId);
+    if (it == entries.end()) {
+        return 0;
+    }
+    listener(Event{nullptr, it->second.progress, false});
+    const size_t id = next_listener_id++;
+    it->second.listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void RequestTracker::unlisten(const int requestId, size_t listenerId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(requestId);
+    if (it == entries.end()) {
+        return;
+    }
+    std::erase_if(it->second.listeners, [listenerId](const auto& listener) {
+        return listener.first == listenerId;
+    });
+}
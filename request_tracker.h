@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "url.h"
+
+// Progress of the requests whose URLs are still being checked. Listeners
+// registered for a request are told about every stored result and about
+// its completion, after which the request is forgotten.
+class RequestTracker {
+   public:
+    struct Progress {
+        size_t total = 0;
+        size_t done = 0;
+        size_t in_flight = 0;
+    };
+    struct Event {
+        // nullptr for the snapshot a listener receives when registered.
+        const Url* result = nullptr;
+        Progress progress;
+        bool complete = false;
+    };
+    // Called with the tracker locked: it must not block or call back into
+    // the tracker.
+    using Listener = std::function<void(const Event&)>;
+
+    // Held from before a request is created in the database until it is
+    // opened or added. Meanwhile its id is already visible to readers, so
+    // the ids it may get are not taken for complete ones.
+    class Creation {
+       public:
+        explicit Creation(RequestTracker& tracker);
+        ~Creation();
+        Creation(const Creation&) = delete;
+        Creation& operator=(const Creation&) = delete;
+
+       private:
+        RequestTracker& m_tracker;
+        // Highest id the tracker knew when the creation began; the new id
+        // is above it.
+        int m_floor;
+    };
+
+    // Ids up to requestId are of requests created before the tracker, e.g.
+    // before a restart, so they are never taken for ones being created.
+    void seed(const int requestId);
+    void add(const int requestId, size_t count);
+    // URLs may still be added to an open request, so it does not complete
+    // before it is closed, however many of its URLs are done.
+    void open(const int requestId);
+    void close(const int requestId);
+    void started(const int requestId);
+    void finished(const Url& url);
+
+    // nullopt once the request is complete or when it was never added; no
+    // progress yet for an id a creation in progress may have got.
+    [[nodiscard]] std::optional<Progress> progress(const int requestId) const;
+    [[nodiscard]] bool isComplete(const int requestId) const;
+
+    // Returns 0 without registering when the request is not in progress or
+    // not known yet; otherwise the listener is first called with a snapshot
+    // of its progress.
+    size_t listen(const int requestId, Listener listener);
+    void unlisten(const int requestId, size_t listenerId);
+
+   private:
+    struct Entry {
+        Progress progress;
+        bool open = false;
+        std::vector<std::pair<size_t, Listener>> listeners;
+    };
+
+    // Whether the id is not in entries but may be of a request being
+    // created; mtx must be held.
+    [[nodiscard]] bool isCreating(const int requestId) const;
+    void seen(const int requestId);
+
+    mutable std::mutex mtx;
+    std::unordered_map<int, Entry> entries;
+    int max_seen_id = 0;
+    std::multiset<int> creation_floors;
+    size_t next_listener_id = 1;
+};
@@ -0,0 +1,102 @@
+#include "result_cache.h"
+#include <iterator>
+
+ResultCache::ResultCache(size_t maxBytes) : max_bytes(maxBytes) {}
+
+std::shared_ptr<const std::string> ResultCache::get(int requestId, int variant) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto body = touch(requestId, variant);
+    if (body) {
+        m_hits++;
+    } else {
+        m_misses++;
+    }
+    return body;
+}
+
+ResultCache::Found ResultCache::getOrPlain(int requestId, int variant) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Found found{touch(requestId, variant), variant};
+    if (!found.body && variant != 0) {
+        found = Found{touch(requestId, 0), 0};
+    }
+    if (found.body) {
+        m_hits++;
+    } else {
+        m_misses++;
+    }
+    return found;
+}
+
+std::shared_ptr<const std::string> ResultCache::touch(int requestId, int variant) {
+    auto it = entries.find(key(requestId, variant));
+    if (it == entries.end()) {
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->body;
+}
+
+void ResultCache::put(int requestId, std::string body, int variant) {
+    const size_t size = entrySize(body);
+    const uint64_t entryKey = key(requestId, variant);
+    std::lock_guard<std::mutex> lock(mtx);
+    if (auto it = entries.find(entryKey); it != entries.end()) {
+        eraseEntry(it->second);
+    }
+    if (size > max_bytes) {
+        return;
+    }
+    while (m_bytes + size > max_bytes) {
+        eraseEntry(std::prev(lru.end()));
+    }
+    lru.push_front(Entry{entryKey, std::make_shared<const std::string>(std::move(body))});
+    entries.emplace(entryKey, lru.begin());
+    m_bytes += size;
+}
+
+void ResultCache::erase(int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (int variant = 0; variant < kVariants; variant++) {
+        if (auto it = entries.find(key(requestId, variant)); it != entries.end()) {
+            eraseEntry(it->second);
+        }
+    }
+}
+
+void ResultCache::eraseBefore(int requestId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto it = lru.begin(); it != lru.end();) {
+        auto next = std::next(it);
+        if (static_cast<int>(it->key >> 8) < requestId) {
+            eraseEntry(it);
+        }
+        it = next;
+    }
+}
+
+void ResultCache::eraseEntry(std::list<Entry>::iterator it) {
+    m_bytes -= entrySize(*it->body);
+    entries.erase(it->key);
+    lru.erase(it);
+}
+
+[[nodiscard]] size_t ResultCache::hits() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_hits;
+}
+
+[[nodiscard]] size_t ResultCache::misses() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_misses;
+}
+
+[[nodiscard]] size_t ResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size();
+}
+
+[[nodiscard]] size_t ResultCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return m_bytes;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// LRU cache of serialized /get_results bodies keyed by request id and
+// variant: 0 is the body as it is, the others are up to the caller, e.g. its
+// compressed forms. Entries are evicted from the cold end once their total
+// size exceeds maxBytes.
+class ResultCache {
+   public:
+    explicit ResultCache(size_t maxBytes);
+
+    static constexpr int kVariants = 4;
+
+    struct Found {
+        std::shared_ptr<const std::string> body;
+        int variant = 0;
+    };
+
+    // Returns nullptr on a miss.
+    std::shared_ptr<const std::string> get(int requestId, int variant = 0);
+    // The variant, or else the body as it is; either way one hit or miss.
+    Found getOrPlain(int requestId, int variant);
+    void put(int requestId, std::string body, int variant = 0);
+    // Drops every variant of the request.
+    void erase(int requestId);
+    // Drops every variant of the requests with ids below requestId.
+    void eraseBefore(int requestId);
+
+    [[nodiscard]] size_t hits() const;
+    [[nodiscard]] size_t misses() const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t bytes() const;
+
+   private:
+    struct Entry {
+        uint64_t key;
+        std::shared_ptr<const std::string> body;
+    };
+    // Rough per-entry bookkeeping cost: list node, map node and the string.
+    static constexpr size_t kEntryOverhead = 128;
+
+    static size_t entrySize(const std::string& body) { return body.size() + kEntryOverhead; }
+    static uint64_t key(int requestId, int variant) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(requestId)) << 8) | static_cast<uint8_t>(variant);
+    }
+    void eraseEntry(std::list<Entry>::iterator it);
+    // Moves the entry to the hot end; mtx must be held. nullptr on a miss.
+    std::shared_ptr<const std::string> touch(int requestId, int variant);
+
+    size_t max_bytes;
+    mutable std::mutex mtx;
+    std::list<Entry> lru;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+    size_t m_bytes = 0;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "request_tracker.h"
+#include "url.h"
+
+// JSON shapes of the /get_results and /events responses.
+
+inline nlohmann::json progressJson(const RequestTracker::Progress& progress) {
+    return {{"total", progress.total},
+            {"done", progress.done},
+            {"in_flight", progress.in_flight}};
+}
+
+inline nlohmann::json timingsJson(const PhaseTimings& timings) {
+    nlohmann::json timings_json = nlohmann::json::object();
+    for (const auto& [name, phase] : kPhases) {
+        timings_json[std::string(name)] = timings.*phase;
+    }
+    return timings_json;
+}
+
+inline nlohmann::json urlJson(const Url& url) {
+    return {{"id", url.id},
+            {"url", url.url},
+            {"http_status", url.http_status},
+            {"response_time", url.response_time},
+            {"timings", timingsJson(url.timings)},
+            {"created_at", url.created_at}};
+}
+
+// Body of a full /get_results response; progress is set while the request
+// is still being checked.
+inline std::string resultsJson(std::string_view id, const std::optional<RequestTracker::Progress>& progress,
+                               const std::vector<Url>& urls) {
+    nlohmann::json response_json = {{"request_id", id}, {"complete", !progress}};
+    if (progress) {
+        response_json["progress"] = progressJson(*progress);
+    }
+    for (const auto& url : urls) {
+        response_json["urls"].push_back(urlJson(url));
+    }
+    return response_json.dump();
+}
@@ -0,0 +1,93 @@
+#include "schedule_store.h"
+#include <stdexcept>
+
+ScheduleStore::ScheduleStore(const std::string& databasePath)
+    : db(std::make_unique<SqliteConnection>(databasePath, false)) {
+    createTable();
+}
+
+bool ScheduleStore::add(std::vector<Schedule>& schedules) {
+    const char* insert_sql = R"(
+        INSERT INTO schedules (request_id, url, interval_ms)
+        VALUES (?, ?, ?);
+    )";
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db->exec("BEGIN;")) {
+        return false;
+    }
+    for (auto& schedule : schedules) {
+        auto stmt = db->prepare(insert_sql);
+        if (!stmt) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+        sqlite3_bind_int(stmt.get(), 1, schedule.request_id);
+        sqlite3_bind_text(stmt.get(), 2, schedule.url.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt.get(), 3, schedule.interval.count());
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+        schedule.id = sqlite3_last_insert_rowid(db->get());
+    }
+    if (!db->exec("COMMIT;")) {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+    return true;
+}
+
+bool ScheduleStore::remove(int requestId) {
+    const char* delete_sql = R"(
+        DELETE FROM schedules WHERE request_id = ?;
+    )";
+    std::lock_guard<std::mutex> lock(mtx);
+    auto stmt = db->prepare(delete_sql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
+
+std::vector<Schedule> ScheduleStore::load() {
+    std::vector<Schedule> schedules;
+    const char* select_sql = R"(
+        SELECT id, request_id, url, interval_ms
+        FROM schedules
+        ORDER BY id;
+    )";
+    std::lock_guard<std::mutex> lock(mtx);
+    auto stmt = db->prepare(select_sql);
+    if (!stmt) {
+        return schedules;
+    }
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        Schedule schedule;
+        schedule.id = sqlite3_column_int64(stmt.get(), 0);
+        schedule.request_id = sqlite3_column_int(stmt.get(), 1);
+        schedule.url = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 2));
+        schedule.interval = std::chrono::milliseconds(sqlite3_column_int64(stmt.get(), 3));
+        schedules.push_back(std::move(schedule));
+    }
+    return schedules;
+}
+
+void ScheduleStore::createTable() {
+    const char* create_table_sql = R"(
+        CREATE TABLE IF NOT EXISTS schedules (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            request_id INTEGER NOT NULL,
+            url TEXT NOT NULL,
+            interval_ms INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS schedules_request_id ON schedules (request_id);)";
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(db->get(), create_table_sql, nullptr, nullptr, &err_msg);
+
+    if (rc != SQLITE_OK) {
+        std::string error_msg = "SQL error: " + std::string(err_msg);
+        sqlite3_free(err_msg);
+        throw std::runtime_error(error_msg);
+    }
+}
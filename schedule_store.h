@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "sqlite_connection.h"
+
+struct Schedule {
+    long long id = 0;
+    int request_id = 0;
+    std::string url;
+    std::chrono::milliseconds interval{0};
+};
+
+// Recurring checks kept in the schedules table, so they survive restarts.
+// Only the definitions are stored: run times are derived from the interval
+// when the schedules are loaded, so firing them costs no writes.
+class ScheduleStore {
+   public:
+    explicit ScheduleStore(const std::string& databasePath);
+
+    // Stores the schedules in one transaction and fills in their ids.
+    bool add(std::vector<Schedule>& schedules);
+    // Removes every schedule of the request.
+    bool remove(int requestId);
+    std::vector<Schedule> load();
+
+   private:
+    void createTable();
+
+    std::mutex mtx;
+    std::unique_ptr<SqliteConnection> db;
+};
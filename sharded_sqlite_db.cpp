@@ -0,0 +1,434 @@
+#include "sharded_sqlite_db.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+ShardedSqliteDb::ShardWorker::ShardWorker() : thread(&ShardWorker::run, this) {
+}
+
+ShardedSqliteDb::ShardWorker::~ShardWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        m_stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ShardedSqliteDb::ShardWorker::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+// Jobs posted before the stop still run, so nobody waits on them forever.
+void ShardedSqliteDb::ShardWorker::run() {
+    std::unique_lock lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return m_stop || !jobs.empty(); });
+        if (jobs.empty()) {
+            return;
+        }
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+ShardedSqliteDb::ShardedSqliteDb(const std::string& catalogPath, const ShardingConfig& config)
+    : catalog_path(catalogPath),
+      m_config(config),
+      catalog(std::make_unique<SqliteDb>(catalogPath, config.read_connections, config.compress_content)),
+      catalog_writer(std::make_unique<SqliteConnection>(catalogPath, false)) {
+    if (m_config.shards == 0 || m_config.partition.count() <= 0) {
+        throw std::invalid_argument("Sharding needs at least one shard and a positive partition length");
+    }
+    createTables();
+    loadPartitions();
+    for (size_t shard = 0; shard < m_config.shards; shard++) {
+        workers.push_back(std::make_unique<ShardWorker>());
+    }
+}
+
+void ShardedSqliteDb::createTables() {
+    const char* create_tables_sql = R"(
+        CREATE TABLE IF NOT EXISTS partitions (
+            id INTEGER PRIMARY KEY,
+            first_request_id INTEGER NOT NULL
+        );
+        CREATE TABLE IF NOT EXISTS sharding (
+            shards INTEGER NOT NULL,
+            partition_seconds INTEGER NOT NULL
+        );)";
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(catalog_writer->get(), create_tables_sql, nullptr, nullptr, &err_msg);
+    if (rc != SQLITE_OK) {
+        std::string error_msg = "SQL error: " + std::string(err_msg);
+        sqlite3_free(err_msg);
+        throw std::runtime_error(error_msg);
+    }
+
+    // Rows are routed by both, so a catalog is only ever opened with the
+    // layout it was created with.
+    auto select = catalog_writer->prepare("SELECT shards, partition_seconds FROM sharding;");
+    if (!select) {
+        throw std::runtime_error("SQL error: " + std::string(sqlite3_errmsg(catalog_writer->get())));
+    }
+    if (sqlite3_step(select.get()) == SQLITE_ROW) {
+        const auto shards = static_cast<size_t>(sqlite3_column_int64(select.get(), 0));
+        const auto seconds = sqlite3_column_int64(select.get(), 1);
+        if (shards != m_config.shards || seconds != m_config.partition.count()) {
+            throw std::runtime_error("Database " + catalog_path + " has " + std::to_string(shards) +
+                                     " shards with " + std::to_string(seconds) + "-second partitions");
+        }
+        return;
+    }
+    auto insert = catalog_writer->prepare("INSERT INTO sharding (shards, partition_seconds) VALUES (?, ?);");
+    if (!insert) {
+        throw std::runtime_error("SQL error: " + std::string(sqlite3_errmsg(catalog_writer->get())));
+    }
+    sqlite3_bind_int64(insert.get(), 1, static_cast<sqlite3_int64>(m_config.shards));
+    sqlite3_bind_int64(insert.get(), 2, m_config.partition.count());
+    if (sqlite3_step(insert.get()) != SQLITE_DONE) {
+        throw std::runtime_error("SQL error: " + std::string(sqlite3_errmsg(catalog_writer->get())));
+    }
+}
+
+void ShardedSqliteDb::loadPartitions() {
+    auto stmt = catalog_writer->prepare("SELECT id, first_request_id FROM partitions;");
+    if (!stmt) {
+        throw std::runtime_error("SQL error: " + std::string(sqlite3_errmsg(catalog_writer->get())));
+    }
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        partitions.emplace(sqlite3_column_int64(stmt.get(), 1),
+                           Partition{sqlite3_column_int64(stmt.get(), 0),
+                                     std::vector<std::shared_ptr<SqliteDb>>(m_config.shards)});
+    }
+}
+
+[[nodiscard]] size_t ShardedSqliteDb::getRequestId(const std::string& content) const {
+    std::vector<std::string> dropped;
+    size_t requestId = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        startPartitionLocked(Clock::now(), dropped);
+        requestId = catalog->getRequestId(content);
+    }
+    removeFiles(dropped);
+    return requestId;
+}
+
+bool ShardedSqliteDb::setRequestContent(const int requestId, const std::string& content, bool deflated) {
+    return catalog->setRequestContent(requestId, content, deflated);
+}
+
+bool ShardedSqliteDb::removeRequest(const int requestId) {
+    return catalog->removeRequest(requestId);
+}
+
+bool ShardedSqliteDb::startPartition(Clock::time_point now) {
+    std::vector<std::string> dropped;
+    bool started = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        started = startPartitionLocked(now, dropped);
+    }
+    removeFiles(dropped);
+    return started;
+}
+
+bool ShardedSqliteDb::startPartitionLocked(Clock::time_point now, std::vector<std::string>& dropped) const {
+    const int64_t number = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()) / m_config.partition;
+    if (!partitions.empty() && std::prev(partitions.end())->second.number >= number) {
+        return false;
+    }
+    // Requests get AUTOINCREMENT ids, so the next one is above every id
+    // ever given out, including those of dropped partitions.
+    long long firstRequestId = 0;
+    {
+        auto next = catalog_writer->prepare(
+            "SELECT COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'requests'), 0) + 1;");
+        if (!next || sqlite3_step(next.get()) != SQLITE_ROW) {
+            return false;
+        }
+        firstRequestId = sqlite3_column_int64(next.get(), 0);
+    }
+    if (!catalog_writer->exec("BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    // A partition no request was created in is replaced.
+    auto remove = catalog_writer->prepare("DELETE FROM partitions WHERE first_request_id = ?;");
+    auto insert = catalog_writer->prepare("INSERT INTO partitions (id, first_request_id) VALUES (?, ?);");
+    if (!remove || !insert) {
+        catalog_writer->exec("ROLLBACK;");
+        return false;
+    }
+    sqlite3_bind_int64(remove.get(), 1, firstRequestId);
+    sqlite3_bind_int64(insert.get(), 1, number);
+    sqlite3_bind_int64(insert.get(), 2, firstRequestId);
+    if (sqlite3_step(remove.get()) != SQLITE_DONE || sqlite3_step(insert.get()) != SQLITE_DONE ||
+        !catalog_writer->exec("COMMIT;")) {
+        catalog_writer->exec("ROLLBACK;");
+        return false;
+    }
+    if (auto empty = partitions.find(firstRequestId); empty != partitions.end()) {
+        addFiles(empty->second, dropped);
+        partitions.erase(empty);
+    }
+    partitions.emplace(firstRequestId, Partition{number, std::vector<std::shared_ptr<SqliteDb>>(m_config.shards)});
+    dropExpired(dropped);
+    return true;
+}
+
+// The requests of a dropped partition go with it, so their ids answer 404
+// like any unknown request once the drop listener has cleared them from
+// the caches in front of the database. Partitions are only dropped oldest first, as a
+// request is routed to the latest partition starting at or below its id.
+void ShardedSqliteDb::dropExpired(std::vector<std::string>& dropped) const {
+    while (m_config.retained_partitions > 0 && partitions.size() > m_config.retained_partitions) {
+        const auto oldest = partitions.begin();
+        const long long nextFirstId = std::next(oldest)->first;
+        // The scheduler would keep checking for a request that is gone.
+        if (hasSchedulesBefore(nextFirstId)) {
+            std::cerr << "Warning: partition " << oldest->second.number
+                      << " is kept beyond retention, its requests still have schedules" << std::endl;
+            return;
+        }
+        if (!catalog_writer->exec("BEGIN IMMEDIATE;")) {
+            return;
+        }
+        auto removePartition = catalog_writer->prepare("DELETE FROM partitions WHERE id = ?;");
+        auto removeRequests = catalog_writer->prepare("DELETE FROM requests WHERE id < ?;");
+        if (!removePartition || !removeRequests) {
+            catalog_writer->exec("ROLLBACK;");
+            return;
+        }
+        sqlite3_bind_int64(removePartition.get(), 1, oldest->second.number);
+        sqlite3_bind_int64(removeRequests.get(), 1, nextFirstId);
+        if (sqlite3_step(removePartition.get()) != SQLITE_DONE || sqlite3_step(removeRequests.get()) != SQLITE_DONE ||
+            !catalog_writer->exec("COMMIT;")) {
+            catalog_writer->exec("ROLLBACK;");
+            return;
+        }
+        addFiles(oldest->second, dropped);
+        partitions.erase(oldest);
+        if (drop_listener) {
+            drop_listener(static_cast<int>(nextFirstId));
+        }
+    }
+}
+
+void ShardedSqliteDb::onDrop(DropListener listener) {
+    std::lock_guard<std::mutex> lock(mtx);
+    drop_listener = std::move(listener);
+}
+
+// The schedules table is ScheduleStore's and lives in the catalog file;
+// without it nothing is scheduled.
+[[nodiscard]] bool ShardedSqliteDb::hasSchedulesBefore(long long requestId) const {
+    auto table = catalog_writer->prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'schedules';");
+    if (!table) {
+        return true;
+    }
+    const int rc = sqlite3_step(table.get());
+    if (rc == SQLITE_DONE) {
+        return false;
+    }
+    auto select = catalog_writer->prepare("SELECT 1 FROM schedules WHERE request_id < ? LIMIT 1;");
+    if (rc != SQLITE_ROW || !select) {
+        return true;
+    }
+    sqlite3_bind_int64(select.get(), 1, requestId);
+    return sqlite3_step(select.get()) != SQLITE_DONE;
+}
+
+void ShardedSqliteDb::onShards(const std::vector<size_t>& shards, const std::function<void(size_t)>& work) {
+    std::mutex doneMtx;
+    std::condition_variable doneCv;
+    size_t left = shards.size();
+    for (size_t i = 0; i < shards.size(); i++) {
+        workers[shards[i]]->post([&, i] {
+            try {
+                work(i);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: shard " << shards[i] << ": " << e.what() << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(doneMtx);
+            if (--left == 0) {
+                doneCv.notify_one();
+            }
+        });
+    }
+    std::unique_lock lock(doneMtx);
+    doneCv.wait(lock, [&] { return left == 0; });
+}
+
+size_t ShardedSqliteDb::partitionCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return partitions.size();
+}
+
+std::string ShardedSqliteDb::shardPath(int64_t partition, size_t shard) const {
+    return catalog_path + ".p" + std::to_string(partition) + ".s" + std::to_string(shard);
+}
+
+std::shared_ptr<SqliteDb> ShardedSqliteDb::shardOf(int requestId, bool create) {
+    auto it = partitions.upper_bound(requestId);
+    if (it == partitions.begin()) {
+        return nullptr;
+    }
+    --it;
+    return openShard(it->second, static_cast<size_t>(requestId) % m_config.shards, create);
+}
+
+std::shared_ptr<SqliteDb> ShardedSqliteDb::openShard(Partition& partition, size_t shard, bool create) {
+    auto& db = partition.shards[shard];
+    if (!db) {
+        const std::string path = shardPath(partition.number, shard);
+        // Reads of a shard nothing was written to yet leave no file behind.
+        if (!create && !std::filesystem::exists(path)) {
+            return nullptr;
+        }
+        db = std::make_shared<SqliteDb>(path, m_config.read_connections);
+    }
+    return db;
+}
+
+void ShardedSqliteDb::addFiles(const Partition& partition, std::vector<std::string>& paths) const {
+    for (size_t shard = 0; shard < m_config.shards; shard++) {
+        paths.push_back(shardPath(partition.number, shard));
+    }
+}
+
+// A reader still holding a dropped shard keeps reading the unlinked file
+// until it lets go of it.
+void ShardedSqliteDb::removeFiles(const std::vector<std::string>& paths) {
+    std::error_code ec;
+    for (const auto& path : paths) {
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path + suffix, ec);
+        }
+    }
+}
+
+bool ShardedSqliteDb::insert(const Url& url) {
+    std::shared_ptr<SqliteDb> db;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        db = shardOf(url.request_id, true);
+    }
+    // Results of a request whose partition is dropped are dropped too.
+    return db ? db->insert(url) : true;
+}
+
+bool ShardedSqliteDb::insert(const std::vector<Url>& urls) {
+    struct Group {
+        std::shared_ptr<SqliteDb> db;
+        size_t shard;
+        std::vector<Url> rows;
+    };
+    std::vector<Group> groups;
+    {
+        std::unordered_map<SqliteDb*, size_t> index;
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& url : urls) {
+            auto db = shardOf(url.request_id, true);
+            if (!db) {
+                continue;
+            }
+            auto [it, added] = index.try_emplace(db.get(), groups.size());
+            if (added) {
+                groups.push_back(Group{std::move(db), static_cast<size_t>(url.request_id) % m_config.shards, {}});
+            }
+            groups[it->second].rows.push_back(url);
+        }
+    }
+    std::vector<size_t> shards;
+    for (const auto& group : groups) {
+        shards.push_back(group.shard);
+    }
+    std::vector<char> inserted(groups.size(), 0);
+    onShards(shards, [&](size_t i) { inserted[i] = groups[i].db->insert(groups[i].rows) ? 1 : 0; });
+    return std::all_of(inserted.begin(), inserted.end(), [](char ok) { return ok != 0; });
+}
+
+std::vector<Url> ShardedSqliteDb::find(const int requestId) {
+    std::shared_ptr<SqliteDb> db;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        db = shardOf(requestId, false);
+    }
+    return db ? db->find(requestId) : std::vector<Url>{};
+}
+
+std::vector<Url> ShardedSqliteDb::find(const int requestId, long long afterId, size_t limit,
+                                      const ResultFilter& filter) {
+    std::shared_ptr<SqliteDb> db;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        db = shardOf(requestId, false);
+    }
+    return db ? db->find(requestId, afterId, limit, filter) : std::vector<Url>{};
+}
+
+bool ShardedSqliteDb::requestIdExists(const int requestId) {
+    return catalog->requestIdExists(requestId);
+}
+
+int ShardedSqliteDb::lastRequestId() {
+    return catalog->lastRequestId();
+}
+
+std::optional<std::string> ShardedSqliteDb::requestContent(const int requestId) {
+    return catalog->requestContent(requestId);
+}
+
+// Results of a request land in its partition however late they come (a
+// schedule keeps adding to one request), so no partition can be skipped by
+// its time. The worker of each shard goes through its files in every
+// partition.
+std::optional<ResultTotals> ShardedSqliteDb::totals(long long sinceMillis) {
+    std::vector<std::vector<std::shared_ptr<SqliteDb>>> files(m_config.shards);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& [firstId, partition] : partitions) {
+            for (size_t shard = 0; shard < m_config.shards; shard++) {
+                if (auto db = openShard(partition, shard, false)) {
+                    files[shard].push_back(std::move(db));
+                }
+            }
+        }
+    }
+    std::vector<size_t> shards(files.size());
+    for (size_t shard = 0; shard < shards.size(); shard++) {
+        shards[shard] = shard;
+    }
+    std::vector<std::optional<ResultTotals>> parts(files.size(), ResultTotals{});
+    onShards(shards, [&](size_t shard) {
+        for (const auto& db : files[shard]) {
+            auto part = db->totals(sinceMillis);
+            if (!part) {
+                parts[shard] = std::nullopt;
+                return;
+            }
+            *parts[shard] += *part;
+        }
+    });
+    ResultTotals totals;
+    for (const auto& part : parts) {
+        if (!part) {
+            return std::nullopt;
+        }
+        totals += *part;
+    }
+    return totals;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "database_interface.h"
+#include "sqlite_connection.h"
+#include "sqlite_db.h"
+#include "url.h"
+
+struct ShardingConfig {
+    // Database files each partition is spread over, by request id.
+    size_t shards = 4;
+    // Requests created within one partition length share a partition.
+    std::chrono::seconds partition = std::chrono::hours(24);
+    // Partitions kept; creating one more drops the oldest (0 - keep all).
+    size_t retained_partitions = 0;
+    // Read-only connections of every shard file.
+    size_t read_connections = 1;
+    bool compress_content = false;
+};
+
+// Results spread over several SQLite files, each with its own writer, so
+// inserts into different shards commit in parallel instead of queueing on
+// one write lock. The catalog file at the given path keeps the requests and
+// the partitions: requests created in the same partition length (a day by
+// default) store their results in the files of that partition, and the
+// request id picks the shard file within it. Retention drops whole
+// partitions by deleting their files rather than running DELETEs over the
+// results.
+class ShardedSqliteDb : public DatabaseInterface {
+   public:
+    using Clock = std::chrono::system_clock;
+    // Called with the first request id kept whenever partitions are
+    // dropped; every request below it is gone.
+    using DropListener = std::function<void(int)>;
+
+    // Throws if the catalog was created with another shard count or
+    // partition length.
+    explicit ShardedSqliteDb(const std::string& catalogPath, const ShardingConfig& config = {});
+    ~ShardedSqliteDb() override = default;
+
+    [[nodiscard]] size_t getRequestId(const std::string& content) const override;
+    bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) override;
+    bool removeRequest(const int requestId) override;
+    bool insert(const Url& url) override;
+    // Rows of different shards are written in parallel.
+    bool insert(const std::vector<Url>& urls) override;
+    std::vector<Url> find(const int requestId) override;
+    std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                          const ResultFilter& filter = {}) override;
+    bool requestIdExists(const int requestId) override;
+    int lastRequestId() override;
+    std::optional<std::string> requestContent(const int requestId);
+
+    // Totals over every shard of every partition, queried in parallel.
+    std::optional<ResultTotals> totals(long long sinceMillis = 0) override;
+
+    // Starts the partition of now for the requests created from here on,
+    // unless it is already the latest, and drops the partitions beyond
+    // retention; true if a partition was started. getRequestId calls it.
+    // A partition holding a request that still has schedules is kept, and
+    // so is every newer one, until the schedules are removed.
+    bool startPartition(Clock::time_point now = Clock::now());
+    // Lets caches of the requests forget the dropped ones. The listener
+    // runs with the database locked and must not call back into it.
+    void onDrop(DropListener listener);
+    [[nodiscard]] size_t partitionCount() const;
+    // File of one shard of a partition.
+    [[nodiscard]] std::string shardPath(int64_t partition, size_t shard) const;
+
+   private:
+    // Long-lived thread of one shard, running the work on that shard's
+    // files of every partition in the order it was handed over.
+    class ShardWorker {
+       public:
+        ShardWorker();
+        ~ShardWorker();
+        void post(std::function<void()> job);
+
+       private:
+        void run();
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs;
+        bool m_stop = false;
+        std::thread thread;
+    };
+
+    struct Partition {
+        int64_t number;
+        // Shard files, opened on first use.
+        std::vector<std::shared_ptr<SqliteDb>> shards;
+    };
+
+    void createTables();
+    void loadPartitions();
+    // The paths of dropped partitions are added to dropped, to be removed
+    // without the lock; mtx must be held.
+    bool startPartitionLocked(Clock::time_point now, std::vector<std::string>& dropped) const;
+    void dropExpired(std::vector<std::string>& dropped) const;
+    [[nodiscard]] bool hasSchedulesBefore(long long requestId) const;
+    // Runs work(i) for every i below shards.size() on the worker of shard
+    // shards[i] and waits for all of them.
+    void onShards(const std::vector<size_t>& shards, const std::function<void(size_t)>& work);
+    // Shard file of the request; null once its partition is dropped, or
+    // without create if the file does not exist yet. mtx must be held.
+    std::shared_ptr<SqliteDb> shardOf(int requestId, bool create);
+    std::shared_ptr<SqliteDb> openShard(Partition& partition, size_t shard, bool create);
+    void addFiles(const Partition& partition, std::vector<std::string>& paths) const;
+    static void removeFiles(const std::vector<std::string>& paths);
+
+    std::string catalog_path;
+    ShardingConfig m_config;
+    std::unique_ptr<SqliteDb> catalog;
+    // Second connection to the catalog for the tables SqliteDb does not own.
+    std::unique_ptr<SqliteConnection> catalog_writer;
+    mutable std::mutex mtx;
+    // By the id of their first request; getRequestId, const in the
+    // interface, starts new ones.
+    mutable std::map<long long, Partition> partitions;
+    DropListener drop_listener;
+    // Last, so they are stopped before the files they write go away.
+    std::vector<std::unique_ptr<ShardWorker>> workers;
+};
@@ -0,0 +1,41 @@
+#include "sqlite_connection.h"
+#include <stdexcept>
+
+SqliteConnection::Statement::~Statement() {
+    if (stmt != nullptr) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+SqliteConnection::SqliteConnection(const std::string& databasePath, bool readOnly)
+    : db(nullptr, &sqlite3_close) {
+    const int flags = SQLITE_OPEN_NOMUTEX |
+                      (readOnly ? SQLITE_OPEN_READONLY
+                                : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    sqlite3* temp_db = nullptr;
+    int rc = sqlite3_open_v2(databasePath.c_str(), &temp_db, flags, nullptr);
+    if (rc != SQLITE_OK) {
+        std::string errorMsg = "Can't open database: " + std::string(sqlite3_errmsg(temp_db));
+        sqlite3_close(temp_db);
+        throw std::runtime_error(errorMsg);
+    }
+    db.reset(temp_db);
+    sqlite3_busy_timeout(db.get(), 5000);
+}
+
+SqliteConnection::Statement SqliteConnection::prepare(std::string_view sql) {
+    auto it = statements.find(sql);
+    if (it == statements.end()) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db.get(), sql.data(), static_cast<int>(sql.size()), &stmt, nullptr) != SQLITE_OK) {
+            return Statement(nullptr);
+        }
+        it = statements.emplace(std::string(sql), std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>(stmt, &sqlite3_finalize)).first;
+    }
+    return Statement(it->second.get());
+}
+
+bool SqliteConnection::exec(const char* sql) {
+    return sqlite3_exec(db.get(), sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// One SQLite connection with its own prepared-statement cache. A connection
+// is used by one thread at a time, so it is opened without SQLite's mutex.
+class SqliteConnection {
+   public:
+    // Resets the statement when it goes out of scope, so a SELECT never keeps
+    // its read transaction open between calls.
+    class Statement {
+       public:
+        explicit Statement(sqlite3_stmt* stmt) : stmt(stmt) {}
+        ~Statement();
+        Statement(const Statement&) = delete;
+        Statement& operator=(const Statement&) = delete;
+
+        [[nodiscard]] sqlite3_stmt* get() const { return stmt; }
+        explicit operator bool() const { return stmt != nullptr; }
+
+       private:
+        sqlite3_stmt* stmt;
+    };
+
+    SqliteConnection(const std::string& databasePath, bool readOnly);
+
+    // Returns the statement for the query, preparing it on first use only.
+    Statement prepare(std::string_view sql);
+    bool exec(const char* sql);
+    [[nodiscard]] sqlite3* get() const { return db.get(); }
+
+   private:
+    // Transparent hashing lets lookups by string_view skip building a string.
+    struct QueryHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view sql) const { return std::hash<std::string_view>{}(sql); }
+    };
+
+    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> db;
+    std::unordered_map<std::string, std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>,
+                       QueryHash, std::equal_to<>>
+        statements;
+};
@@ -1,133 +1,583 @@
 #include "sqlite_db.h"
+#include <array>
+#include <chrono>
+#include <set>
+#include "compression.h"
+#include "metrics.h"
+#include "timestamps.h"
 
-SqliteDb::SqliteDb(const std::string& databasePath)
-    : db(nullptr, &sqlite3_close), db_path(databasePath) {
-    initDb();
-    createTable();
+namespace {
+
+// Schema versions, kept in PRAGMA user_version:
+// 0 - urls keep their URL inline, with no index and text timestamps;
+// 1 - urls are indexed by request and point at interned targets, timestamps
+//     are epoch milliseconds and request bodies may be compressed.
+constexpr int kSchemaVersion = 1;
+
+// Bodies shorter than this are stored as they are.
+constexpr size_t kCompressMinSize = 128;
+
+// requests.encoding
+constexpr int kEncodingRaw = 0;
+constexpr int kEncodingDeflate = 1;
+
+constexpr const char* kSchemaV1 = R"(
+    CREATE TABLE requests (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        content BLOB NOT NULL,
+        encoding INTEGER NOT NULL DEFAULT 0,
+        created_at INTEGER NOT NULL
+    );
+    CREATE TABLE targets (
+        id INTEGER PRIMARY KEY,
+        url TEXT NOT NULL UNIQUE
+    );
+    CREATE TABLE urls (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        request_id INTEGER NOT NULL,
+        target_id INTEGER NOT NULL,
+        http_status INTEGER NOT NULL,
+        response_time INTEGER NOT NULL,
+        created_at INTEGER NOT NULL,
+        namelookup_us INTEGER NOT NULL DEFAULT 0,
+        connect_us INTEGER NOT NULL DEFAULT 0,
+        appconnect_us INTEGER NOT NULL DEFAULT 0,
+        pretransfer_us INTEGER NOT NULL DEFAULT 0,
+        starttransfer_us INTEGER NOT NULL DEFAULT 0,
+        total_us INTEGER NOT NULL DEFAULT 0,
+        FOREIGN KEY (request_id) REFERENCES requests (id),
+        FOREIGN KEY (target_id) REFERENCES targets (id)
+    );
+    CREATE INDEX urls_request_id ON urls (request_id);
+)";
+
+// Deflated body when compression is on and makes it smaller; empty when it
+// is stored as it is.
+std::string deflatedContent(const std::string& content, bool compressContent) {
+    if (!compressContent || content.size() < kCompressMinSize) {
+        return {};
+    }
+    std::string compressed = compress(content);
+    return compressed.size() < content.size() ? compressed : std::string();
+}
+
+// SQL converting a version 0 local 'YYYY-MM-DD HH:MM:SS' column to epoch
+// milliseconds.
+std::string localTextToMillis(const std::string& column) {
+    return "COALESCE(CAST(ROUND((julianday(" + column + ", 'utc') - 2440587.5) * 86400000) AS INTEGER), 0)";
+}
+
+// Phase columns in kPhases order, e.g. "u.namelookup_us, u.connect_us, ...".
+std::string phaseColumns(const std::string& prefix) {
+    std::string columns;
+    for (const auto& [name, phase] : kPhases) {
+        columns += columns.empty() ? "" : ", ";
+        columns += prefix + std::string(name);
+    }
+    return columns;
+}
+
+// Page query that also bounds every phase: the min and max of phase i are
+// parameters 4 + 2 * i and 5 + 2 * i, and NULL leaves a bound open.
+std::string filteredPageSql() {
+    std::string sql = "SELECT u.request_id, t.url, u.http_status, u.response_time, u.created_at, u.id, " +
+                      phaseColumns("u.") +
+                      " FROM urls u JOIN targets t ON t.id = u.target_id WHERE u.request_id = ?1 AND u.id > ?2";
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        const std::string column = "u." + std::string(kPhases[i].first);
+        const std::string min = "?" + std::to_string(4 + 2 * i);
+        const std::string max = "?" + std::to_string(5 + 2 * i);
+        sql += " AND (" + min + " IS NULL OR " + column + " >= " + min + ")";
+        sql += " AND (" + max + " IS NULL OR " + column + " <= " + max + ")";
+    }
+    return sql + " ORDER BY u.id LIMIT ?3;";
+}
+
+}  // namespace
+
+SqliteDb::SqliteDb(const std::string& databasePath, size_t readConnections, bool compressContent)
+    : db_path(databasePath),
+      compress_content(compressContent),
+      writer(std::make_unique<SqliteConnection>(databasePath, false)) {
+    // WAL lets readers run alongside the writer and, with synchronous=NORMAL,
+    // only syncs on checkpoints instead of on every commit.
+    writer->exec("PRAGMA journal_mode=WAL;");
+    writer->exec("PRAGMA synchronous=NORMAL;");
+    migrate();
+    for (size_t i = 0; i < readConnections; i++) {
+        readers.push_back(std::make_unique<SqliteConnection>(databasePath, true));
+        idle_readers.push_back(readers.back().get());
+    }
 }
 
 [[nodiscard]] size_t SqliteDb::getRequestId(const std::string& content) const {
     const char* insert_sql = R"(
-        INSERT INTO requests (content)
-        VALUES (?);
+        INSERT INTO requests (content, encoding, created_at)
+        VALUES (?, ?, ?);
     )";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db.get(), insert_sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    const std::string compressed = deflatedContent(content, compress_content);
+    const bool deflated = !compressed.empty();
+    const std::string& stored = deflated ? compressed : content;
+
+    std::lock_guard<std::mutex> lock(writer_mtx);
+    auto stmt = writer->prepare(insert_sql);
+    if (!stmt) {
+        return 0;
+    }
+    sqlite3_bind_blob(stmt.get(), 1, stored.data(), static_cast<int>(stored.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt.get(), 2, deflated ? kEncodingDeflate : kEncodingRaw);
+    sqlite3_bind_int64(stmt.get(), 3, nowMillis());
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
         return 0;
     }
-    sqlite3_bind_text(stmt, 1, content.c_str(), -1, SQLITE_STATIC);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return sqlite3_last_insert_rowid(db.get());
+    return sqlite3_last_insert_rowid(writer->get());
+}
+
+bool SqliteDb::setRequestContent(const int requestId, const std::string& content, bool deflated) {
+    const char* update_sql = R"(
+        UPDATE requests SET content = ?, encoding = ? WHERE id = ?;
+    )";
+    const std::string compressed = deflated ? std::string() : deflatedContent(content, compress_content);
+    deflated = deflated || !compressed.empty();
+    const std::string& stored = compressed.empty() ? content : compressed;
+
+    std::lock_guard<std::mutex> lock(writer_mtx);
+    auto stmt = writer->prepare(update_sql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_blob(stmt.get(), 1, stored.data(), static_cast<int>(stored.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt.get(), 2, deflated ? kEncodingDeflate : kEncodingRaw);
+    sqlite3_bind_int(stmt.get(), 3, requestId);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE && sqlite3_changes(writer->get()) > 0;
+}
+
+bool SqliteDb::removeRequest(const int requestId) {
+    const char* delete_sql = R"(
+        DELETE FROM requests WHERE id = ?;
+    )";
+    std::lock_guard<std::mutex> lock(writer_mtx);
+    auto stmt = writer->prepare(delete_sql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE && sqlite3_changes(writer->get()) > 0;
+}
+
+std::optional<std::string> SqliteDb::requestContent(const int requestId) {
+    const char* select_sql = R"(
+        SELECT content, encoding FROM requests WHERE id = ?;
+    )";
+
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
+        return std::nullopt;
+    }
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return std::nullopt;
+    }
+    std::string_view content(static_cast<const char*>(sqlite3_column_blob(stmt.get(), 0)),
+                             static_cast<size_t>(sqlite3_column_bytes(stmt.get(), 0)));
+    if (sqlite3_column_int(stmt.get(), 1) == kEncodingDeflate) {
+        return decompress(content);
+    }
+    return std::string(content);
+}
+
+std::optional<ResultTotals> SqliteDb::totals(long long sinceMillis) {
+    const char* select_sql = R"(
+        SELECT COUNT(*), COALESCE(SUM(http_status BETWEEN 200 AND 399), 0), COALESCE(SUM(response_time), 0)
+        FROM urls
+        WHERE created_at >= ?;
+    )";
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
+        return std::nullopt;
+    }
+    sqlite3_bind_int64(stmt.get(), 1, sinceMillis);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return std::nullopt;
+    }
+    ResultTotals totals;
+    totals.results = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+    totals.successes = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 1));
+    totals.response_time_ms = static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 2));
+    return totals;
 }
 
 bool SqliteDb::insert(const Url& url) {
+    const auto started = std::chrono::steady_clock::now();
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(writer_mtx);
+        inserted = insertRows(std::span<const Url>(&url, 1));
+    }
+    metrics().db_insert_duration.observe(std::chrono::steady_clock::now() - started);
+    if (inserted) {
+        metrics().db_rows.add();
+    }
+    return inserted;
+}
+
+bool SqliteDb::insert(const std::vector<Url>& urls) {
+    const auto started = std::chrono::steady_clock::now();
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(writer_mtx);
+        inserted = insertRows(urls);
+    }
+    metrics().db_insert_duration.observe(std::chrono::steady_clock::now() - started);
+    if (inserted) {
+        metrics().db_rows.add(urls.size());
+    }
+    return inserted;
+}
+
+// A row and the target it interns commit together, so even a single row
+// goes through a transaction. It takes the write lock up front: a deferred
+// one would start as a reader at the first lookup of a target and fail,
+// without waiting, to upgrade once another connection to the file has
+// committed.
+bool SqliteDb::insertRows(std::span<const Url> urls) {
+    if (!writer->exec("BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    const long long now = nowMillis();
+    for (const auto& url : urls) {
+        if (!insertRow(url, now)) {
+            rollbackRows();
+            return false;
+        }
+    }
+    if (!writer->exec("COMMIT;")) {
+        rollbackRows();
+        return false;
+    }
+    return true;
+}
+
+void SqliteDb::rollbackRows() {
+    writer->exec("ROLLBACK;");
+    // Targets interned by the transaction are gone with it.
+    target_ids.clear();
+}
+
+bool SqliteDb::insertRow(const Url& url, long long createdAt) {
     const char* insert_sql = R"(
-        INSERT INTO urls (request_id, url, http_status, response_time)
-        VALUES (?, ?, ?, ?);
+        INSERT INTO urls (request_id, target_id, http_status, response_time, created_at,
+                          namelookup_us, connect_us, appconnect_us,
+                          pretransfer_us, starttransfer_us, total_us)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);
     )";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db.get(), insert_sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    const long long targetId = internTarget(url.url);
+    if (targetId == 0) {
         return false;
     }
-    sqlite3_bind_int(stmt, 1, url.request_id);
-    sqlite3_bind_text(stmt, 2, url.url.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, url.http_status);
-    sqlite3_bind_int(stmt, 4, url.response_time);
+    auto stmt = writer->prepare(insert_sql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt.get(), 1, url.request_id);
+    sqlite3_bind_int64(stmt.get(), 2, targetId);
+    sqlite3_bind_int(stmt.get(), 3, url.http_status);
+    sqlite3_bind_int(stmt.get(), 4, url.response_time);
+    sqlite3_bind_int64(stmt.get(), 5, createdAt);
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        sqlite3_bind_int64(stmt.get(), static_cast<int>(6 + i), url.timings.*kPhases[i].second);
+    }
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    return sqlite3_step(stmt.get()) == SQLITE_DONE;
+}
 
-    return rc == SQLITE_DONE;
+long long SqliteDb::internTarget(const std::string& url) {
+    if (auto it = target_ids.find(url); it != target_ids.end()) {
+        return it->second;
+    }
+    long long targetId = 0;
+    {
+        auto select = writer->prepare("SELECT id FROM targets WHERE url = ?;");
+        if (!select) {
+            return 0;
+        }
+        sqlite3_bind_text(select.get(), 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+        if (sqlite3_step(select.get()) == SQLITE_ROW) {
+            targetId = sqlite3_column_int64(select.get(), 0);
+        }
+    }
+    if (targetId == 0) {
+        auto insert = writer->prepare("INSERT INTO targets (url) VALUES (?);");
+        if (!insert) {
+            return 0;
+        }
+        sqlite3_bind_text(insert.get(), 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+        if (sqlite3_step(insert.get()) != SQLITE_DONE) {
+            return 0;
+        }
+        targetId = sqlite3_last_insert_rowid(writer->get());
+    }
+    if (target_ids.size() >= kTargetCacheSize) {
+        target_ids.clear();
+    }
+    target_ids.emplace(url, targetId);
+    return targetId;
 }
 
 std::vector<Url> SqliteDb::find(const int requestId) {
     std::vector<Url> urls;
     const char* select_sql = R"(
-        SELECT request_id, url, http_status, response_time, created_at
-        FROM urls
-        WHERE request_id = ?;
+        SELECT u.request_id, t.url, u.http_status, u.response_time, u.created_at, u.id,
+               u.namelookup_us, u.connect_us, u.appconnect_us,
+               u.pretransfer_us, u.starttransfer_us, u.total_us
+        FROM urls u JOIN targets t ON t.id = u.target_id
+        WHERE u.request_id = ?
+        ORDER BY u.id;
     )";
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db.get(), select_sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
+        return urls;
+    }
+
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        urls.push_back(readRow(stmt.get()));
+    }
+
+    return urls;
+}
+
+std::vector<Url> SqliteDb::find(const int requestId, long long afterId, size_t limit,
+                               const ResultFilter& filter) {
+    if (!filter.empty()) {
+        return findFiltered(requestId, afterId, limit, filter);
+    }
+    std::vector<Url> urls;
+    const char* select_sql = R"(
+        SELECT u.request_id, t.url, u.http_status, u.response_time, u.created_at, u.id,
+               u.namelookup_us, u.connect_us, u.appconnect_us,
+               u.pretransfer_us, u.starttransfer_us, u.total_us
+        FROM urls u JOIN targets t ON t.id = u.target_id
+        WHERE u.request_id = ? AND u.id > ?
+        ORDER BY u.id
+        LIMIT ?;
+    )";
+
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
+        return urls;
+    }
+
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+    sqlite3_bind_int64(stmt.get(), 2, afterId);
+    sqlite3_bind_int64(stmt.get(), 3, static_cast<sqlite3_int64>(limit));
+
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        urls.push_back(readRow(stmt.get()));
+    }
+
+    return urls;
+}
+
+std::vector<Url> SqliteDb::findFiltered(const int requestId, long long afterId, size_t limit,
+                                       const ResultFilter& filter) {
+    static const std::string select_sql = filteredPageSql();
+    std::vector<Url> urls;
+
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
         return urls;
     }
 
-    sqlite3_bind_int(stmt, 1, requestId);
+    sqlite3_bind_int(stmt.get(), 1, requestId);
+    sqlite3_bind_int64(stmt.get(), 2, afterId);
+    sqlite3_bind_int64(stmt.get(), 3, static_cast<sqlite3_int64>(limit));
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        if (filter.min_us[i]) {
+            sqlite3_bind_int64(stmt.get(), static_cast<int>(4 + 2 * i), *filter.min_us[i]);
+        } else {
+            sqlite3_bind_null(stmt.get(), static_cast<int>(4 + 2 * i));
+        }
+        if (filter.max_us[i]) {
+            sqlite3_bind_int64(stmt.get(), static_cast<int>(5 + 2 * i), *filter.max_us[i]);
+        } else {
+            sqlite3_bind_null(stmt.get(), static_cast<int>(5 + 2 * i));
+        }
+    }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Url url;
-        url.request_id = sqlite3_column_int(stmt, 0);
-        url.url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        url.http_status = sqlite3_column_int(stmt, 2);
-        url.response_time = sqlite3_column_int(stmt, 3);
-        url.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        urls.push_back(url);
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        urls.push_back(readRow(stmt.get()));
     }
 
-    sqlite3_finalize(stmt);
     return urls;
 }
 
+Url SqliteDb::readRow(sqlite3_stmt* stmt) {
+    Url url;
+    url.request_id = sqlite3_column_int(stmt, 0);
+    url.url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    url.http_status = sqlite3_column_int(stmt, 2);
+    url.response_time = sqlite3_column_int(stmt, 3);
+    url.created_at = formatMillis(sqlite3_column_int64(stmt, 4));
+    url.id = sqlite3_column_int64(stmt, 5);
+    for (size_t i = 0; i < kPhases.size(); i++) {
+        url.timings.*kPhases[i].second = sqlite3_column_int64(stmt, static_cast<int>(6 + i));
+    }
+    return url;
+}
+
 bool SqliteDb::requestIdExists(const int requestId) {
     const char* select_sql = R"(
         SELECT COUNT(*) FROM requests WHERE id = ?;
     )";
 
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db.get(), select_sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto reader = acquireReader();
+    auto stmt = reader->prepare(select_sql);
+    if (!stmt) {
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, requestId);
+    sqlite3_bind_int(stmt.get(), 1, requestId);
 
     bool isExists = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        isExists = sqlite3_column_int(stmt, 0) > 0;
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        isExists = sqlite3_column_int(stmt.get(), 0) > 0;
     }
 
-    sqlite3_finalize(stmt);
     return isExists;
 }
 
-void SqliteDb::initDb() {
-    sqlite3* temp_db = nullptr;
-    int rc = sqlite3_open(db_path.c_str(), &temp_db);
-    if (rc != SQLITE_OK) {
-        std::string errorMsg = "Can't open database: " + std::string(sqlite3_errmsg(temp_db));
-        sqlite3_close(temp_db);
-        throw std::runtime_error(errorMsg);
-    }
-    db.reset(temp_db);
-}
-
-void SqliteDb::createTable() {
-    const char* create_table_sql = R"(
-        CREATE TABLE IF NOT EXISTS requests (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            content TEXT NOT NULL,
-            created_at DATETIME DEFAULT (datetime('now','localtime'))
-        );
-        CREATE TABLE IF NOT EXISTS urls (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            request_id INTEGER NOT NULL,
-            url TEXT NOT NULL,
-            http_status INTEGER NOT NULL,
-            response_time INTEGER NOT NULL,
-            created_at DATETIME DEFAULT (datetime('now','localtime')),
-            FOREIGN KEY (request_id) REFERENCES requests (id)
-        );)";
+int SqliteDb::lastRequestId() {
+    auto reader = acquireReader();
+    auto stmt = reader->prepare("SELECT COALESCE(MAX(id), 0) FROM requests;");
+    if (!stmt || sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return 0;
+    }
+    return sqlite3_column_int(stmt.get(), 0);
+}
+
+SqliteDb::Reader SqliteDb::acquireReader() {
+    if (readers.empty()) {
+        writer_mtx.lock();
+        return Reader(writer.get(), [this](SqliteConnection*) {
+            writer_mtx.unlock();
+        });
+    }
+    std::unique_lock lock(readers_mtx);
+    readers_cv.wait(lock, [this] { return !idle_readers.empty(); });
+    SqliteConnection* reader = idle_readers.back();
+    idle_readers.pop_back();
+    return Reader(reader, [this](SqliteConnection* reader) {
+        {
+            std::lock_guard<std::mutex> lock(readers_mtx);
+            idle_readers.push_back(reader);
+        }
+        readers_cv.notify_one();
+    });
+}
+
+int SqliteDb::schemaVersion() {
+    auto stmt = writer->prepare("PRAGMA user_version;");
+    if (!stmt || sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        throw std::runtime_error("SQL error: cannot read the schema version");
+    }
+    return sqlite3_column_int(stmt.get(), 0);
+}
+
+void SqliteDb::execOrThrow(const std::string& sql) {
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db.get(), create_table_sql, nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(writer->get(), sql.c_str(), nullptr, nullptr, &err_msg);
 
     if (rc != SQLITE_OK) {
-        std::string error_msg = "SQL error: " + std::string(err_msg);
+        std::string error_msg = "SQL error: " + std::string(err_msg ? err_msg : sqlite3_errmsg(writer->get()));
         sqlite3_free(err_msg);
         throw std::runtime_error(error_msg);
     }
 }
+
+// Brings the schema up to kSchemaVersion one version at a time, each step in
+// its own transaction, so an interrupted upgrade resumes where it stopped.
+void SqliteDb::migrate() {
+    static constexpr std::array<void (SqliteDb::*)(), kSchemaVersion> migrations{
+        &SqliteDb::migrateToV1,
+    };
+    const int version = schemaVersion();
+    if (version > kSchemaVersion) {
+        throw std::runtime_error("Database schema version " + std::to_string(version) +
+                                 " is newer than the supported " + std::to_string(kSchemaVersion));
+    }
+    for (int next = version + 1; next <= kSchemaVersion; next++) {
+        execOrThrow("BEGIN IMMEDIATE;");
+        try {
+            (this->*migrations[next - 1])();
+            execOrThrow("PRAGMA user_version = " + std::to_string(next) + ";");
+            execOrThrow("COMMIT;");
+        } catch (...) {
+            writer->exec("ROLLBACK;");
+            throw;
+        }
+    }
+}
+
+bool SqliteDb::tableExists(const std::string& table) {
+    auto stmt = writer->prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;");
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_text(stmt.get(), 1, table.c_str(), -1, SQLITE_STATIC);
+    return sqlite3_step(stmt.get()) == SQLITE_ROW;
+}
+
+// Version 0 tables are renamed and copied into the new layout; rows keep
+// their ids, so stored request ids and pagination cursors stay valid.
+void SqliteDb::migrateToV1() {
+    if (!tableExists("urls")) {
+        execOrThrow(kSchemaV1);
+        return;
+    }
+    addPhaseColumns();
+    execOrThrow(R"(
+        DROP TABLE IF EXISTS requests_v0;
+        DROP TABLE IF EXISTS urls_v0;
+        ALTER TABLE requests RENAME TO requests_v0;
+        ALTER TABLE urls RENAME TO urls_v0;
+    )");
+    execOrThrow(kSchemaV1);
+    execOrThrow("INSERT INTO requests (id, content, encoding, created_at) "
+                "SELECT id, CAST(content AS BLOB), 0, " + localTextToMillis("created_at") + " FROM requests_v0;");
+    execOrThrow("INSERT INTO targets (url) SELECT url FROM urls_v0 GROUP BY url ORDER BY MIN(id);");
+    execOrThrow("INSERT INTO urls (id, request_id, target_id, http_status, response_time, created_at, " +
+                phaseColumns("") + ") "
+                "SELECT u.id, u.request_id, t.id, u.http_status, u.response_time, " +
+                localTextToMillis("u.created_at") + ", " + phaseColumns("u.") +
+                " FROM urls_v0 u JOIN targets t ON t.url = u.url ORDER BY u.id;");
+    execOrThrow(R"(
+        DROP TABLE urls_v0;
+        DROP TABLE requests_v0;
+    )");
+}
+
+// Version 0 databases created before the phase timings were recorded get
+// their columns added before they are copied; their old rows read as zero
+// timings.
+void SqliteDb::addPhaseColumns() {
+    std::set<std::string> columns;
+    {
+        auto stmt = writer->prepare("PRAGMA table_info(urls);");
+        while (stmt && sqlite3_step(stmt.get()) == SQLITE_ROW) {
+            columns.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1)));
+        }
+    }
+    for (const auto& [name, phase] : kPhases) {
+        if (columns.count(std::string(name)) == 0) {
+            execOrThrow("ALTER TABLE urls ADD COLUMN " + std::string(name) + " INTEGER NOT NULL DEFAULT 0;");
+        }
+    }
+}
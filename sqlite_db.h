@@ -1,31 +1,88 @@
 #pragma once
 
 #include <sqlite3.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "database_interface.h"
+#include "sqlite_connection.h"
 #include "url.h"
 
+// Writes go through a single writer connection; reads are spread over a pool
+// of read-only connections, so they run in parallel with the inserts.
 class SqliteDb : public DatabaseInterface {
    public:
-    explicit SqliteDb(const std::string& databasePath);
+    // Opening a database of an older schema migrates it first; with
+    // compressContent, request bodies are stored deflated.
+    explicit SqliteDb(const std::string& databasePath, size_t readConnections = 4,
+                      bool compressContent = false);
     ~SqliteDb() override = default;
 
     [[nodiscard]] size_t getRequestId(const std::string& content) const override;
 
+    bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) override;
+    bool removeRequest(const int requestId) override;
+
     bool insert(const Url& url) override;
 
+    // Inserts all rows in a single transaction.
+    bool insert(const std::vector<Url>& urls) override;
+
     std::vector<Url> find(const int requestId) override;
 
+    std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                          const ResultFilter& filter = {}) override;
+
     bool requestIdExists(const int requestId) override;
+    int lastRequestId() override;
+
+    // Body of the request as it was posted.
+    std::optional<std::string> requestContent(const int requestId);
+
+    std::optional<ResultTotals> totals(long long sinceMillis = 0) override;
 
    private:
-    void initDb();
-    void createTable();
+    using Reader = std::unique_ptr<SqliteConnection, std::function<void(SqliteConnection*)>>;
+
+    // Distinct URLs whose target ids are kept in memory.
+    static constexpr size_t kTargetCacheSize = 1 << 16;
+
+    int schemaVersion();
+    void execOrThrow(const std::string& sql);
+    bool tableExists(const std::string& table);
+    void migrate();
+    void migrateToV1();
+    void addPhaseColumns();
+    std::vector<Url> findFiltered(const int requestId, long long afterId, size_t limit,
+                                  const ResultFilter& filter);
+    bool insertRow(const Url& url, long long createdAt);
+    // Inserts the rows in one transaction; writer_mtx must be held.
+    bool insertRows(std::span<const Url> urls);
+    // Ends a failed insert, leaving no transaction open.
+    void rollbackRows();
+    // Id of the URL in targets, added if new; 0 on error. writer_mtx must
+    // be held.
+    long long internTarget(const std::string& url);
+    static Url readRow(sqlite3_stmt* stmt);
+    // Borrows a read-only connection; without any, reads share the writer.
+    Reader acquireReader();
 
    private:
-    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> db;
     std::string db_path;
+    bool compress_content;
+    mutable std::mutex writer_mtx;
+    std::unique_ptr<SqliteConnection> writer;
+    std::unordered_map<std::string, long long> target_ids;
+    std::mutex readers_mtx;
+    std::condition_variable readers_cv;
+    std::vector<std::unique_ptr<SqliteConnection>> readers;
+    std::vector<SqliteConnection*> idle_readers;
 };
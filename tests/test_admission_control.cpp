@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "admission_control.h"
+
+using Decision = AdmissionControl::Decision;
+
+TEST(AdmissionControlTest, RejectsWhenQueueIsFull) {
+    AdmissionControl admission(AdmissionLimits{3, 0, 0});
+    EXPECT_EQ(admission.admit("a", 2, 20).decision, Decision::Admitted);
+    admission.assign(1, "a", 2);
+
+    auto rejected = admission.admit("b", 2, 20);
+    EXPECT_EQ(rejected.decision, Decision::QueueFull);
+    EXPECT_GE(rejected.retry_after.count(), 1);
+    EXPECT_LE(rejected.retry_after, AdmissionControl::kMaxRetryAfter);
+
+    admission.finished(Url{1, "http://localhost/1"});
+    EXPECT_EQ(admission.stats().pending_urls, 1);
+    EXPECT_EQ(admission.admit("b", 2, 20).decision, Decision::Admitted);
+
+    auto stats = admission.stats();
+    EXPECT_EQ(stats.pending_urls, 3);
+    EXPECT_EQ(stats.rejected_full, 1);
+}
+
+TEST(AdmissionControlTest, BoundsBytesAndClients) {
+    AdmissionControl admission(AdmissionLimits{0, 100, 2});
+    EXPECT_EQ(admission.admit("a", 2, 40).decision, Decision::Admitted);
+    EXPECT_EQ(admission.admit("a", 1, 10).decision, Decision::QuotaExceeded);
+    EXPECT_EQ(admission.admit("b", 2, 70).decision, Decision::QueueFull);
+    EXPECT_EQ(admission.admit("b", 3, 30).decision, Decision::TooLarge);
+    EXPECT_EQ(admission.admit("b", 1, 200).decision, Decision::TooLarge);
+
+    admission.cancel("a", 2, 40);
+    EXPECT_EQ(admission.admit("a", 2, 40).decision, Decision::Admitted);
+
+    auto stats = admission.stats();
+    EXPECT_EQ(stats.pending_urls, 2);
+    EXPECT_EQ(stats.pending_bytes, 40);
+    EXPECT_EQ(stats.rejected_quota, 1);
+    EXPECT_EQ(stats.rejected_full, 1);
+    EXPECT_EQ(stats.rejected_too_large, 2);
+}
+
+TEST(AdmissionControlTest, IgnoresUrlsNeverAdmitted) {
+    AdmissionControl admission(AdmissionLimits{1, 0, 0});
+    EXPECT_EQ(admission.admit("a", 1, 18).decision, Decision::Admitted);
+    admission.assign(1, "a", 1);
+
+    admission.finished(Url{2, "http://localhost/2"});
+    EXPECT_EQ(admission.stats().pending_urls, 1);
+
+    admission.finished(Url{1, "http://localhost/1"});
+    admission.finished(Url{1, "http://localhost/1"});
+    EXPECT_EQ(admission.stats().pending_urls, 0);
+    EXPECT_EQ(admission.stats().pending_bytes, 0);
+}
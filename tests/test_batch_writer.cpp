@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "batch_writer.h"
+#include "sqlite_db.h"
+
+namespace {
+
+// Records the size of each batch and refuses the first failures of them.
+class RecordingDb : public DatabaseInterface {
+   public:
+    RecordingDb(std::shared_ptr<DatabaseInterface> database, size_t failures)
+        : db(std::move(database)), failures(failures) {}
+
+    [[nodiscard]] size_t getRequestId(const std::string& content) const override { return db->getRequestId(content); }
+    bool setRequestContent(const int requestId, const std::string& content, bool deflated = false) override {
+        return db->setRequestContent(requestId, content, deflated);
+    }
+    bool removeRequest(const int requestId) override {
+        return db->removeRequest(requestId);
+    }
+    bool insert(const Url& url) override { return insert(std::vector<Url>{url}); }
+    bool insert(const std::vector<Url>& urls) override {
+        std::unique_lock lock(mtx);
+        cv.wait(lock, [this] { return !held; });
+        if (failures > 0) {
+            failures--;
+            return false;
+        }
+        batches.push_back(urls.size());
+        return db->insert(urls);
+    }
+    std::vector<Url> find(const int requestId) override { return db->find(requestId); }
+    std::vector<Url> find(const int requestId, long long afterId, size_t limit,
+                          const ResultFilter& filter = {}) override {
+        return db->find(requestId, afterId, limit, filter);
+    }
+    bool requestIdExists(const int requestId) override { return db->requestIdExists(requestId); }
+    int lastRequestId() override { return db->lastRequestId(); }
+
+    std::vector<size_t> committed() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return batches;
+    }
+    // Inserts wait while the database is held.
+    void hold() {
+        std::lock_guard<std::mutex> lock(mtx);
+        held = true;
+    }
+    void letGo() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            held = false;
+        }
+        cv.notify_all();
+    }
+
+   private:
+    std::shared_ptr<DatabaseInterface> db;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool held = false;
+    size_t failures;
+    std::vector<size_t> batches;
+};
+
+}  // namespace
+
+class BatchWriterTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_batch_writer.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path);
+    }
+
+    void TearDown() override {
+        db.reset();
+        deleteTestDb();
+    }
+    void deleteTestDb() {
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(test_db_path + suffix);
+        }
+    }
+
+    std::string test_db_path;
+    std::shared_ptr<SqliteDb> db;
+};
+
+TEST_F(BatchWriterTest, CommitsInBatches) {
+    auto recording = std::make_shared<RecordingDb>(db, 0);
+    {
+        BatchWriter writer(recording, 4, std::chrono::seconds(10));
+        for (int i = 0; i < 10; i++) {
+            writer.insert(Url{1, "http://localhost/" + std::to_string(i), 200, 100});
+        }
+    }
+
+    EXPECT_EQ(db->find(1).size(), 10);
+    EXPECT_EQ(recording->committed(), std::vector<size_t>({4, 4, 2}));
+}
+
+TEST_F(BatchWriterTest, RetriesRefusedBatch) {
+    auto recording = std::make_shared<RecordingDb>(db, 2);
+    BatchWriter writer(recording, 2, std::chrono::seconds(10));
+    writer.insert(Url{1, "http://localhost/1", 200, 100});
+    writer.insert(Url{1, "http://localhost/2", 200, 100});
+
+    writer.flush();
+
+    EXPECT_EQ(db->find(1).size(), 2);
+    EXPECT_EQ(writer.rowCount(), 2);
+    EXPECT_EQ(writer.failedRowCount(), 0);
+}
+
+TEST_F(BatchWriterTest, CountsRowsOfBatchThatKeepsFailing) {
+    auto recording = std::make_shared<RecordingDb>(db, 100);
+    BatchWriter writer(recording, 2, std::chrono::seconds(10));
+    writer.insert(Url{1, "http://localhost/1", 200, 100});
+    writer.insert(Url{1, "http://localhost/2", 200, 100});
+
+    writer.flush();
+
+    EXPECT_EQ(writer.rowCount(), 0);
+    EXPECT_EQ(writer.commitCount(), 0);
+    EXPECT_EQ(writer.failedRowCount(), 2);
+    EXPECT_TRUE(db->find(1).empty());
+}
+
+TEST_F(BatchWriterTest, CommitsAfterLatency) {
+    BatchWriter writer(db, 100, std::chrono::milliseconds(20));
+    writer.insert(Url{1, "http://localhost", 200, 100});
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(writer.commitCount(), 1);
+    EXPECT_EQ(writer.lastCommitRows(), 1);
+    EXPECT_EQ(db->find(1).size(), 1);
+}
+
+// The row left over from a full batch waits its own latency, not that of
+// the oldest row taken with the batch.
+TEST_F(BatchWriterTest, HoldsRowsLeftOverFromBatch) {
+    BatchWriter writer(db, 2, std::chrono::milliseconds(300));
+    writer.insert(Url{1, "http://localhost/1", 200, 100});
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    writer.insert({Url{1, "http://localhost/2", 200, 100}, Url{1, "http://localhost/3", 200, 100}});
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(writer.commitCount(), 1);
+    EXPECT_EQ(writer.rowCount(), 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    EXPECT_EQ(writer.commitCount(), 2);
+    EXPECT_EQ(writer.rowCount(), 3);
+}
+
+TEST_F(BatchWriterTest, FindFlushesPendingRows) {
+    BatchWriter writer(db, 100, std::chrono::seconds(10));
+    writer.insert(Url{1, "http://localhost/1", 200, 100});
+    writer.insert(Url{1, "http://localhost/2", 200, 100});
+
+    EXPECT_EQ(writer.find(1).size(), 2);
+    EXPECT_EQ(writer.rowCount(), 2);
+}
+
+TEST_F(BatchWriterTest, FindLeavesRowsOfOtherRequestsQueued) {
+    BatchWriter writer(db, 100, std::chrono::seconds(10));
+    writer.insert(Url{1, "http://localhost/1", 200, 100});
+
+    EXPECT_TRUE(writer.find(2).empty());
+    EXPECT_TRUE(writer.find(2, 0, 10).empty());
+    EXPECT_EQ(writer.rowCount(), 0);
+    EXPECT_EQ(writer.find(1).size(), 1);
+    EXPECT_EQ(writer.rowCount(), 1);
+}
+
+TEST_F(BatchWriterTest, InsertWaitsForRoomInTheQueue) {
+    auto recording = std::make_shared<RecordingDb>(db, 0);
+    recording->hold();
+    BatchWriter writer(recording, 2, std::chrono::seconds(10), 2);
+    std::atomic<size_t> done = 0;
+    writer.onDone([&done](const std::vector<Url>& rows) { done += rows.size(); });
+    // The first batch is taken and waits on the database; the second
+    // fills the queue.
+    writer.insert({Url{1, "http://localhost/1", 200, 100}, Url{1, "http://localhost/2", 200, 100}});
+    writer.insert({Url{1, "http://localhost/3", 200, 100}, Url{1, "http://localhost/4", 200, 100}});
+
+    std::atomic<bool> inserted = false;
+    std::thread blocked([&] {
+        writer.insert(Url{1, "http://localhost/5", 200, 100});
+        inserted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(done, 0);
+
+    recording->letGo();
+    blocked.join();
+    writer.flush();
+    EXPECT_EQ(done, 5);
+    EXPECT_EQ(db->find(1).size(), 5);
+}
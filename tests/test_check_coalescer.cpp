@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "check_coalescer.h"
+
+TEST(CheckCoalescerTest, SharesCheckInFlight) {
+    CheckCoalescer coalescer;
+    Url first{1, "http://localhost/1"};
+    Url second{2, "http://localhost/1"};
+    Url other{2, "http://localhost/2"};
+    EXPECT_EQ(coalescer.begin(first), CheckCoalescer::Outcome::Check);
+    EXPECT_EQ(coalescer.begin(second), CheckCoalescer::Outcome::Joined);
+    EXPECT_EQ(coalescer.begin(other), CheckCoalescer::Outcome::Check);
+
+    first.http_status = 503;
+    first.response_time = 42;
+    auto waiters = coalescer.finish(first);
+    ASSERT_EQ(waiters.size(), 1);
+    EXPECT_EQ(waiters[0].request_id, 2);
+    EXPECT_EQ(waiters[0].http_status, 503);
+    EXPECT_EQ(waiters[0].response_time, 42);
+    EXPECT_TRUE(coalescer.finish(other).empty());
+
+    // Without a ttl nothing outlives the check.
+    Url again{3, "http://localhost/1"};
+    EXPECT_EQ(coalescer.begin(again), CheckCoalescer::Outcome::Check);
+
+    auto stats = coalescer.stats();
+    EXPECT_EQ(stats.requested, 4);
+    EXPECT_EQ(stats.checked, 3);
+    EXPECT_EQ(stats.joined, 1);
+    EXPECT_EQ(stats.cached, 0);
+    EXPECT_DOUBLE_EQ(stats.dedupRatio(), 0.25);
+}
+
+TEST(CheckCoalescerTest, ReusesRecentResult) {
+    CheckCoalescer coalescer(std::chrono::milliseconds(50));
+    Url first{1, "http://localhost/1"};
+    ASSERT_EQ(coalescer.begin(first), CheckCoalescer::Outcome::Check);
+    first.http_status = 200;
+    first.response_time = 7;
+    coalescer.finish(first);
+
+    Url second{2, "http://localhost/1"};
+    EXPECT_EQ(coalescer.begin(second), CheckCoalescer::Outcome::Cached);
+    EXPECT_EQ(second.http_status, 200);
+    EXPECT_EQ(second.response_time, 7);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    Url third{3, "http://localhost/1"};
+    EXPECT_EQ(coalescer.begin(third), CheckCoalescer::Outcome::Check);
+    EXPECT_EQ(coalescer.stats().cached, 1);
+}
+
+TEST(CheckCoalescerTest, BoundsCachedResults) {
+    CheckCoalescer coalescer(std::chrono::seconds(60), 2);
+    for (int i = 0; i < 3; i++) {
+        Url url{1, "http://localhost/" + std::to_string(i)};
+        coalescer.begin(url);
+        coalescer.finish(url);
+    }
+    Url oldest{2, "http://localhost/0"};
+    Url newest{2, "http://localhost/2"};
+    EXPECT_EQ(coalescer.begin(oldest), CheckCoalescer::Outcome::Check);
+    EXPECT_EQ(coalescer.begin(newest), CheckCoalescer::Outcome::Cached);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "curl_multi.h"
+#include "loadgen/stub_origin.h"
+
+namespace {
+
+StubOriginConfig fixedLatency(std::chrono::milliseconds latency) {
+    StubOriginConfig config;
+    config.latency = latency;
+    config.distribution = StubOriginConfig::Distribution::Fixed;
+    return config;
+}
+
+std::string urlOf(const StubOrigin& origin) {
+    return "http://127.0.0.1:" + std::to_string(origin.port()) + "/";
+}
+
+// Statuses the callbacks reported, in completion order.
+struct Results {
+    void add(size_t status) {
+        std::lock_guard<std::mutex> lock(mtx);
+        statuses.push_back(status);
+        cv.notify_all();
+    }
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mtx);
+        return cv.wait_for(lock, std::chrono::seconds(10), [&] { return statuses.size() >= count; });
+    }
+    std::vector<size_t> get() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return statuses;
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<size_t> statuses;
+};
+
+}  // namespace
+
+TEST(CurlMultiTest, ChecksLocalOrigin) {
+    StubOrigin origin(fixedLatency(std::chrono::milliseconds(1)));
+    Results results;
+    CurlMulti client;
+
+    for (int i = 0; i < 20; i++) {
+        client.check(urlOf(origin), 5, [&](size_t status, const PhaseTimings&) { results.add(status); });
+    }
+
+    ASSERT_TRUE(results.waitFor(20));
+    EXPECT_EQ(results.get(), std::vector<size_t>(20, 200));
+}
+
+TEST(CurlMultiTest, DestructionFailsChecksInFlight) {
+    StubOriginConfig config = fixedLatency(std::chrono::milliseconds(1));
+    config.hang_rate = 1;
+    StubOrigin origin(config);
+    Results results;
+    {
+        CurlMulti client;
+        for (int i = 0; i < 5; i++) {
+            client.check(urlOf(origin), 60, [&](size_t status, const PhaseTimings&) { results.add(status); });
+        }
+        // Some reach the origin and hang there, the rest may not be added yet.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (origin.hung() == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_GT(origin.hung(), 0);
+    }
+
+    EXPECT_EQ(results.get(), std::vector<size_t>(5, 0));
+}
+
+TEST(CurlMultiTest, DestructionFailsChecksNotStarted) {
+    StubOriginConfig config = fixedLatency(std::chrono::milliseconds(1));
+    config.hang_rate = 1;
+    StubOrigin origin(config);
+    Results results;
+    {
+        CurlMulti client;
+        client.check(urlOf(origin), 60, [&](size_t status, const PhaseTimings&) { results.add(status); });
+    }
+
+    EXPECT_EQ(results.get(), std::vector<size_t>{0});
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "curl.h"
+#include "curl_pool.h"
+#include "loadgen/stub_origin.h"
+#include "metrics.h"
+
+// The pool counts into the process-wide metrics, so tests look at what
+// they add to them.
+class CurlPoolTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        hits_before = metrics().curl_pool_hits.value();
+        misses_before = metrics().curl_pool_misses.value();
+    }
+    uint64_t hits() const { return metrics().curl_pool_hits.value() - hits_before; }
+    uint64_t misses() const { return metrics().curl_pool_misses.value() - misses_before; }
+
+    uint64_t hits_before = 0;
+    uint64_t misses_before = 0;
+};
+
+TEST_F(CurlPoolTest, ReusesReleasedHandle) {
+    auto pool = std::make_shared<CurlPool>(2, std::chrono::seconds(60));
+
+    CURL* first = nullptr;
+    {
+        auto handle = pool->acquire();
+        first = handle.get();
+    }
+    auto handle = pool->acquire();
+
+    EXPECT_EQ(handle.get(), first);
+    EXPECT_EQ(misses(), 1);
+    EXPECT_EQ(hits(), 1);
+}
+
+TEST_F(CurlPoolTest, KeepsAtMostMaxSizeHandles) {
+    auto pool = std::make_shared<CurlPool>(1, std::chrono::seconds(60));
+    {
+        auto first = pool->acquire();
+        auto second = pool->acquire();
+    }
+    auto first = pool->acquire();
+    auto second = pool->acquire();
+
+    EXPECT_EQ(misses(), 3);
+    EXPECT_EQ(hits(), 1);
+}
+
+TEST_F(CurlPoolTest, EvictsIdleHandles) {
+    auto pool = std::make_shared<CurlPool>(2, std::chrono::seconds(0));
+    {
+        auto handle = pool->acquire();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto handle = pool->acquire();
+
+    EXPECT_EQ(misses(), 2);
+    EXPECT_EQ(hits(), 0);
+}
+
+TEST_F(CurlPoolTest, CountsReusedConnections) {
+    auto pool = std::make_shared<CurlPool>(1, std::chrono::seconds(60));
+    const uint64_t reused = metrics().curl_connections_reused.value();
+    const uint64_t created = metrics().curl_connections_created.value();
+    pool->recordConnection(false);
+    pool->recordConnection(true);
+    pool->recordConnection(true);
+
+    EXPECT_EQ(metrics().curl_connections_reused.value() - reused, 2);
+    EXPECT_EQ(metrics().curl_connections_created.value() - created, 1);
+}
+
+// Handles go from thread to thread through the pool; each one keeps its own
+// connections, so checks on several threads at once still reuse them.
+TEST_F(CurlPoolTest, ReusesConnectionsAcrossThreads) {
+    StubOriginConfig config;
+    config.latency = std::chrono::milliseconds(1);
+    config.distribution = StubOriginConfig::Distribution::Fixed;
+    StubOrigin origin(config);
+    const std::string url = "http://127.0.0.1:" + std::to_string(origin.port()) + "/";
+    auto pool = std::make_shared<CurlPool>(4, std::chrono::seconds(60));
+    const uint64_t reused = metrics().curl_connections_reused.value();
+
+    std::vector<std::thread> threads;
+    std::atomic<size_t> ok = 0;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 20; j++) {
+                if (Curl(url, 5, pool).getHttpStatus() == 200) {
+                    ok++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(ok.load(), 80);
+    EXPECT_EQ(origin.served(), 80);
+    EXPECT_GT(metrics().curl_connections_reused.value() - reused, 0);
+}
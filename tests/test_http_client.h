@@ -1,7 +1,11 @@
 #pragma once
 
+#include "async_http_client_interface.h"
 #include "http_client_interface.h"
 
+// Timings of a plain-HTTP check that took 100 ms.
+inline constexpr PhaseTimings kTestTimings{1000, 3000, 0, 3100, 60000, 100000};
+
 class TestHttpClient : public HttpClientInterface {
    public:
     [[nodiscard]] size_t getHttpStatus() const override {
@@ -11,4 +15,15 @@ class TestHttpClient : public HttpClientInterface {
    [[nodiscard]] long long getRequestTime() const override {
         return 100;
    };
+
+    [[nodiscard]] PhaseTimings getTimings() const override {
+        return kTestTimings;
+    }
+};
+
+class TestAsyncHttpClient : public AsyncHttpClientInterface {
+   public:
+    void check(const std::string&, size_t, Callback callback) override {
+        callback(200, kTestTimings);
+    }
 };
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "http_request_parser.h"
+#include "http_routes.h"
+
+TEST(HttpRequestParserTest, ParsesRequestHead) {
+    std::string data =
+        "POST /check_urls?dry=1 HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "content-type:  application/json \r\n"
+        "CONTENT-LENGTH: 12\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "{\"urls\": []}";
+    HttpRequestParser parser;
+
+    ASSERT_EQ(parser.parse(data), HttpRequestParser::Result::Complete);
+    const HttpRequest& request = parser.request();
+    EXPECT_EQ(request.method, "POST");
+    EXPECT_EQ(request.target, "/check_urls?dry=1");
+    EXPECT_EQ(request.path, "/check_urls");
+    EXPECT_EQ(request.query, "dry=1");
+    EXPECT_EQ(request.version, "HTTP/1.1");
+    EXPECT_EQ(request.content_type, "application/json");
+    EXPECT_EQ(request.connection, "keep-alive");
+    EXPECT_EQ(request.content_length, 12);
+    EXPECT_EQ(data.substr(parser.headerSize()), "{\"urls\": []}");
+}
+
+TEST(HttpRequestParserTest, ParsesHeadArrivingInPieces) {
+    std::string full = "GET /get_results/1 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string data;
+    HttpRequestParser parser;
+
+    for (size_t i = 0; i + 1 < full.size(); i++) {
+        data += full[i];
+        ASSERT_EQ(parser.parse(data), HttpRequestParser::Result::Incomplete);
+    }
+    data += full.back();
+
+    ASSERT_EQ(parser.parse(data), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(parser.request().path, "/get_results/1");
+    EXPECT_EQ(parser.headerSize(), full.size());
+}
+
+TEST(HttpRequestParserTest, RejectsMalformedHead) {
+    HttpRequestParser parser;
+    EXPECT_EQ(parser.parse("GET\r\n\r\n"), HttpRequestParser::Result::Bad);
+
+    parser.reset();
+    EXPECT_EQ(parser.parse("GET / HTTP/1.1\r\nNoColon\r\n\r\n"), HttpRequestParser::Result::Bad);
+
+    parser.reset();
+    EXPECT_EQ(parser.parse("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n"), HttpRequestParser::Result::Bad);
+
+    parser.reset();
+    EXPECT_EQ(parser.parse("POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n"),
+              HttpRequestParser::Result::Bad);
+}
+
+TEST(HttpRequestParserTest, KeepsTransferEncoding) {
+    HttpRequestParser parser;
+    ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"),
+              HttpRequestParser::Result::Complete);
+    EXPECT_EQ(parser.request().transfer_encoding, "chunked");
+    EXPECT_FALSE(parser.request().has_content_length);
+}
+
+TEST(HttpRequestParserTest, NegotiatesContentEncoding) {
+    HttpRequestParser parser;
+    ASSERT_EQ(parser.parse("GET / HTTP/1.1\r\nAccept-Encoding: deflate, gzip;q=0.5\r\n\r\n"),
+              HttpRequestParser::Result::Complete);
+    EXPECT_EQ(parser.request().accept_encoding, "deflate, gzip;q=0.5");
+    EXPECT_EQ(negotiateEncoding(parser.request().accept_encoding), ContentEncoding::Deflate);
+
+    EXPECT_EQ(negotiateEncoding(""), ContentEncoding::Identity);
+    EXPECT_EQ(negotiateEncoding("br"), ContentEncoding::Identity);
+    EXPECT_EQ(negotiateEncoding("deflate, GZIP"), ContentEncoding::Gzip);
+    EXPECT_EQ(negotiateEncoding("gzip;q=0, deflate;q=0.1"), ContentEncoding::Deflate);
+    EXPECT_EQ(negotiateEncoding("gzip;q=0, deflate;q=0"), ContentEncoding::Identity);
+    EXPECT_EQ(negotiateEncoding("gzip;q=x"), ContentEncoding::Identity);
+    EXPECT_EQ(negotiateEncoding("*"), ContentEncoding::Gzip);
+    EXPECT_EQ(negotiateEncoding("gzip;q=0, *"), ContentEncoding::Deflate);
+}
+
+TEST(HttpRoutesTest, FindsRoutes) {
+    const RouteEntry* results = findRoute("GET", "/get_results/12");
+    ASSERT_NE(results, nullptr);
+    EXPECT_EQ(results->route, Route::GetResults);
+
+    const RouteEntry* check = findRoute("POST", "/check_urls");
+    ASSERT_NE(check, nullptr);
+    EXPECT_EQ(check->route, Route::CheckUrls);
+
+    EXPECT_EQ(findRoute("GET", "/check_urls"), nullptr);
+    EXPECT_EQ(findRoute("POST", "/check_urls/1"), nullptr);
+    static_assert(findRoute("GET", "/get_results/1") != nullptr);
+}
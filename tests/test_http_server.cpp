@@ -2,8 +2,11 @@
 #include <boost/asio.hpp>
 #include <chrono>
 #include <memory>
+#include <semaphore>
 #include <filesystem>
 #include <thread>
+#include <vector>
+#include "compression.h"
 #include "http_server.h"
 #include "test_http_client.h"
 #include "sqlite_db.h"
@@ -41,14 +44,15 @@ class HttpServerTest : public ::testing::Test {
         deleteTestDb();
     }
     void deleteTestDb() {
-        if (std::filesystem::exists(test_db_path)) {
-            std::filesystem::remove(test_db_path);
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(test_db_path + suffix);
         }
     }
     std::string sendHttpRequest(const std::string& method,
                                 const std::string& url,
                                 const std::string& body = "",
-                                const std::string& content_type = "application/json") {
+                                const std::string& content_type = "application/json",
+                                const std::string& headers = "") {
         boost::asio::io_context io;
         tcp::socket socket(io);
         tcp::resolver resolver(io);
@@ -59,6 +63,7 @@ class HttpServerTest : public ::testing::Test {
         request += "Content-Type: " + content_type + "\r\n";
         request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
         request += "Connection: close\r\n";
+        request += headers;
         request += "\r\n";
         request += body;
         boost::asio::write(socket, boost::asio::buffer(request));
@@ -77,6 +82,31 @@ class HttpServerTest : public ::testing::Test {
         }
         return "";
     }
+    std::string decodeChunked(const std::string& body) {
+        std::string decoded;
+        size_t pos = 0;
+        while (pos < body.size()) {
+            size_t line_end = body.find("\r\n", pos);
+            size_t size = std::stoul(body.substr(pos, line_end - pos), nullptr, 16);
+            if (size == 0) {
+                break;
+            }
+            decoded += body.substr(line_end + 2, size);
+            pos = line_end + 2 + size + 2;
+        }
+        return decoded;
+    }
+    int insertResults(size_t count) {
+        const int requestId = db->getRequestId("{}");
+        std::vector<Url> urls;
+        for (size_t i = 0; i < count; i++) {
+            // Each result connects 1 ms slower than the one before.
+            PhaseTimings timings{500, 1000 * static_cast<long long>(i + 1), 0, 0, 0, 10000};
+            urls.push_back(Url{requestId, "http://localhost/" + std::to_string(i), 200, 10, "", 0, timings});
+        }
+        db->insert(urls);
+        return requestId;
+    }
     std::string getStatusCode(const std::string& response) {
         size_t start = response.find(' ') + 1;
         size_t end = response.find(' ', start);
@@ -126,6 +156,9 @@ TEST_F(HttpServerTest, CheckUrl) {
     EXPECT_EQ(responseBody["urls"][0]["url"], "http://localhost");
     EXPECT_EQ(responseBody["urls"][0]["http_status"], 200);
     EXPECT_EQ(responseBody["urls"][0]["response_time"], 100);
+    EXPECT_EQ(responseBody["urls"][0]["timings"]["namelookup_us"], 1000);
+    EXPECT_EQ(responseBody["urls"][0]["timings"]["starttransfer_us"], 60000);
+    EXPECT_EQ(responseBody["urls"][0]["timings"]["total_us"], 100000);
 }
 
 TEST_F(HttpServerTest, CheckMultipleUrls) {
@@ -226,3 +259,720 @@ TEST_F(HttpServerTest, CheckUnsupportedMethod) {
     json responseJson = json::parse(body);
     EXPECT_EQ(responseJson["error"], "Method Not Allowed");
 }
+
+TEST_F(HttpServerTest, CheckConcurrentRequests) {
+    json requestBody = {
+        {"urls", {
+            {{"url", "http://localhost"}}
+        }}
+    };
+    std::string response = sendHttpRequest("POST", "/check_urls", requestBody.dump());
+    int requestId = json::parse(getBody(response))["request_id"];
+
+    std::vector<std::string> statuses(8);
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < statuses.size(); i++) {
+        clients.emplace_back([&, i] {
+            statuses[i] = getStatusCode(sendHttpRequest("GET", "/get_results/" + std::to_string(requestId)));
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    for (const auto& status : statuses) {
+        EXPECT_EQ(status, "200");
+    }
+}
+
+TEST_F(HttpServerTest, CachesCompletedResults) {
+    const int requestId = insertResults(2);
+    const std::string path = "/get_results/" + std::to_string(requestId);
+    auto cache = server->resultCache();
+    ASSERT_NE(cache, nullptr);
+
+    std::string first = getBody(sendHttpRequest("GET", path));
+    EXPECT_EQ(cache->hits(), 0);
+    EXPECT_EQ(cache->size(), 1);
+    std::string second = getBody(sendHttpRequest("GET", path));
+    EXPECT_EQ(cache->hits(), 1);
+    EXPECT_EQ(first, second);
+
+    getBody(sendHttpRequest("GET", path + "?limit=1"));
+    EXPECT_EQ(cache->hits(), 1);
+}
+
+TEST_F(HttpServerTest, ReportsCheckStats) {
+    std::string response = sendHttpRequest("GET", "/stats");
+    EXPECT_EQ(getStatusCode(response), "200");
+    json body = json::parse(getBody(response));
+    ASSERT_TRUE(body.contains("checks"));
+    EXPECT_EQ(body["checks"]["requested"], 0);
+    EXPECT_EQ(body["checks"]["dedup_ratio"], 0.0);
+    EXPECT_FALSE(body.contains("results"));
+}
+
+TEST_F(HttpServerTest, ReportsStoredResultTotals) {
+    json requestBody = {{"urls", {{{"url", "http://localhost/1"}}, {{"url", "http://localhost/2"}}}}};
+    sendHttpRequest("POST", "/check_urls", requestBody.dump());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    json results = json::parse(getBody(sendHttpRequest("GET", "/stats?since=0")))["results"];
+    EXPECT_EQ(results["stored"], 2);
+    EXPECT_EQ(results["successes"], 2);
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", "/stats?since=soon")), "400");
+}
+
+TEST_F(HttpServerTest, ReportsUrlStats) {
+    json requestBody = {{"urls", {{{"url", "http://localhost/a?b=1"}}}}};
+    sendHttpRequest("POST", "/check_urls", requestBody.dump());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::string response = sendHttpRequest("GET", "/stats?url=http%3A%2F%2Flocalhost%2Fa%3Fb%3D1");
+    ASSERT_EQ(getStatusCode(response), "200");
+    json body = json::parse(getBody(response));
+    EXPECT_EQ(body["url"], "http://localhost/a?b=1");
+    for (const auto* window : {"1m", "1h", "24h"}) {
+        EXPECT_EQ(body["windows"][window]["checks"], 1);
+        EXPECT_EQ(body["windows"][window]["success_ratio"], 1.0);
+        EXPECT_NEAR(body["windows"][window]["p50_us"].get<double>(), 100000.0, 100000.0 / 32);
+    }
+    EXPECT_EQ(json::parse(getBody(sendHttpRequest("GET", "/stats")))["urls_tracked"], 1);
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", "/stats?url=http%3A%2F%2Fother")), "404");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", "/stats?url=%zz")), "400");
+}
+
+TEST_F(HttpServerTest, ExportsMetrics) {
+    sendHttpRequest("GET", "/get_results/9999");
+    std::string response = sendHttpRequest("GET", "/metrics");
+    EXPECT_EQ(getStatusCode(response), "200");
+    EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4"), std::string::npos);
+    std::string body = getBody(response);
+    EXPECT_NE(body.find("# TYPE monitoring_http_request_duration_seconds histogram"), std::string::npos);
+    EXPECT_NE(body.find("monitoring_queue_depth 0\n"), std::string::npos);
+    EXPECT_NE(body.find("monitoring_workers 2\n"), std::string::npos);
+    EXPECT_NE(body.find("# TYPE monitoring_curl_connections_reused_total counter"), std::string::npos);
+}
+
+TEST_F(HttpServerTest, GetResultsPage) {
+    const int requestId = insertResults(3);
+    const std::string path = "/get_results/" + std::to_string(requestId);
+
+    std::string response = sendHttpRequest("GET", path + "?limit=2");
+    EXPECT_EQ(getStatusCode(response), "200");
+    json page = json::parse(getBody(response));
+    ASSERT_EQ(page["urls"].size(), 2);
+    EXPECT_EQ(page["urls"][0]["url"], "http://localhost/0");
+    ASSERT_TRUE(page.contains("next_after"));
+    EXPECT_EQ(page["next_after"], page["urls"][1]["id"]);
+
+    long long after = page["next_after"];
+    response = sendHttpRequest("GET", path + "?after=" + std::to_string(after) + "&limit=2");
+    page = json::parse(getBody(response));
+    ASSERT_EQ(page["urls"].size(), 1);
+    EXPECT_EQ(page["urls"][0]["url"], "http://localhost/2");
+    EXPECT_FALSE(page.contains("next_after"));
+
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", path + "?limit=abc")), "400");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", path + "?limit=0")), "400");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", path + "?after=-")), "400");
+}
+
+TEST_F(HttpServerTest, FiltersResultsByPhase) {
+    const int requestId = insertResults(4);
+    const std::string path = "/get_results/" + std::to_string(requestId);
+
+    std::string response = sendHttpRequest("GET", path + "?min_connect_us=2000&max_connect_us=3000");
+    EXPECT_EQ(getStatusCode(response), "200");
+    json page = json::parse(getBody(response));
+    ASSERT_EQ(page["urls"].size(), 2);
+    EXPECT_EQ(page["urls"][0]["url"], "http://localhost/1");
+    EXPECT_EQ(page["urls"][1]["timings"]["connect_us"], 3000);
+
+    response = sendHttpRequest("GET", path + "?min_connect_us=2000&limit=1");
+    page = json::parse(getBody(response));
+    ASSERT_EQ(page["urls"].size(), 1);
+    long long after = page["next_after"];
+    response = sendHttpRequest("GET", path + "?min_connect_us=2000&limit=5&after=" + std::to_string(after));
+    page = json::parse(getBody(response));
+    ASSERT_EQ(page["urls"].size(), 2);
+    EXPECT_EQ(page["urls"][1]["url"], "http://localhost/3");
+
+    response = sendHttpRequest("GET", path + "?max_total_us=9999");
+    EXPECT_TRUE(json::parse(getBody(response))["urls"].empty());
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", path + "?min_connect_us=fast")), "400");
+}
+
+TEST_F(HttpServerTest, StreamResults) {
+    const int requestId = insertResults(2500);
+
+    std::string response = sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?stream=1");
+    EXPECT_EQ(getStatusCode(response), "200");
+    EXPECT_NE(response.find("Transfer-Encoding: chunked"), std::string::npos);
+    json body = json::parse(decodeChunked(getBody(response)));
+    EXPECT_EQ(body["request_id"], std::to_string(requestId));
+    ASSERT_EQ(body["urls"].size(), 2500);
+    EXPECT_EQ(body["urls"][0]["url"], "http://localhost/0");
+    EXPECT_EQ(body["urls"][2499]["url"], "http://localhost/2499");
+
+    const int emptyId = insertResults(0);
+    response = sendHttpRequest("GET", "/get_results/" + std::to_string(emptyId) + "?stream=1");
+    body = json::parse(decodeChunked(getBody(response)));
+    EXPECT_TRUE(body["urls"].empty());
+}
+
+TEST_F(HttpServerTest, CompressesResultsForClientsThatAcceptIt) {
+    const int requestId = insertResults(200);
+    const std::string path = "/get_results/" + std::to_string(requestId);
+    auto cache = server->resultCache();
+    const std::string plain = getBody(sendHttpRequest("GET", path));
+
+    std::string response = sendHttpRequest("GET", path, "", "application/json", "Accept-Encoding: gzip\r\n");
+    EXPECT_NE(response.find("Content-Encoding: gzip"), std::string::npos);
+    EXPECT_NE(response.find("Vary: Accept-Encoding"), std::string::npos);
+    std::string body = getBody(response);
+    EXPECT_LT(body.size() * 4, plain.size());
+    EXPECT_EQ(decompress(body), plain);
+    const size_t hits = cache->hits();
+
+    // The compressed body is cached too.
+    response = sendHttpRequest("GET", path, "", "application/json", "Accept-Encoding: gzip\r\n");
+    EXPECT_EQ(getBody(response), body);
+    EXPECT_EQ(cache->hits(), hits + 1);
+
+    response = sendHttpRequest("GET", path + "?limit=50", "", "application/json", "Accept-Encoding: deflate\r\n");
+    EXPECT_NE(response.find("Content-Encoding: deflate"), std::string::npos);
+    EXPECT_EQ(json::parse(*decompress(getBody(response)))["urls"].size(), 50);
+
+    // Bodies below the threshold are sent as they are.
+    const int emptyId = insertResults(0);
+    response = sendHttpRequest("GET", "/get_results/" + std::to_string(emptyId), "", "application/json",
+                               "Accept-Encoding: gzip\r\n");
+    EXPECT_EQ(response.find("Content-Encoding"), std::string::npos);
+    EXPECT_TRUE(json::parse(getBody(response))["urls"].empty());
+}
+
+TEST_F(HttpServerTest, CompressesStreamedResults) {
+    const int requestId = insertResults(2500);
+
+    std::string response = sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?stream=1", "",
+                                           "application/json", "Accept-Encoding: gzip\r\n");
+    EXPECT_NE(response.find("Content-Encoding: gzip"), std::string::npos);
+    auto decoded = decompress(decodeChunked(getBody(response)));
+    ASSERT_TRUE(decoded);
+    json body = json::parse(*decoded);
+    ASSERT_EQ(body["urls"].size(), 2500);
+    EXPECT_EQ(body["urls"][2499]["url"], "http://localhost/2499");
+}
+
+class HttpKeepAliveTest : public HttpServerTest {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_http_keep_alive.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path);
+        auto http_client_factory = [](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+            return std::make_unique<TestHttpClient>();
+        };
+        port = 8889;
+        io_context = std::make_unique<boost::asio::io_context>();
+        HttpServerConfig config;
+        config.keep_alive_timeout = std::chrono::seconds(1);
+        config.keep_alive_max = 3;
+        server = std::make_unique<HttpServer>(*io_context, port, db,
+                                              std::make_shared<UrlParser>(1, 1, db, http_client_factory), config);
+        server_thread = std::thread([this]() {
+            io_context->run();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    void connect(tcp::socket& socket) {
+        tcp::resolver resolver(socket.get_executor());
+        boost::asio::connect(socket, resolver.resolve("127.0.0.1", std::to_string(port)));
+    }
+    std::string request(const std::string& url, const std::string& connection = "") {
+        std::string request = "GET " + url + " HTTP/1.1\r\nHost: localhost\r\n";
+        if (!connection.empty()) {
+            request += "Connection: " + connection + "\r\n";
+        }
+        return request + "\r\n";
+    }
+    // Reads exactly one response, leaving any following one in the buffer.
+    std::string readResponse(tcp::socket& socket, boost::asio::streambuf& buffer) {
+        boost::system::error_code ec;
+        size_t header_size = boost::asio::read_until(socket, buffer, "\r\n\r\n", ec);
+        if (ec) {
+            return "";
+        }
+        std::string headers(boost::asio::buffers_begin(buffer.data()),
+                            boost::asio::buffers_begin(buffer.data()) + header_size);
+        buffer.consume(header_size);
+        size_t length_pos = headers.find("Content-Length: ");
+        size_t content_length = std::stoul(headers.substr(length_pos + 16));
+        if (buffer.size() < content_length) {
+            boost::asio::read(socket, buffer, boost::asio::transfer_exactly(content_length - buffer.size()));
+        }
+        std::string body(boost::asio::buffers_begin(buffer.data()),
+                         boost::asio::buffers_begin(buffer.data()) + content_length);
+        buffer.consume(content_length);
+        return headers + body;
+    }
+    bool isClosed(tcp::socket& socket, boost::asio::streambuf& buffer) {
+        boost::system::error_code ec;
+        boost::asio::read(socket, buffer, boost::asio::transfer_at_least(1), ec);
+        return ec == boost::asio::error::eof;
+    }
+};
+
+TEST_F(HttpKeepAliveTest, ServesSeveralRequestsOnOneConnection) {
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    connect(socket);
+    boost::asio::streambuf buffer;
+
+    for (int i = 0; i < 2; i++) {
+        boost::asio::write(socket, boost::asio::buffer(request("/get_results/9999")));
+        std::string response = readResponse(socket, buffer);
+        EXPECT_EQ(getStatusCode(response), "404");
+        EXPECT_NE(response.find("Connection: keep-alive"), std::string::npos);
+    }
+}
+
+TEST_F(HttpKeepAliveTest, AnswersPipelinedRequestsInOrder) {
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    connect(socket);
+    boost::asio::streambuf buffer;
+
+    boost::asio::write(socket, boost::asio::buffer(request("/get_results/9999") + request("/test", "close")));
+
+    std::string first = readResponse(socket, buffer);
+    std::string second = readResponse(socket, buffer);
+    EXPECT_EQ(json::parse(getBody(first))["error"], "Request ID not found");
+    EXPECT_EQ(json::parse(getBody(second))["error"], "Not Found");
+    EXPECT_NE(second.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(isClosed(socket, buffer));
+}
+
+// A chunked body would otherwise be read as the next request on the
+// connection.
+TEST_F(HttpKeepAliveTest, RefusesTransferEncodingAndCloses) {
+    const std::string smuggled = request("/get_results/9999");
+    const std::string chunks = "5\r\nhello\r\n0\r\n\r\n" + smuggled;
+    for (const auto& [length, status] : {std::pair{std::string(), "411"},
+                                         std::pair{"Content-Length: " + std::to_string(chunks.size()) + "\r\n",
+                                                   "501"}}) {
+        boost::asio::io_context io;
+        tcp::socket socket(io);
+        connect(socket);
+        boost::asio::streambuf buffer;
+
+        boost::asio::write(socket, boost::asio::buffer("POST /check_urls HTTP/1.1\r\nHost: localhost\r\n"
+                                                       "Content-Type: application/json\r\n"
+                                                       "Transfer-Encoding: chunked\r\n" +
+                                                       length + "\r\n" + chunks));
+        std::string response = readResponse(socket, buffer);
+        EXPECT_EQ(getStatusCode(response), status);
+        EXPECT_NE(response.find("Connection: close"), std::string::npos);
+        EXPECT_TRUE(isClosed(socket, buffer));
+    }
+}
+
+TEST_F(HttpKeepAliveTest, ClosesAfterMaxRequests) {
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    connect(socket);
+    boost::asio::streambuf buffer;
+
+    std::string response;
+    for (int i = 0; i < 3; i++) {
+        boost::asio::write(socket, boost::asio::buffer(request("/test")));
+        response = readResponse(socket, buffer);
+    }
+
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(isClosed(socket, buffer));
+}
+
+TEST_F(HttpKeepAliveTest, ClosesIdleConnection) {
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    connect(socket);
+    boost::asio::streambuf buffer;
+
+    boost::asio::write(socket, boost::asio::buffer(request("/test")));
+    readResponse(socket, buffer);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(isClosed(socket, buffer));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(3));
+}
+
+// Checks wait for the test to let them through, so requests stay in
+// progress for as long as it needs.
+class HttpPushTest : public HttpServerTest {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_http_push.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path);
+        auto http_client_factory = [this](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+            checks.acquire();
+            return std::make_unique<TestHttpClient>();
+        };
+        port = 8890;
+        io_context = std::make_unique<boost::asio::io_context>();
+        url_parser = std::make_shared<UrlParser>(1, 1, db, http_client_factory);
+        server = std::make_unique<HttpServer>(*io_context, port, db, url_parser);
+        server_thread = std::thread([this]() {
+            io_context->run();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    void TearDown() override {
+        checks.release(100);
+        HttpServerTest::TearDown();
+    }
+
+    int checkUrls(size_t count) {
+        json urls = json::array();
+        for (size_t i = 0; i < count; i++) {
+            urls.push_back({{"url", "http://localhost/" + std::to_string(i)}});
+        }
+        json response = json::parse(getBody(sendHttpRequest("POST", "/check_urls", json{{"urls", urls}}.dump())));
+        return response["request_id"];
+    }
+
+    std::counting_semaphore<> checks{0};
+    std::shared_ptr<UrlParser> url_parser;
+};
+
+TEST_F(HttpPushTest, LongPollReturnsOnCompletion) {
+    const int requestId = checkUrls(2);
+    const auto start = std::chrono::steady_clock::now();
+    std::thread release([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        checks.release(2);
+    });
+    std::string response = sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?wait=5000");
+    release.join();
+
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(3));
+    json body = json::parse(getBody(response));
+    EXPECT_EQ(body["complete"], true);
+    EXPECT_EQ(body["urls"].size(), 2);
+}
+
+TEST_F(HttpPushTest, LongPollTimesOut) {
+    const int requestId = checkUrls(1);
+    const auto start = std::chrono::steady_clock::now();
+    std::string response = sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?wait=200");
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+    json body = json::parse(getBody(response));
+    EXPECT_EQ(body["complete"], false);
+    EXPECT_EQ(body["progress"]["total"], 1);
+    EXPECT_EQ(body["progress"]["done"], 0);
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?wait=x")), "400");
+}
+
+// Completion landing on the deadline of a long-poll must not end the next
+// one on the same connection early.
+TEST_F(HttpPushTest, PipelinedLongPollOutlivesCompletionAtPreviousDeadline) {
+    for (int delay_ms : {90, 95, 100, 105, 110}) {
+        const int first = checkUrls(1);
+        const int second = checkUrls(1);
+        boost::asio::io_context io;
+        tcp::socket socket(io);
+        tcp::resolver resolver(io);
+        boost::asio::connect(socket, resolver.resolve("127.0.0.1", std::to_string(port)));
+        const std::string requests =
+            "GET /get_results/" + std::to_string(first) + "?wait=100 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /get_results/" + std::to_string(second) + "?wait=300 HTTP/1.1\r\nHost: localhost\r\n"
+            "Connection: close\r\n\r\n";
+        const auto start = std::chrono::steady_clock::now();
+        boost::asio::write(socket, boost::asio::buffer(requests));
+        std::thread release([this, delay_ms] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+            checks.release(1);
+        });
+        boost::asio::streambuf buffer;
+        boost::system::error_code ec;
+        boost::asio::read(socket, buffer, boost::asio::transfer_all(), ec);
+        release.join();
+
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(350)) << delay_ms;
+        std::string responses(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_end(buffer.data()));
+        json last = json::parse(responses.substr(responses.rfind("\r\n\r\n") + 4));
+        EXPECT_EQ(last["complete"], false);
+        checks.release(1);
+    }
+}
+
+TEST_F(HttpPushTest, StreamsEvents) {
+    const int requestId = checkUrls(2);
+    checks.release(1);
+    while (json::parse(getBody(sendHttpRequest("GET", "/get_results/" + std::to_string(requestId))))["progress"]["done"] != 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::thread release([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        checks.release(1);
+    });
+    std::string response = sendHttpRequest("GET", "/events/" + std::to_string(requestId));
+    release.join();
+
+    EXPECT_EQ(getStatusCode(response), "200");
+    EXPECT_NE(response.find("Content-Type: text/event-stream"), std::string::npos);
+    std::string body = getBody(response);
+    const size_t progress = body.find("event: progress\ndata: ");
+    const size_t result = body.find("event: result\ndata: ");
+    const size_t complete = body.find("event: complete\ndata: ");
+    ASSERT_NE(progress, std::string::npos);
+    ASSERT_NE(result, std::string::npos);
+    ASSERT_NE(complete, std::string::npos);
+    EXPECT_LT(progress, result);
+    EXPECT_LT(result, complete);
+    EXPECT_EQ(body.find("event: result", result + 1), std::string::npos);
+
+    json snapshot = json::parse(body.substr(progress + 22, body.find('\n', progress + 22) - progress - 22));
+    EXPECT_EQ(snapshot["done"], 1);
+    json url = json::parse(body.substr(result + 20, body.find('\n', result + 20) - result - 20));
+    EXPECT_EQ(url["url"], "http://localhost/1");
+}
+
+TEST_F(HttpPushTest, StreamsCompletionOfFinishedRequest) {
+    const int requestId = checkUrls(1);
+    checks.release(1);
+    sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?wait=5000");
+
+    std::string body = getBody(sendHttpRequest("GET", "/events/" + std::to_string(requestId)));
+    EXPECT_EQ(body.find("event: result"), std::string::npos);
+    EXPECT_NE(body.find("event: complete"), std::string::npos);
+    EXPECT_EQ(getStatusCode(sendHttpRequest("GET", "/events/999999")), "404");
+}
+
+TEST_F(HttpPushTest, LeavesAdmissionLimitsOfSharedParser) {
+    url_parser->admission()->setLimits(AdmissionLimits{3, 0, 2});
+
+    HttpServer other(*io_context, port + 100, db, url_parser);
+
+    EXPECT_EQ(url_parser->admission()->limits().max_urls, 3);
+    EXPECT_EQ(url_parser->admission()->limits().client_max_urls, 2);
+}
+
+TEST_F(HttpPushTest, RejectsUrlsBeyondAdmissionLimits) {
+    url_parser->admission()->setLimits(AdmissionLimits{3, 0, 2});
+    json two = {{"urls", {{{"url", "http://localhost/1"}}, {{"url", "http://localhost/2"}}}}};
+    json one = {{"urls", {{{"url", "http://localhost/3"}}}}};
+    json three = {{"urls", {{{"url", "http://localhost/4"}}, {{"url", "http://localhost/5"}}, {{"url", "http://localhost/6"}}}}};
+
+    std::string response = sendHttpRequest("POST", "/check_urls", two.dump());
+    ASSERT_EQ(getStatusCode(response), "200");
+    const int requestId = json::parse(getBody(response))["request_id"];
+
+    response = sendHttpRequest("POST", "/check_urls", one.dump());
+    EXPECT_EQ(getStatusCode(response), "429");
+    EXPECT_NE(response.find("Retry-After: "), std::string::npos);
+    EXPECT_GE(json::parse(getBody(response))["retry_after"], 1);
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/check_urls", three.dump())), "413");
+
+    url_parser->admission()->setLimits(AdmissionLimits{2, 0, 0});
+    response = sendHttpRequest("POST", "/check_urls", one.dump());
+    EXPECT_EQ(getStatusCode(response), "503");
+    EXPECT_NE(response.find("Retry-After: "), std::string::npos);
+
+    checks.release(2);
+    sendHttpRequest("GET", "/get_results/" + std::to_string(requestId) + "?wait=5000");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/check_urls", one.dump())), "200");
+
+    json stats = json::parse(getBody(sendHttpRequest("GET", "/stats")))["admission"];
+    EXPECT_EQ(stats["pending_urls"], 1);
+    EXPECT_EQ(stats["rejected_quota"], 1);
+    EXPECT_EQ(stats["rejected_queue_full"], 1);
+    EXPECT_EQ(stats["rejected_too_large"], 1);
+}
+
+class HttpIngestTest : public HttpServerTest {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_http_ingest.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path);
+        auto http_client_factory = [](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+            return std::make_unique<TestHttpClient>();
+        };
+        port = 8892;
+        io_context = std::make_unique<boost::asio::io_context>();
+        url_parser = std::make_shared<UrlParser>(1, 1, db, http_client_factory);
+        HttpServerConfig config;
+        config.max_body_bytes = 4096;
+        config.ingest_chunk_urls = 10;
+        server = std::make_unique<HttpServer>(*io_context, port, db, url_parser, config);
+        server_thread = std::thread([this]() {
+            io_context->run();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    // Posts the head of /check_urls with the first part of the body, and
+    // waits until the URLs in it are checked.
+    void postPart(tcp::socket& socket, size_t bodySize, const std::string& part, size_t checked) {
+        tcp::resolver resolver(socket.get_executor());
+        boost::asio::connect(socket, resolver.resolve("127.0.0.1", std::to_string(port)));
+        boost::asio::write(socket, boost::asio::buffer("POST /check_urls HTTP/1.1\r\n"
+                                                       "Content-Type: application/json\r\n"
+                                                       "Content-Length: " + std::to_string(bodySize) + "\r\n"
+                                                       "Connection: close\r\n"
+                                                       "\r\n" + part));
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (db->find(1).size() < checked && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    // Sends the rest of the body and reads the response.
+    std::string postRest(tcp::socket& socket, const std::string& rest) {
+        boost::asio::write(socket, boost::asio::buffer(rest));
+        boost::asio::streambuf response_buf;
+        boost::system::error_code ec;
+        boost::asio::read(socket, response_buf, boost::asio::transfer_all(), ec);
+        return std::string(boost::asio::buffers_begin(response_buf.data()), boost::asio::buffers_end(response_buf.data()));
+    }
+    static json urlList(int count) {
+        json urls = json::array();
+        for (int i = 0; i < count; i++) {
+            urls.push_back({{"url", "http://localhost/" + std::to_string(i)}});
+        }
+        return urls;
+    }
+
+    std::shared_ptr<UrlParser> url_parser;
+};
+
+TEST_F(HttpIngestTest, ChecksUrlsBeforeTheBodyEnds) {
+    const std::string body = json{{"urls", urlList(25)}}.dump();
+    // Cut inside the 21st entry, so two chunks are complete.
+    const size_t cut = body.find("http://localhost/20");
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+
+    postPart(socket, body.size(), body.substr(0, cut), 20);
+    EXPECT_EQ(db->find(1).size(), 20);
+    // Open until the body ends, however many of its URLs are done.
+    EXPECT_FALSE(url_parser->isComplete(1));
+
+    const std::string response = postRest(socket, body.substr(cut));
+    ASSERT_EQ(getStatusCode(response), "200");
+    json parsed = json::parse(getBody(response));
+    EXPECT_EQ(parsed["request_id"], 1);
+    EXPECT_EQ(parsed["count_urls"], 25);
+    json results = json::parse(getBody(sendHttpRequest("GET", "/get_results/1?wait=5000")));
+    EXPECT_EQ(results["urls"].size(), 25);
+    EXPECT_EQ(db->requestContent(1), body);
+}
+
+TEST_F(HttpIngestTest, AnswersBrokenBodyWithItsRequestId) {
+    const std::string body = json{{"urls", urlList(10)}}.dump();
+    const std::string broken = body.substr(0, body.size() - 2) + ",]}";
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+
+    postPart(socket, broken.size(), broken.substr(0, body.size() - 2), 10);
+    const std::string response = postRest(socket, broken.substr(body.size() - 2));
+
+    EXPECT_EQ(getStatusCode(response), "400");
+    EXPECT_EQ(json::parse(getBody(response))["request_id"], 1);
+    EXPECT_TRUE(url_parser->isComplete(1));
+}
+
+TEST_F(HttpIngestTest, RejectsBodiesOverTheLimit) {
+    const std::string body = json{{"urls", urlList(200)}}.dump();
+    ASSERT_GT(body.size(), 4096);
+
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/check_urls", body)), "413");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/schedules", body)), "413");
+    EXPECT_FALSE(db->requestIdExists(1));
+}
+
+TEST_F(HttpIngestTest, RejectsTooManyUrlsHoweverTheBodyArrives) {
+    url_parser->admission()->setLimits(AdmissionLimits{15, 0, 0});
+    const std::string body = json{{"urls", urlList(25)}}.dump();
+
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/check_urls", body)), "413");
+    EXPECT_FALSE(db->requestIdExists(1));
+
+    // In pieces, the chunk that takes the request over the limit is refused.
+    const size_t cut = body.find("http://localhost/12");
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+    postPart(socket, body.size(), body.substr(0, cut), 10);
+    const std::string response = postRest(socket, body.substr(cut));
+
+    EXPECT_EQ(getStatusCode(response), "413");
+    EXPECT_EQ(json::parse(getBody(response))["request_id"], 1);
+    EXPECT_EQ(db->find(1).size(), 10);
+}
+
+class HttpScheduleTest : public HttpServerTest {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_http_schedule.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path);
+        auto http_client_factory = [](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+            return std::make_unique<TestHttpClient>();
+        };
+        auto urlParser = std::make_shared<UrlParser>(1, 1, db, http_client_factory);
+        scheduler = std::make_shared<MonitorScheduler>(
+            std::make_shared<ScheduleStore>(test_db_path),
+            [urlParser](int requestId, const std::vector<std::string>& urls) { urlParser->addUrls(requestId, urls); },
+            std::chrono::milliseconds(10), 0);
+        port = 8891;
+        io_context = std::make_unique<boost::asio::io_context>();
+        server = std::make_unique<HttpServer>(*io_context, port, db, urlParser, HttpServerConfig{}, scheduler);
+        server_thread = std::thread([this]() {
+            io_context->run();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    void TearDown() override {
+        HttpServerTest::TearDown();
+        scheduler.reset();
+    }
+
+    std::shared_ptr<MonitorScheduler> scheduler;
+};
+
+TEST_F(HttpScheduleTest, ChecksScheduledUrlsRepeatedly) {
+    json requestBody = {{"urls", {{{"url", "http://localhost/1"}, {"interval", 1}}}}};
+    json response = json::parse(getBody(sendHttpRequest("POST", "/schedules", requestBody.dump())));
+    ASSERT_EQ(response["status"], "OK");
+    const int requestId = response["request_id"];
+    const std::string path = "/get_results/" + std::to_string(requestId);
+
+    // Waits for the second run, a second after the first.
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + std::chrono::seconds(10);
+    while (db->find(requestId).size() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(900));
+    json results = json::parse(getBody(sendHttpRequest("GET", path)));
+    EXPECT_GE(results["urls"].size(), 2);
+    EXPECT_EQ(server->resultCache()->size(), 0);
+
+    EXPECT_EQ(getStatusCode(sendHttpRequest("DELETE", "/schedules/" + std::to_string(requestId))), "200");
+    EXPECT_EQ(getStatusCode(sendHttpRequest("DELETE", "/schedules/" + std::to_string(requestId))), "404");
+    EXPECT_EQ(scheduler->size(), 0);
+}
+
+TEST_F(HttpScheduleTest, RejectsBadInterval) {
+    json requestBody = {{"urls", {{{"url", "http://localhost/1"}, {"interval", 0}}}}};
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/schedules", requestBody.dump())), "400");
+    requestBody = {{"urls", {{{"url", "http://localhost/1"}}}}};
+    EXPECT_EQ(getStatusCode(sendHttpRequest("POST", "/schedules", requestBody.dump())), "400");
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "latency_sketch.h"
+
+TEST(LatencySketchTest, BucketsBoundTheRelativeError) {
+    for (uint64_t value : {0ULL, 7ULL, 15ULL, 16ULL, 17ULL, 1000ULL, 123456ULL, 30000000ULL}) {
+        const uint16_t bucket = LatencySketch::bucketOf(value);
+        EXPECT_LE(LatencySketch::bucketLow(bucket), value);
+        EXPECT_GE(LatencySketch::bucketHigh(bucket), value);
+        EXPECT_LE(LatencySketch::bucketHigh(bucket) - LatencySketch::bucketLow(bucket), value / 16);
+    }
+}
+
+TEST(LatencySketchTest, QuantilesOfMergedSketches) {
+    LatencySketch fast;
+    LatencySketch slow;
+    for (uint64_t i = 1; i <= 90; i++) {
+        fast.add(10000 + i);
+    }
+    for (uint64_t i = 1; i <= 10; i++) {
+        slow.add(500000 + i);
+    }
+    fast.merge(slow);
+    EXPECT_EQ(fast.count(), 100);
+    EXPECT_NEAR(static_cast<double>(fast.quantile(0.5)), 10045.0, 10045.0 / 32);
+    EXPECT_NEAR(static_cast<double>(fast.quantile(0.95)), 500005.0, 500005.0 / 32);
+    EXPECT_EQ(LatencySketch().quantile(0.5), 0);
+}
+
+TEST(LatencySketchTest, ReadsWhatItWrites) {
+    LatencySketch sketch;
+    sketch.add(100, 3);
+    sketch.add(250000);
+    std::string data;
+    sketch.write(data);
+
+    LatencySketch restored;
+    std::string_view view = data;
+    ASSERT_TRUE(restored.read(view));
+    EXPECT_TRUE(view.empty());
+    EXPECT_EQ(restored.count(), 4);
+    EXPECT_EQ(restored.quantile(0.99), sketch.quantile(0.99));
+
+    std::string_view truncated = std::string_view(data).substr(0, data.size() - 1);
+    EXPECT_FALSE(restored.read(truncated));
+}
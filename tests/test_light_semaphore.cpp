@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "light_semaphore.h"
+
+using namespace std::chrono_literals;
+
+TEST(LightSemaphoreTest, CountsPermits) {
+    LightSemaphore semaphore;
+    EXPECT_FALSE(semaphore.tryAcquire());
+    semaphore.release(2);
+    EXPECT_TRUE(semaphore.tryAcquire());
+    EXPECT_TRUE(semaphore.tryAcquireUntil(std::chrono::steady_clock::now()));
+    EXPECT_FALSE(semaphore.tryAcquire());
+    EXPECT_FALSE(semaphore.tryAcquireUntil(std::chrono::steady_clock::now() + 10ms));
+}
+
+TEST(LightSemaphoreTest, WakesSleepingWaiter) {
+    LightSemaphore semaphore;
+    std::thread waiter([&] { semaphore.acquire(); });
+    std::this_thread::sleep_for(20ms);
+    semaphore.release();
+    waiter.join();
+    EXPECT_FALSE(semaphore.tryAcquire());
+}
+
+// Consumers take a fixed share of the permits producers release in bursts
+// of one to three, mostly while some consumers are going to sleep. A lost
+// permit or wakeup leaves a consumer short when its deadline passes; a
+// doubled one is left over at the end.
+TEST(LightSemaphoreTest, NeitherLosesNorDoublesPermitsUnderContention) {
+    constexpr size_t kProducers = 4;
+    constexpr size_t kConsumers = 8;
+    constexpr size_t kPerProducer = 30000;
+    constexpr size_t kPerConsumer = kProducers * kPerProducer / kConsumers;
+    LightSemaphore semaphore;
+    std::atomic<size_t> acquired = 0;
+    std::atomic<size_t> timedOut = 0;
+    const auto deadline = std::chrono::steady_clock::now() + 30s;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kConsumers; i++) {
+        threads.emplace_back([&, i] {
+            for (size_t taken = 0; taken < kPerConsumer; taken++) {
+                // Half of them sleep on the condition variable whenever
+                // they run dry, half spin on the fast path first.
+                if (i % 2 == 0) {
+                    if (!semaphore.tryAcquireUntil(deadline)) {
+                        timedOut++;
+                        return;
+                    }
+                } else {
+                    while (!semaphore.tryAcquire()) {
+                        if (std::chrono::steady_clock::now() > deadline) {
+                            timedOut++;
+                            return;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+                acquired++;
+            }
+        });
+    }
+    for (size_t i = 0; i < kProducers; i++) {
+        threads.emplace_back([&, i] {
+            size_t released = 0;
+            while (released < kPerProducer) {
+                const size_t burst = std::min<size_t>(1 + (released + i) % 3, kPerProducer - released);
+                semaphore.release(burst);
+                released += burst;
+                if (released % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(timedOut, 0);
+    EXPECT_EQ(acquired, kProducers * kPerProducer);
+    EXPECT_FALSE(semaphore.tryAcquire());
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log_db.h"
+
+class LogDbTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        std::filesystem::remove_all(test_dir);
+    }
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir);
+    }
+    // Alternates the rows of the requests, as results of concurrent
+    // requests arrive.
+    static std::vector<Url> rows(const std::vector<int>& requests, size_t perRequest) {
+        std::vector<Url> urls;
+        for (size_t i = 0; i < perRequest; i++) {
+            for (int requestId : requests) {
+                PhaseTimings timings{100, 1000 * static_cast<long long>(i + 1), 0, 0, 0, 5000};
+                urls.push_back(Url{requestId, "http://host" + std::to_string(requestId) + "/" + std::to_string(i),
+                                   200, static_cast<int>(i), "", 0, timings});
+            }
+        }
+        return urls;
+    }
+    static void expectRows(const std::vector<Url>& urls, int requestId, size_t count) {
+        ASSERT_EQ(urls.size(), count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(urls[i].request_id, requestId);
+            EXPECT_EQ(urls[i].url, "http://host" + std::to_string(requestId) + "/" + std::to_string(i));
+            EXPECT_EQ(urls[i].response_time, static_cast<int>(i));
+            EXPECT_EQ(urls[i].timings.connect_us, 1000 * static_cast<long long>(i + 1));
+            EXPECT_FALSE(urls[i].created_at.empty());
+            if (i > 0) {
+                EXPECT_GT(urls[i].id, urls[i - 1].id);
+            }
+        }
+    }
+
+    std::string test_dir = "test_log_db";
+};
+
+TEST_F(LogDbTest, InsertAndFind) {
+    LogDb db(test_dir);
+    const int first = static_cast<int>(db.getRequestId("{}"));
+    const int second = static_cast<int>(db.getRequestId("{}"));
+    EXPECT_EQ(second, first + 1);
+    ASSERT_TRUE(db.insert(rows({first, second}, 5)));
+    ASSERT_TRUE(db.insert(Url{first, "http://host" + std::to_string(first) + "/5", 200, 5, "", 0,
+                              PhaseTimings{100, 6000, 0, 0, 0, 5000}}));
+
+    expectRows(db.find(first), first, 6);
+    expectRows(db.find(second), second, 5);
+    EXPECT_TRUE(db.find(9999).empty());
+    EXPECT_TRUE(db.requestIdExists(second));
+    EXPECT_FALSE(db.requestIdExists(second + 1));
+    EXPECT_EQ(db.lastRequestId(), second);
+
+    auto all = db.find(first);
+    auto page = db.find(first, all[1].id, 2);
+    ASSERT_EQ(page.size(), 2);
+    EXPECT_EQ(page[0].id, all[2].id);
+    EXPECT_EQ(page[1].id, all[3].id);
+
+    ResultFilter filter;
+    filter.min_us[1] = 3000;
+    filter.max_us[1] = 4000;
+    auto filtered = db.find(first, 0, 100, filter);
+    ASSERT_EQ(filtered.size(), 2);
+    EXPECT_EQ(filtered[0].timings.connect_us, 3000);
+}
+
+TEST_F(LogDbTest, RotatesAndCompactsSegments) {
+    LogDbConfig config;
+    config.segment_bytes = 4096;
+    config.compact_segments = 0;
+    LogDb db(test_dir, config);
+    std::vector<int> requests;
+    for (int i = 0; i < 4; i++) {
+        requests.push_back(static_cast<int>(db.getRequestId("{}")));
+    }
+    for (size_t batch = 0; batch < 10; batch++) {
+        auto urls = rows(requests, 10);
+        for (auto& url : urls) {
+            url.url = "http://host" + std::to_string(url.request_id) + "/" + std::to_string(batch * 10 + static_cast<size_t>(url.response_time));
+            url.response_time = static_cast<int>(batch * 10) + url.response_time;
+            url.timings.connect_us = 1000 * (url.response_time + 1);
+        }
+        ASSERT_TRUE(db.insert(urls));
+    }
+    const size_t before = db.segmentCount();
+    EXPECT_GT(before, 10);
+
+    EXPECT_TRUE(db.compact());
+    EXPECT_FALSE(db.compact());
+    EXPECT_LE(db.segmentCount(), before);
+    for (int requestId : requests) {
+        expectRows(db.find(requestId), requestId, 100);
+    }
+    ASSERT_TRUE(db.insert(rows({requests[0]}, 1)));
+    EXPECT_EQ(db.find(requests[0]).size(), 101);
+
+    Url tooLong{requests[0], std::string(8192, 'x')};
+    EXPECT_FALSE(db.insert(tooLong));
+}
+
+TEST_F(LogDbTest, RefusesRowsWhenASegmentCannotBeCreated) {
+    LogDbConfig config;
+    config.segment_bytes = 4096;
+    config.compact_segments = 0;
+    std::filesystem::path blocked;
+    int requestId = 0;
+    {
+        LogDb db(test_dir, config);
+        requestId = static_cast<int>(db.getRequestId("{}"));
+        // The file of the next segment cannot be created where a directory
+        // takes its name.
+        unsigned long long last = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(test_dir)) {
+            const std::string name = entry.path().filename().string();
+            if (name.starts_with("results-")) {
+                last = std::max(last, std::stoull(name.substr(8, 12)));
+            }
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "results-%012llu.seg", last + 1);
+        blocked = std::filesystem::path(test_dir) / name;
+        std::filesystem::create_directory(blocked);
+
+        EXPECT_FALSE(db.insert(rows({requestId}, 100)));
+        EXPECT_TRUE(db.find(requestId).empty());
+        ASSERT_TRUE(db.insert(rows({requestId}, 100)));
+        expectRows(db.find(requestId), requestId, 100);
+    }
+    std::filesystem::remove(blocked);
+    LogDb db(test_dir, config);
+    expectRows(db.find(requestId), requestId, 100);
+}
+
+TEST_F(LogDbTest, ReopensWhatWasWritten) {
+    LogDbConfig config;
+    config.segment_bytes = 4096;
+    config.compress_content = true;
+    const std::string content = R"({"urls": [)" + std::string(500, ' ') + "]}";
+    int requestId = 0;
+    int replaced = 0;
+    int removed = 0;
+    long long lastId = 0;
+    {
+        LogDb db(test_dir, config);
+        requestId = static_cast<int>(db.getRequestId(content));
+        replaced = static_cast<int>(db.getRequestId(""));
+        ASSERT_TRUE(db.setRequestContent(replaced, "{}"));
+        EXPECT_FALSE(db.setRequestContent(replaced + 1, "{}"));
+        removed = static_cast<int>(db.getRequestId("{}"));
+        ASSERT_TRUE(db.removeRequest(removed));
+        EXPECT_FALSE(db.removeRequest(removed));
+        EXPECT_FALSE(db.setRequestContent(removed, "{}"));
+        ASSERT_TRUE(db.insert(rows({requestId}, 50)));
+        lastId = db.find(requestId).back().id;
+    }
+    // What a crash leaves past the last whole record is dropped.
+    for (const auto& entry : std::filesystem::directory_iterator(test_dir)) {
+        std::ofstream(entry.path(), std::ios::app | std::ios::binary) << "torn";
+    }
+    LogDb db(test_dir, config);
+    expectRows(db.find(requestId), requestId, 50);
+    EXPECT_TRUE(db.requestIdExists(requestId));
+    EXPECT_EQ(db.requestContent(requestId), content);
+    EXPECT_EQ(db.requestContent(replaced), "{}");
+    EXPECT_FALSE(db.requestIdExists(removed));
+    EXPECT_FALSE(db.requestContent(removed));
+    EXPECT_EQ(static_cast<int>(db.getRequestId("{}")), removed + 1);
+    ASSERT_TRUE(db.insert(Url{requestId, "http://host/after"}));
+    EXPECT_GT(db.find(requestId).back().id, lastId);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+
+TEST(MetricsTest, SumsCounterShards) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < 1000; j++) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    counter.add(5);
+    EXPECT_EQ(counter.value(), 8005);
+}
+
+TEST(MetricsTest, CountsHistogramBuckets) {
+    Histogram histogram{10, 100};
+    histogram.observe(uint64_t{10});
+    histogram.observe(uint64_t{11});
+    histogram.observe(uint64_t{1000});
+
+    auto snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.cumulative.size(), 3);
+    EXPECT_EQ(snapshot.cumulative[0], 1);
+    EXPECT_EQ(snapshot.cumulative[1], 2);
+    EXPECT_EQ(snapshot.cumulative[2], 3);
+    EXPECT_EQ(snapshot.sum, 1021);
+}
+
+TEST(MetricsTest, WritesExpositionFormat) {
+    Histogram histogram{500000};
+    histogram.observe(uint64_t{250000});
+    MetricsWriter writer;
+    writer.counter("test_total", "Test counter.", 3);
+    writer.histogram("test_seconds", "Test histogram.", histogram.snapshot());
+
+    EXPECT_EQ(writer.text(),
+              "# HELP test_total Test counter.\n"
+              "# TYPE test_total counter\n"
+              "test_total 3\n"
+              "# HELP test_seconds Test histogram.\n"
+              "# TYPE test_seconds histogram\n"
+              "test_seconds_bucket{le=\"0.5\"} 1\n"
+              "test_seconds_bucket{le=\"+Inf\"} 1\n"
+              "test_seconds_sum 0.25\n"
+              "test_seconds_count 1\n");
+}
+
+TEST(MetricsTest, WritesCountHistogramAsItIs) {
+    Histogram histogram{10};
+    histogram.observe(uint64_t{4});
+    histogram.observe(uint64_t{20});
+    MetricsWriter writer;
+    writer.countHistogram("test_rows", "Test histogram.", histogram.snapshot());
+
+    EXPECT_EQ(writer.text(),
+              "# HELP test_rows Test histogram.\n"
+              "# TYPE test_rows histogram\n"
+              "test_rows_bucket{le=\"10\"} 1\n"
+              "test_rows_bucket{le=\"+Inf\"} 2\n"
+              "test_rows_sum 24\n"
+              "test_rows_count 2\n");
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "monitor_scheduler.h"
+#include "schedule_store.h"
+
+using namespace std::chrono_literals;
+
+class MonitorSchedulerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        std::filesystem::remove(test_db_path);
+    }
+    void TearDown() override {
+        std::filesystem::remove(test_db_path);
+    }
+
+    MonitorScheduler::Dispatch recorder() {
+        return [this](int requestId, const std::vector<std::string>& urls) {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (const auto& url : urls) {
+                runs[std::to_string(requestId) + ":" + url]++;
+            }
+            ran.notify_all();
+        };
+    }
+    int runsOf(int requestId, const std::string& url) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return runs[std::to_string(requestId) + ":" + url];
+    }
+    // False if the URL did not run that many times within a few seconds.
+    bool waitForRuns(int requestId, const std::string& url, int count) {
+        std::unique_lock lock(mtx);
+        return ran.wait_for(lock, 5s, [&] { return runs[std::to_string(requestId) + ":" + url] >= count; });
+    }
+
+    std::string test_db_path = "test_schedules.db";
+    std::mutex mtx;
+    std::condition_variable ran;
+    std::map<std::string, int> runs;
+};
+
+// Without jitter the first run is due at once and the nth one an interval
+// later each time, never sooner, however late the thread gets to them.
+TEST_F(MonitorSchedulerTest, RunsEveryInterval) {
+    const auto started = std::chrono::steady_clock::now();
+    MonitorScheduler scheduler(nullptr, recorder(), 5ms, 0);
+    ASSERT_TRUE(scheduler.add(1, {{"http://localhost/fast", 20ms}, {"http://localhost/slow", 1h}}));
+    EXPECT_TRUE(scheduler.isScheduled(1));
+    EXPECT_EQ(scheduler.size(), 2);
+
+    ASSERT_TRUE(waitForRuns(1, "http://localhost/fast", 3));
+    EXPECT_GE(std::chrono::steady_clock::now() - started, 40ms);
+    EXPECT_EQ(runsOf(1, "http://localhost/slow"), 1);
+
+    EXPECT_EQ(scheduler.remove(1), 2);
+    EXPECT_FALSE(scheduler.isScheduled(1));
+    const int afterRemove = runsOf(1, "http://localhost/fast");
+    std::this_thread::sleep_for(60ms);
+    EXPECT_EQ(runsOf(1, "http://localhost/fast"), afterRemove);
+}
+
+TEST_F(MonitorSchedulerTest, RestoresPersistedSchedules) {
+    {
+        MonitorScheduler scheduler(std::make_shared<ScheduleStore>(test_db_path), [](int, const std::vector<std::string>&) {});
+        ASSERT_TRUE(scheduler.add(1, {{"http://localhost/1", 1h}, {"http://localhost/2", 1h}}));
+        ASSERT_TRUE(scheduler.add(2, {{"http://localhost/3", 1h}}));
+        EXPECT_EQ(scheduler.remove(2), 1);
+    }
+    auto store = std::make_shared<ScheduleStore>(test_db_path);
+    auto schedules = store->load();
+    ASSERT_EQ(schedules.size(), 2);
+    EXPECT_EQ(schedules[0].request_id, 1);
+    EXPECT_EQ(schedules[0].url, "http://localhost/1");
+    EXPECT_EQ(schedules[0].interval, 1h);
+
+    MonitorScheduler restored(store, recorder(), 5ms, 0);
+    EXPECT_TRUE(restored.isScheduled(1));
+    EXPECT_FALSE(restored.isScheduled(2));
+    EXPECT_TRUE(waitForRuns(1, "http://localhost/2", 1));
+}
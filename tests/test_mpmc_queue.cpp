@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "mpmc_queue.h"
+
+TEST(MpmcQueueTest, KeepsOrderWithinCapacity) {
+    MpmcQueue<int> queue(3);
+    EXPECT_EQ(queue.capacity(), 4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.tryPush(int{i}));
+    }
+    EXPECT_FALSE(queue.tryPush(4));
+    EXPECT_EQ(queue.sizeApprox(), 4);
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+    // Positions wrap around the ring.
+    EXPECT_TRUE(queue.tryPush(5));
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(value, 5);
+}
+
+// Every value pushed through a small ring by several producers comes out
+// exactly once across several consumers.
+TEST(MpmcQueueTest, HandsEveryValueToOneConsumer) {
+    constexpr size_t kProducers = 4;
+    constexpr size_t kConsumers = 4;
+    constexpr size_t kPerProducer = 50000;
+    constexpr size_t kTotal = kProducers * kPerProducer;
+    MpmcQueue<size_t> queue(64);
+    std::vector<std::atomic<int>> seen(kTotal);
+    std::atomic<size_t> popped = 0;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kProducers; i++) {
+        threads.emplace_back([&, i] {
+            for (size_t n = 0; n < kPerProducer; n++) {
+                size_t value = i * kPerProducer + n;
+                while (!queue.tryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < kConsumers; i++) {
+        threads.emplace_back([&] {
+            size_t value = 0;
+            while (popped.load() < kTotal) {
+                if (queue.tryPop(value)) {
+                    seen[value]++;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t once = 0;
+    for (const auto& count : seen) {
+        once += count.load() == 1 ? 1 : 0;
+    }
+    EXPECT_EQ(once, kTotal);
+    EXPECT_EQ(popped, kTotal);
+    size_t value = 0;
+    EXPECT_FALSE(queue.tryPop(value));
+}
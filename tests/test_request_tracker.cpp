@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "request_tracker.h"
+
+TEST(RequestTrackerTest, CountsProgress) {
+    RequestTracker tracker;
+    EXPECT_TRUE(tracker.isComplete(1));
+    tracker.add(1, 2);
+    EXPECT_FALSE(tracker.isComplete(1));
+
+    tracker.started(1);
+    tracker.started(1);
+    tracker.finished(Url{1, "http://localhost/1", 200, 10});
+    auto progress = tracker.progress(1);
+    ASSERT_TRUE(progress);
+    EXPECT_EQ(progress->total, 2);
+    EXPECT_EQ(progress->done, 1);
+    EXPECT_EQ(progress->in_flight, 1);
+
+    tracker.finished(Url{1, "http://localhost/2", 200, 10});
+    EXPECT_TRUE(tracker.isComplete(1));
+    EXPECT_FALSE(tracker.progress(1));
+}
+
+TEST(RequestTrackerTest, NotifiesListeners) {
+    RequestTracker tracker;
+    EXPECT_EQ(tracker.listen(1, [](const RequestTracker::Event&) {}), 0);
+
+    tracker.add(1, 2);
+    std::vector<std::string> events;
+    bool complete = false;
+    const size_t id = tracker.listen(1, [&](const RequestTracker::Event& event) {
+        events.push_back(event.result ? event.result->url : "snapshot");
+        complete = event.complete;
+    });
+    ASSERT_NE(id, 0);
+    size_t removed_calls = 0;
+    const size_t removed = tracker.listen(1, [&](const RequestTracker::Event&) {
+        removed_calls++;
+    });
+    tracker.unlisten(1, removed);
+
+    tracker.finished(Url{1, "http://localhost/1", 200, 10});
+    EXPECT_FALSE(complete);
+    tracker.finished(Url{1, "http://localhost/2", 200, 10});
+    EXPECT_TRUE(complete);
+    EXPECT_EQ(removed_calls, 1);
+    EXPECT_EQ(events, (std::vector<std::string>{"snapshot", "http://localhost/1", "http://localhost/2"}));
+}
+
+TEST(RequestTrackerTest, CompletesOpenRequestOnlyOnceClosed) {
+    RequestTracker tracker;
+    tracker.open(1);
+    tracker.add(1, 1);
+    bool complete = false;
+    ASSERT_NE(tracker.listen(1, [&](const RequestTracker::Event& event) { complete = event.complete; }), 0);
+
+    tracker.finished(Url{1, "http://localhost/1", 200, 10});
+    EXPECT_FALSE(complete);
+    EXPECT_FALSE(tracker.isComplete(1));
+
+    tracker.add(1, 1);
+    tracker.close(1);
+    EXPECT_FALSE(tracker.isComplete(1));
+    tracker.finished(Url{1, "http://localhost/2", 200, 10});
+    EXPECT_TRUE(complete);
+    EXPECT_TRUE(tracker.isComplete(1));
+
+    // Closing with every URL done completes at once.
+    tracker.open(2);
+    EXPECT_FALSE(tracker.isComplete(2));
+    tracker.close(2);
+    EXPECT_TRUE(tracker.isComplete(2));
+}
+
+TEST(RequestTrackerTest, TakesNoIdBeingCreatedForComplete) {
+    RequestTracker tracker;
+    tracker.add(3, 1);
+    tracker.finished(Url{3, "http://localhost/1", 200, 10});
+    {
+        RequestTracker::Creation creation(tracker);
+        // The new request is above every id seen so far; those keep their
+        // state.
+        auto progress = tracker.progress(4);
+        ASSERT_TRUE(progress);
+        EXPECT_EQ(progress->total, 0);
+        EXPECT_FALSE(tracker.isComplete(4));
+        EXPECT_EQ(tracker.listen(4, [](const RequestTracker::Event&) {}), 0);
+        EXPECT_TRUE(tracker.isComplete(3));
+
+        tracker.open(4);
+        tracker.add(4, 1);
+    }
+    EXPECT_EQ(tracker.progress(4)->total, 1);
+    EXPECT_TRUE(tracker.isComplete(5));
+    EXPECT_FALSE(tracker.progress(5));
+}
+
+TEST(RequestTrackerTest, TakesIdsStoredBeforeTheStartForComplete) {
+    RequestTracker tracker;
+    tracker.seed(7);
+    RequestTracker::Creation creation(tracker);
+    EXPECT_TRUE(tracker.isComplete(7));
+    EXPECT_FALSE(tracker.progress(7));
+    EXPECT_FALSE(tracker.isComplete(8));
+}
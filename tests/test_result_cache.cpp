@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "result_cache.h"
+
+TEST(ResultCacheTest, CountsHitsAndMisses) {
+    ResultCache cache(1024);
+    EXPECT_EQ(cache.get(1), nullptr);
+    cache.put(1, "body");
+    auto body = cache.get(1);
+    ASSERT_NE(body, nullptr);
+    EXPECT_EQ(*body, "body");
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+
+    cache.erase(1);
+    EXPECT_EQ(cache.get(1), nullptr);
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.bytes(), 0);
+}
+
+TEST(ResultCacheTest, EvictsLeastRecentlyUsedOverBudget) {
+    // Room for two 200-byte bodies with their bookkeeping, not three.
+    ResultCache cache(700);
+    cache.put(1, std::string(200, 'a'));
+    cache.put(2, std::string(200, 'b'));
+    ASSERT_NE(cache.get(1), nullptr);
+    cache.put(3, std::string(200, 'c'));
+
+    EXPECT_NE(cache.get(1), nullptr);
+    EXPECT_EQ(cache.get(2), nullptr);
+    EXPECT_NE(cache.get(3), nullptr);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_LE(cache.bytes(), 700);
+}
+
+TEST(ResultCacheTest, SkipsBodiesOverBudget) {
+    ResultCache cache(100);
+    cache.put(1, std::string(200, 'a'));
+    EXPECT_EQ(cache.get(1), nullptr);
+    EXPECT_EQ(cache.bytes(), 0);
+}
+
+TEST(ResultCacheTest, KeepsVariantsApart) {
+    ResultCache cache(1024);
+    cache.put(1, "body");
+    cache.put(1, "gzip", 1);
+    EXPECT_EQ(*cache.get(1), "body");
+    EXPECT_EQ(*cache.get(1, 1), "gzip");
+    EXPECT_EQ(cache.get(1, 2), nullptr);
+    EXPECT_EQ(cache.size(), 2);
+
+    cache.erase(1);
+    EXPECT_EQ(cache.get(1, 1), nullptr);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ResultCacheTest, FallsBackToPlainBodyAsOneLookup) {
+    ResultCache cache(1024);
+    cache.put(1, "body");
+    cache.put(2, "body");
+    cache.put(2, "gzip", 1);
+
+    auto found = cache.getOrPlain(1, 1);
+    ASSERT_NE(found.body, nullptr);
+    EXPECT_EQ(*found.body, "body");
+    EXPECT_EQ(found.variant, 0);
+    found = cache.getOrPlain(2, 1);
+    ASSERT_NE(found.body, nullptr);
+    EXPECT_EQ(*found.body, "gzip");
+    EXPECT_EQ(found.variant, 1);
+    EXPECT_EQ(cache.getOrPlain(3, 1).body, nullptr);
+
+    EXPECT_EQ(cache.hits(), 2);
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(ResultCacheTest, ErasesRequestsBelowAnId) {
+    ResultCache cache(1024);
+    cache.put(1, "one");
+    cache.put(2, "two", 1);
+    cache.put(3, "three");
+    cache.eraseBefore(3);
+    EXPECT_EQ(cache.get(1), nullptr);
+    EXPECT_EQ(cache.get(2, 1), nullptr);
+    EXPECT_NE(cache.get(3), nullptr);
+    EXPECT_EQ(cache.size(), 1);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "schedule_store.h"
+#include "sharded_sqlite_db.h"
+
+using namespace std::chrono_literals;
+
+class ShardedSqliteDbTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        deleteTestDb();
+    }
+    void TearDown() override {
+        deleteTestDb();
+    }
+    // The catalog and every shard file next to it.
+    void deleteTestDb() {
+        for (const auto& entry : std::filesystem::directory_iterator(".")) {
+            if (entry.path().filename().string().rfind(test_db_path, 0) == 0) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+    int addRequest(ShardedSqliteDb& db, size_t results) {
+        const int requestId = static_cast<int>(db.getRequestId("{}"));
+        std::vector<Url> urls;
+        for (size_t i = 0; i < results; i++) {
+            urls.push_back(Url{requestId, "http://localhost/" + std::to_string(i), i == 0 ? 500 : 200, 10});
+        }
+        EXPECT_TRUE(db.insert(urls));
+        return requestId;
+    }
+
+    std::string test_db_path = "test_sharded.db";
+    ShardingConfig config{3, std::chrono::hours(1), 0, 1, false};
+};
+
+TEST_F(ShardedSqliteDbTest, RoutesRequestsToShards) {
+    ShardedSqliteDb db(test_db_path, config);
+    std::vector<int> requests;
+    for (size_t i = 1; i <= 6; i++) {
+        requests.push_back(addRequest(db, i));
+    }
+    for (size_t i = 0; i < requests.size(); i++) {
+        auto urls = db.find(requests[i]);
+        ASSERT_EQ(urls.size(), i + 1);
+        EXPECT_EQ(urls.back().request_id, requests[i]);
+        EXPECT_EQ(db.find(requests[i], urls.front().id, 100).size(), i);
+    }
+    EXPECT_TRUE(db.requestIdExists(requests[0]));
+    EXPECT_FALSE(db.requestIdExists(9999));
+    EXPECT_TRUE(db.find(9999).empty());
+
+    const int64_t partition = std::chrono::duration_cast<std::chrono::seconds>(
+                                  ShardedSqliteDb::Clock::now().time_since_epoch()) / config.partition;
+    for (size_t shard = 0; shard < config.shards; shard++) {
+        EXPECT_TRUE(std::filesystem::exists(db.shardPath(partition, shard)));
+    }
+
+    auto totals = db.totals();
+    ASSERT_TRUE(totals);
+    EXPECT_EQ(totals->results, 21);
+    EXPECT_EQ(totals->successes, 15);
+    EXPECT_EQ(totals->response_time_ms, 210);
+}
+
+TEST_F(ShardedSqliteDbTest, DropsPartitionsBeyondRetention) {
+    config.retained_partitions = 2;
+    ShardedSqliteDb db(test_db_path, config);
+    int firstKept = 0;
+    db.onDrop([&firstKept](int firstKeptId) { firstKept = firstKeptId; });
+    const auto now = ShardedSqliteDb::Clock::now();
+    const int64_t first = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()) / config.partition;
+    const int oldest = addRequest(db, 2);
+    ASSERT_TRUE(db.startPartition(now + 1h));
+    const int middle = addRequest(db, 2);
+    EXPECT_FALSE(db.startPartition(now + 1h));
+    ASSERT_TRUE(db.startPartition(now + 2h));
+    const int latest = addRequest(db, 2);
+
+    EXPECT_EQ(db.partitionCount(), 2);
+    EXPECT_EQ(firstKept, middle);
+    EXPECT_FALSE(db.requestIdExists(oldest));
+    EXPECT_TRUE(db.find(oldest).empty());
+    EXPECT_FALSE(std::filesystem::exists(db.shardPath(first, static_cast<size_t>(oldest) % config.shards)));
+    EXPECT_EQ(db.find(middle).size(), 2);
+    EXPECT_EQ(db.find(latest).size(), 2);
+    // Late results of a dropped request are discarded.
+    EXPECT_TRUE(db.insert(Url{oldest, "http://localhost/late", 200, 10}));
+    EXPECT_TRUE(db.find(oldest).empty());
+    EXPECT_EQ(db.totals()->results, 4);
+}
+
+TEST_F(ShardedSqliteDbTest, KeepsPartitionsOfScheduledRequests) {
+    config.retained_partitions = 1;
+    ShardedSqliteDb db(test_db_path, config);
+    ScheduleStore store(test_db_path);
+    const auto now = ShardedSqliteDb::Clock::now();
+    const int scheduled = addRequest(db, 2);
+    std::vector<Schedule> schedules{Schedule{0, scheduled, "http://localhost/", 1min}};
+    ASSERT_TRUE(store.add(schedules));
+
+    ASSERT_TRUE(db.startPartition(now + 1h));
+    const int later = addRequest(db, 2);
+    EXPECT_EQ(db.partitionCount(), 2);
+    EXPECT_TRUE(db.requestIdExists(scheduled));
+    EXPECT_TRUE(db.insert(Url{scheduled, "http://localhost/next", 200, 10}));
+    EXPECT_EQ(db.find(scheduled).size(), 3);
+
+    ASSERT_TRUE(store.remove(scheduled));
+    ASSERT_TRUE(db.startPartition(now + 2h));
+    EXPECT_EQ(db.partitionCount(), 1);
+    EXPECT_FALSE(db.requestIdExists(scheduled));
+    EXPECT_FALSE(db.requestIdExists(later));
+}
+
+TEST_F(ShardedSqliteDbTest, ReopensWithTheSameLayout) {
+    int requestId = 0;
+    {
+        ShardedSqliteDb db(test_db_path, config);
+        requestId = addRequest(db, 3);
+    }
+    ShardedSqliteDb reopened(test_db_path, config);
+    EXPECT_EQ(reopened.find(requestId).size(), 3);
+    EXPECT_EQ(reopened.partitionCount(), 1);
+
+    ShardingConfig other = config;
+    other.shards = 4;
+    EXPECT_THROW(ShardedSqliteDb(test_db_path, other), std::runtime_error);
+}
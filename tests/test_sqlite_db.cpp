@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "compression.h"
+#include "sqlite_connection.h"
+#include "sqlite_db.h"
+
+class SqliteDbTest : public ::testing::TestWithParam<size_t> {
+   protected:
+    void SetUp() override {
+        test_db_path = "test_sqlite_db.db";
+        deleteTestDb();
+        db = std::make_shared<SqliteDb>(test_db_path, GetParam());
+    }
+
+    void TearDown() override {
+        db.reset();
+        deleteTestDb();
+    }
+    void deleteTestDb() {
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(test_db_path + suffix);
+        }
+    }
+
+    std::string test_db_path;
+    std::shared_ptr<SqliteDb> db;
+};
+
+TEST_P(SqliteDbTest, InsertAndFind) {
+    EXPECT_EQ(db->lastRequestId(), 0);
+    const int requestId = db->getRequestId("{}");
+    ASSERT_GT(requestId, 0);
+    EXPECT_TRUE(db->requestIdExists(requestId));
+    EXPECT_FALSE(db->requestIdExists(requestId + 1));
+    EXPECT_EQ(db->lastRequestId(), requestId);
+
+    EXPECT_TRUE(db->insert(Url{requestId, "http://localhost/1", 200, 10}));
+    EXPECT_TRUE(db->insert({Url{requestId, "http://localhost/2", 404, 20},
+                            Url{requestId, "http://localhost/3", 0, 30}}));
+
+    std::vector<Url> urls = db->find(requestId);
+    ASSERT_EQ(urls.size(), 3);
+    EXPECT_EQ(urls[0].url, "http://localhost/1");
+    EXPECT_EQ(urls[1].http_status, 404);
+    EXPECT_EQ(urls[2].response_time, 30);
+    EXPECT_TRUE(db->find(requestId + 1).empty());
+}
+
+TEST_P(SqliteDbTest, FindPage) {
+    const int requestId = db->getRequestId("{}");
+    std::vector<Url> rows;
+    for (int i = 0; i < 5; i++) {
+        rows.push_back(Url{requestId, "http://localhost/" + std::to_string(i), 200, i});
+    }
+    ASSERT_TRUE(db->insert(rows));
+
+    std::vector<Url> first = db->find(requestId, 0, 2);
+    ASSERT_EQ(first.size(), 2);
+    EXPECT_EQ(first[0].url, "http://localhost/0");
+    EXPECT_LT(first[0].id, first[1].id);
+
+    std::vector<Url> second = db->find(requestId, first.back().id, 2);
+    ASSERT_EQ(second.size(), 2);
+    EXPECT_EQ(second[0].url, "http://localhost/2");
+
+    std::vector<Url> last = db->find(requestId, second.back().id, 2);
+    ASSERT_EQ(last.size(), 1);
+    EXPECT_EQ(last[0].url, "http://localhost/4");
+    EXPECT_TRUE(db->find(requestId, last.back().id, 2).empty());
+}
+
+TEST_P(SqliteDbTest, FiltersPageByPhaseTimings) {
+    const int requestId = db->getRequestId("{}");
+    std::vector<Url> rows;
+    for (int i = 0; i < 4; i++) {
+        PhaseTimings timings{100, 1000 * (i + 1), 0, 1000 * (i + 1) + 10, 5000, 9000 + i};
+        rows.push_back(Url{requestId, "http://localhost/" + std::to_string(i), 200, 9, "", 0, timings});
+    }
+    ASSERT_TRUE(db->insert(rows));
+
+    std::vector<Url> all = db->find(requestId);
+    ASSERT_EQ(all.size(), 4);
+    EXPECT_EQ(all[2].timings.connect_us, 3000);
+    EXPECT_EQ(all[2].timings.pretransfer_us, 3010);
+    EXPECT_EQ(all[3].timings.total_us, 9003);
+
+    ResultFilter filter;
+    filter.min_us[1] = 2000;
+    filter.max_us[1] = 3000;
+    std::vector<Url> slow = db->find(requestId, 0, 10, filter);
+    ASSERT_EQ(slow.size(), 2);
+    EXPECT_EQ(slow[0].url, "http://localhost/1");
+    EXPECT_EQ(slow[1].url, "http://localhost/2");
+    EXPECT_EQ(slow[1].timings.namelookup_us, 100);
+
+    std::vector<Url> page = db->find(requestId, slow[0].id, 10, filter);
+    ASSERT_EQ(page.size(), 1);
+    EXPECT_EQ(page[0].url, "http://localhost/2");
+
+    filter.min_us[5] = 10000;
+    EXPECT_TRUE(db->find(requestId, 0, 10, filter).empty());
+}
+
+TEST_P(SqliteDbTest, ReadsRunAlongsideInserts) {
+    const int requestId = db->getRequestId("{}");
+    std::atomic<bool> done = false;
+    std::thread inserter([&] {
+        for (int i = 0; i < 200; i++) {
+            db->insert(Url{requestId, "http://localhost/" + std::to_string(i), 200, i});
+        }
+        done = true;
+    });
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            size_t last = 0;
+            while (!done) {
+                size_t count = db->find(requestId).size();
+                EXPECT_GE(count, last);
+                last = count;
+            }
+        });
+    }
+    inserter.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(db->find(requestId).size(), 200);
+}
+
+INSTANTIATE_TEST_SUITE_P(ReadConnections, SqliteDbTest, ::testing::Values(0, 2));
+
+class SqliteDbSchemaTest : public ::testing::Test {
+   protected:
+    void SetUp() override { deleteTestDb(); }
+    void TearDown() override { deleteTestDb(); }
+    void deleteTestDb() {
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path + suffix);
+        }
+    }
+    int userVersion() {
+        SqliteConnection connection(path, true);
+        auto stmt = connection.prepare("PRAGMA user_version;");
+        return stmt && sqlite3_step(stmt.get()) == SQLITE_ROW ? sqlite3_column_int(stmt.get(), 0) : -1;
+    }
+
+    const std::string path = "test_sqlite_db_schema.db";
+};
+
+TEST_F(SqliteDbSchemaTest, MigratesVersion0Database) {
+    {
+        SqliteConnection old(path, false);
+        ASSERT_TRUE(old.exec(R"(
+            CREATE TABLE requests (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                content TEXT NOT NULL,
+                created_at DATETIME DEFAULT (datetime('now','localtime'))
+            );
+            CREATE TABLE urls (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                request_id INTEGER NOT NULL,
+                url TEXT NOT NULL,
+                http_status INTEGER NOT NULL,
+                response_time INTEGER NOT NULL,
+                created_at DATETIME DEFAULT (datetime('now','localtime'))
+            );
+            INSERT INTO requests (content) VALUES ('{"urls": []}');
+            INSERT INTO requests (content) VALUES ('{}');
+            INSERT INTO urls (request_id, url, http_status, response_time, created_at)
+            VALUES (2, 'http://localhost/old', 200, 15, '2025-10-15 10:30:45');
+            INSERT INTO urls (request_id, url, http_status, response_time, created_at)
+            VALUES (2, 'http://localhost/old', 500, 16, '2025-10-15 10:30:46');)"));
+    }
+    {
+        SqliteDb db(path, 0);
+        EXPECT_TRUE(db.requestIdExists(2));
+        EXPECT_EQ(db.requestContent(1), R"({"urls": []})");
+        EXPECT_TRUE(db.insert(Url{2, "http://localhost/new", 200, 20, "", 0, PhaseTimings{1, 2, 3, 4, 5, 20000}}));
+        std::vector<Url> urls = db.find(2);
+        ASSERT_EQ(urls.size(), 3);
+        EXPECT_EQ(urls[0].url, "http://localhost/old");
+        EXPECT_EQ(urls[0].created_at, "2025-10-15 10:30:45");
+        EXPECT_EQ(urls[1].http_status, 500);
+        EXPECT_EQ(urls[1].id, 2);
+        EXPECT_EQ(urls[0].timings.total_us, 0);
+        EXPECT_EQ(urls[2].timings.appconnect_us, 3);
+        EXPECT_EQ(urls[2].timings.total_us, 20000);
+        EXPECT_GT(urls[2].id, urls[1].id);
+        EXPECT_EQ(db.getRequestId("{}"), 3);
+    }
+    EXPECT_EQ(userVersion(), 1);
+
+    // Reopening a migrated database leaves it as it is.
+    SqliteDb db(path, 0);
+    EXPECT_EQ(db.find(2).size(), 3);
+}
+
+TEST_F(SqliteDbSchemaTest, RemovesRequestWithoutReusingItsId) {
+    SqliteDb db(path);
+    const int removed = static_cast<int>(db.getRequestId("{}"));
+    ASSERT_TRUE(db.removeRequest(removed));
+    EXPECT_FALSE(db.removeRequest(removed));
+    EXPECT_FALSE(db.requestIdExists(removed));
+    EXPECT_EQ(static_cast<int>(db.getRequestId("{}")), removed + 1);
+}
+
+TEST_F(SqliteDbSchemaTest, CompressesRequestContent) {
+    const std::string content = R"({"urls": [)" + std::string(1000, ' ') + "]}";
+    {
+        SqliteDb db(path, 0, true);
+        const int compressed = static_cast<int>(db.getRequestId(content));
+        const int small = static_cast<int>(db.getRequestId("{}"));
+        EXPECT_EQ(db.requestContent(compressed), content);
+        EXPECT_EQ(db.requestContent(small), "{}");
+        EXPECT_FALSE(db.requestContent(small + 1));
+        // A body set after the request was created is compressed alike.
+        const int replaced = static_cast<int>(db.getRequestId(""));
+        EXPECT_TRUE(db.setRequestContent(replaced, content));
+        EXPECT_EQ(db.requestContent(replaced), content);
+        EXPECT_FALSE(db.setRequestContent(replaced + 1, content));
+        // One deflated already is kept as it is.
+        EXPECT_TRUE(db.setRequestContent(replaced, compress(content), true));
+        EXPECT_EQ(db.requestContent(replaced), content);
+    }
+    SqliteConnection connection(path, true);
+    auto stmt = connection.prepare("SELECT length(content), encoding FROM requests ORDER BY id;");
+    ASSERT_TRUE(stmt);
+    ASSERT_EQ(sqlite3_step(stmt.get()), SQLITE_ROW);
+    EXPECT_LT(sqlite3_column_int(stmt.get(), 0), 100);
+    EXPECT_EQ(sqlite3_column_int(stmt.get(), 1), 1);
+    ASSERT_EQ(sqlite3_step(stmt.get()), SQLITE_ROW);
+    EXPECT_EQ(sqlite3_column_int(stmt.get(), 1), 0);
+    ASSERT_EQ(sqlite3_step(stmt.get()), SQLITE_ROW);
+    EXPECT_EQ(sqlite3_column_int(stmt.get(), 1), 1);
+}
+
+TEST_F(SqliteDbSchemaTest, RefusesNewerSchema) {
+    {
+        SqliteConnection connection(path, false);
+        ASSERT_TRUE(connection.exec("PRAGMA user_version = 99;"));
+    }
+    EXPECT_THROW(SqliteDb(path, 0), std::runtime_error);
+}
+
+TEST_F(SqliteDbSchemaTest, InsertWaitsForWriterOfAnotherConnection) {
+    SqliteDb db(path, 0);
+    SqliteConnection other(path, false);
+    ASSERT_TRUE(other.exec("CREATE TABLE side (x INTEGER);"));
+    const int requestId = static_cast<int>(db.getRequestId("{}"));
+
+    // Another store of the same file commits while the insert is waiting
+    // for its lock.
+    ASSERT_TRUE(other.exec("BEGIN IMMEDIATE; INSERT INTO side VALUES (1);"));
+    std::thread committer([&other] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        other.exec("COMMIT;");
+    });
+    const bool inserted = db.insert(Url{requestId, "http://localhost/new", 200, 20});
+    committer.join();
+
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(db.find(requestId).size(), 1);
+    EXPECT_TRUE(db.insert(Url{requestId, "http://localhost/next", 200, 20}));
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "timing_wheel.h"
+
+namespace {
+std::vector<std::pair<uint64_t, uint64_t>> advance(TimingWheel& wheel, uint64_t tick) {
+    std::vector<std::pair<uint64_t, uint64_t>> fired;
+    wheel.advance(tick, [&](uint64_t id) { fired.emplace_back(wheel.nextTick(), id); });
+    return fired;
+}
+}  // namespace
+
+TEST(TimingWheelTest, FiresOnTheirTickAcrossLevels) {
+    TimingWheel wheel(100);
+    const std::vector<uint64_t> ticks = {100, 101, 355, 356, 100 + 65536, 100 + 65536 * 3 + 17, 100 + (1 << 24) + 5};
+    for (uint64_t id = 0; id < ticks.size(); id++) {
+        wheel.add(id, ticks[id]);
+    }
+    EXPECT_EQ(wheel.size(), ticks.size());
+
+    auto fired = advance(wheel, ticks.back());
+    ASSERT_EQ(fired.size(), ticks.size());
+    for (uint64_t id = 0; id < ticks.size(); id++) {
+        EXPECT_EQ(fired[id].first, ticks[id]);
+        EXPECT_EQ(fired[id].second, id);
+    }
+    EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimingWheelTest, RemovesAndReplacesTimers) {
+    TimingWheel wheel;
+    wheel.add(1, 10);
+    wheel.add(2, 10);
+    wheel.add(3, 300);
+    wheel.remove(2);
+    wheel.add(3, 20);
+
+    auto fired = advance(wheel, 1000);
+    ASSERT_EQ(fired.size(), 2);
+    EXPECT_EQ(fired[0], std::make_pair(uint64_t{10}, uint64_t{1}));
+    EXPECT_EQ(fired[1], std::make_pair(uint64_t{20}, uint64_t{3}));
+}
+
+TEST(TimingWheelTest, FiresPastTicksOnNextAdvance) {
+    TimingWheel wheel;
+    advance(wheel, 500);
+    wheel.add(1, 7);
+    auto fired = advance(wheel, 501);
+    ASSERT_EQ(fired.size(), 1);
+    EXPECT_EQ(fired[0].first, 501);
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <filesystem>
+#include <set>
+#include <string>
 #include "url_parser.h"
 #include "test_http_client.h"
 #include "sqlite_db.h"
@@ -19,13 +22,13 @@ class UrlParserTest : public ::testing::Test {
     }
 
     void TearDown() override {
+        parser = nullptr;
         db.reset();
         deleteTestDb();
-        parser = nullptr;
     }
     void deleteTestDb() {
-        if (std::filesystem::exists(test_db_path)) {
-            std::filesystem::remove(test_db_path);
+        for (const auto& suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(test_db_path + suffix);
         }
     }
 
@@ -43,8 +46,91 @@ TEST_F(UrlParserTest, CheckUrl) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     std::vector<Url> urls = db->find(requestId);
 
+    EXPECT_TRUE(parser->isComplete(requestId));
     ASSERT_EQ(urls.size(), 1);
     EXPECT_EQ(urls[0].url, "http://localhost");
     EXPECT_EQ(urls[0].http_status, 200);
     EXPECT_EQ(urls[0].response_time, 100);
 }
+
+TEST_F(UrlParserTest, CheckUrlsAsync) {
+    auto asyncParser = std::make_unique<UrlParser>(2, 1, db, std::make_shared<TestAsyncHttpClient>(), 4);
+    const int requestId = 2;
+    asyncParser->addUrls(requestId, {
+        "http://localhost/1",
+        "http://localhost/2",
+        "http://localhost/3"
+    });
+    while (!asyncParser->isComplete(requestId)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    asyncParser.reset();
+
+    std::vector<Url> urls = db->find(requestId);
+
+    ASSERT_EQ(urls.size(), 3);
+    for (const auto& url : urls) {
+        EXPECT_EQ(url.http_status, 200);
+        EXPECT_EQ(url.response_time, 100);
+    }
+}
+
+TEST_F(UrlParserTest, SharesCheckOfDuplicateUrl) {
+    std::atomic<int> checks = 0;
+    auto slowFactory = [&checks](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+        checks++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return std::make_unique<TestHttpClient>();
+    };
+    auto coalescingParser = std::make_unique<UrlParser>(2, 1, db, slowFactory);
+    coalescingParser->addUrls(3, {"http://localhost/same"});
+    coalescingParser->addUrls(4, {"http://localhost/same"});
+    while (!coalescingParser->isComplete(3) || !coalescingParser->isComplete(4)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(checks, 1);
+    EXPECT_DOUBLE_EQ(coalescingParser->checkStats().dedupRatio(), 0.5);
+    for (const int requestId : {3, 4}) {
+        std::vector<Url> urls = db->find(requestId);
+        ASSERT_EQ(urls.size(), 1);
+        EXPECT_EQ(urls[0].http_status, 200);
+    }
+}
+
+// Many workers race for the URLs of batches larger than the ready ring;
+// each URL must be checked and stored exactly once.
+TEST_F(UrlParserTest, ChecksEveryUrlOnceUnderContention) {
+    std::atomic<int> checks = 0;
+    auto countingFactory = [&checks](const std::string&, size_t) -> std::unique_ptr<HttpClientInterface> {
+        checks++;
+        return std::make_unique<TestHttpClient>();
+    };
+    auto busyParser = std::make_unique<UrlParser>(8, 1, db, countingFactory);
+    constexpr int kBatches = 4;
+    constexpr int kBatchSize = 1500;
+    for (int batch = 0; batch < kBatches; batch++) {
+        std::vector<std::string> urls;
+        for (int i = 0; i < kBatchSize; i++) {
+            urls.push_back("http://localhost/" + std::to_string(batch) + "/" + std::to_string(i));
+        }
+        busyParser->addUrls(10 + batch, urls);
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    for (int batch = 0; batch < kBatches; batch++) {
+        while (!busyParser->isComplete(10 + batch) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    busyParser.reset();
+
+    EXPECT_EQ(checks, kBatches * kBatchSize);
+    for (int batch = 0; batch < kBatches; batch++) {
+        std::set<std::string> stored;
+        for (const auto& url : db->find(10 + batch)) {
+            stored.insert(url.url);
+        }
+        EXPECT_EQ(stored.size(), kBatchSize);
+        EXPECT_EQ(db->find(10 + batch).size(), kBatchSize);
+    }
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "url_stats.h"
+#include "url_stats_store.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+Url check(const std::string& url, int httpStatus, long long totalUs) {
+    Url result{1, url, httpStatus};
+    result.timings.total_us = totalUs;
+    return result;
+}
+
+}  // namespace
+
+class UrlStatsTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        std::filesystem::remove(test_db_path);
+    }
+    void TearDown() override {
+        std::filesystem::remove(test_db_path);
+    }
+
+    std::string test_db_path = "test_url_stats.db";
+    // Aligned to the hour, so every window starts a fresh slot here.
+    UrlStats::Clock::time_point start = UrlStats::Clock::time_point(std::chrono::hours(500000));
+};
+
+TEST_F(UrlStatsTest, SummarizesEveryWindow) {
+    UrlStats stats;
+    for (int i = 0; i < 9; i++) {
+        stats.record(check("http://a", 200, 20000), start + 1s);
+    }
+    stats.record(check("http://a", 503, 900000), start + 2s);
+    stats.record(check("http://a", 0, 0), start + 3s);
+
+    auto summary = stats.summary("http://a", start + 5s);
+    ASSERT_TRUE(summary);
+    for (const auto& window : *summary) {
+        EXPECT_EQ(window.checks, 11);
+        EXPECT_EQ(window.successes, 9);
+        EXPECT_NEAR(static_cast<double>(window.p50_us), 20000.0, 20000.0 / 32);
+        EXPECT_NEAR(static_cast<double>(window.p99_us), 900000.0, 900000.0 / 32);
+    }
+    EXPECT_NEAR((*summary)[0].successRatio(), 9.0 / 11, 1e-9);
+    EXPECT_FALSE(stats.summary("http://b", start + 5s));
+    EXPECT_EQ(stats.size(), 1);
+}
+
+TEST_F(UrlStatsTest, WindowsSlideOut) {
+    UrlStats stats;
+    stats.record(check("http://a", 200, 1000), start);
+    stats.record(check("http://a", 500, 1000), start + 2min);
+
+    auto summary = stats.summary("http://a", start + 2min + 30s);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ((*summary)[0].checks, 1);
+    EXPECT_EQ((*summary)[0].successes, 0);
+    EXPECT_EQ((*summary)[1].checks, 2);
+
+    summary = stats.summary("http://a", start + 2h);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ((*summary)[0].checks, 0);
+    EXPECT_EQ((*summary)[1].checks, 0);
+    EXPECT_EQ((*summary)[2].checks, 2);
+
+    EXPECT_FALSE(stats.summary("http://a", start + 25h));
+    stats.record(check("http://a", 200, 1000), start + 25h);
+    summary = stats.summary("http://a", start + 25h);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ((*summary)[2].checks, 1);
+    EXPECT_EQ((*summary)[2].successes, 1);
+}
+
+TEST_F(UrlStatsTest, RestoresCheckpoint) {
+    const auto now = UrlStats::Clock::now();
+    {
+        UrlStats stats;
+        stats.persistTo(std::make_shared<UrlStatsStore>(test_db_path), 0s);
+        stats.record(check("http://a", 200, 15000), now - 30min);
+        stats.record(check("http://a", 200, 25000), now);
+        stats.record(check("http://expired", 200, 1000), now - 30h);
+        EXPECT_TRUE(stats.checkpoint(now));
+    }
+    UrlStats restored;
+    restored.persistTo(std::make_shared<UrlStatsStore>(test_db_path), 0s);
+    EXPECT_EQ(restored.size(), 1);
+    auto summary = restored.summary("http://a", now);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ((*summary)[0].checks, 1);
+    EXPECT_EQ((*summary)[1].checks, 2);
+    EXPECT_NEAR(static_cast<double>((*summary)[2].p99_us), 25000.0, 25000.0 / 32);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+#include "url_stream_parser.h"
+
+namespace {
+
+// Feeds the body whole and returns its URLs, or nothing if it is not
+// Complete.
+std::optional<std::vector<std::string>> scan(const std::string& body) {
+    UrlStreamParser parser;
+    if (parser.feed(body) != UrlStreamParser::Result::Complete) {
+        return std::nullopt;
+    }
+    return parser.take();
+}
+
+}  // namespace
+
+TEST(UrlStreamParserTest, ScansUrlsAndSkipsTheRest) {
+    const std::string body = R"( {"id": 7, "urls": [{"url": "http://a.test/", "tag": {"x": [1, -2.5e3, true, null]}},
+                                  {"note": "\"url\"", "url": "http://b.test/?q=é"}], "extra": [[], {}]} )";
+
+    auto urls = scan(body);
+
+    ASSERT_TRUE(urls);
+    EXPECT_EQ(*urls, (std::vector<std::string>{"http://a.test/", "http://b.test/?q=\xC3\xA9"}));
+    EXPECT_EQ(scan(R"({})"), std::vector<std::string>{});
+    EXPECT_EQ(scan(R"({"urls": null})"), std::vector<std::string>{});
+    EXPECT_EQ(scan(R"({"urls": [{"url": "😀"}]})"), std::vector<std::string>{"\xF0\x9F\x98\x80"});
+}
+
+TEST(UrlStreamParserTest, YieldsUrlsWhileTheBodyArrivesInPieces) {
+    nlohmann::json urls = nlohmann::json::array();
+    for (int i = 0; i < 50; i++) {
+        urls.push_back({{"url", "http://host" + std::to_string(i) + ".test/\"\\é"}});
+    }
+    const std::string body = nlohmann::json{{"urls", urls}}.dump(2);
+    UrlStreamParser parser;
+    std::vector<std::string> taken;
+
+    // One byte at a time splits every token somewhere.
+    for (size_t i = 0; i < body.size(); i++) {
+        const auto result = parser.feed(std::string_view(body).substr(i, 1));
+        ASSERT_EQ(result, i + 1 < body.size() ? UrlStreamParser::Result::Incomplete : UrlStreamParser::Result::Complete);
+        if (parser.pending() >= 7) {
+            EXPECT_GT(parser.pendingBytes(), 0);
+            for (auto& url : parser.take(7)) {
+                taken.push_back(std::move(url));
+            }
+        }
+    }
+    for (auto& url : parser.take()) {
+        taken.push_back(std::move(url));
+    }
+
+    ASSERT_EQ(taken.size(), 50);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(taken[i], urls[i]["url"].get<std::string>());
+    }
+    EXPECT_EQ(parser.pendingBytes(), 0);
+}
+
+TEST(UrlStreamParserTest, RejectsWhatJsonParseRejects) {
+    const std::vector<std::string> bad = {
+        R"([])",
+        R"({"urls": [{"url": "a"}])",
+        R"({"urls": [{"url": "a"}]} x)",
+        R"({"urls": [{"url": "a"},]})",
+        R"({"urls": [{"name": "a"}]})",
+        R"({"urls": [{"url": 1}]})",
+        R"({"urls": ["a"]})",
+        R"({"urls": "a"})",
+        R"({"urls": [{"url": "a"}], "n": 01})",
+        R"({"urls": [{"url": "a"}], "n": tru})",
+        R"({"urls": [{"url": "\x"}]})",
+        R"({"urls": [{"url": "\ud83d"}]})",
+        "{\"urls\": [{\"url\": \"a\nb\"}]}",
+        "{\"urls\": [{\"url\": \"\xC3\"}]}",
+        R"({"urls" [{"url": "a"}]})",
+    };
+    for (const auto& body : bad) {
+        UrlStreamParser parser;
+        EXPECT_NE(parser.feed(body), UrlStreamParser::Result::Complete) << body;
+        EXPECT_THROW(
+            {
+                auto parsed = nlohmann::json::parse(body);
+                for (const auto& url : parsed["urls"]) {
+                    (void)url.at("url").get<std::string>();
+                }
+            },
+            std::exception)
+            << body;
+    }
+}
@@ -0,0 +1,26 @@
+#include "timestamps.h"
+#include <chrono>
+#include <ctime>
+
+long long nowMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Rows of a request are mostly stored within the same second, so the text
+// of the last second is kept.
+const std::string& formatMillis(long long millis) {
+    thread_local std::time_t last_second = -1;
+    thread_local std::string text;
+    const std::time_t second = static_cast<std::time_t>(millis / 1000);
+    if (second != last_second) {
+        std::tm local{};
+        localtime_r(&second, &local);
+        char buffer[20];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        text = buffer;
+        last_second = second;
+    }
+    return text;
+}
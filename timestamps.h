@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+// Current time in epoch milliseconds, the way results store it.
+long long nowMillis();
+// Local time of the epoch milliseconds as 'YYYY-MM-DD HH:MM:SS', as the API
+// has always shown it. The reference stays valid until the next call on
+// the same thread.
+const std::string& formatMillis(long long millis);
@@ -0,0 +1,48 @@
+#include "timing_wheel.h"
+#include <algorithm>
+
+void TimingWheel::add(uint64_t id, uint64_t tick) {
+    const uint64_t generation = next_generation++;
+    timers[id] = generation;
+    place(Timer{id, std::max(tick, next_tick), generation});
+}
+
+void TimingWheel::remove(uint64_t id) {
+    timers.erase(id);
+}
+
+void TimingWheel::place(const Timer& timer) {
+    const uint64_t delay = timer.tick - next_tick;
+    for (size_t level = 0; level < kLevels; level++) {
+        const unsigned shift = kSlotBits * level;
+        if (delay < (uint64_t{1} << (shift + kSlotBits))) {
+            slots[level][(timer.tick >> shift) & kSlotMask].push_back(timer);
+            return;
+        }
+    }
+    // Beyond the top level's span: park it in the top slot that comes up
+    // last and let advance() place it again from there.
+    const unsigned shift = kSlotBits * (kLevels - 1);
+    slots[kLevels - 1][((next_tick >> shift) - 1) & kSlotMask].push_back(timer);
+}
+
+// Called when the level below wraps around: the current slot of this level
+// holds the timers due within the next turn of the level below.
+void TimingWheel::cascade(size_t level) {
+    if (level >= kLevels) {
+        return;
+    }
+    const unsigned shift = kSlotBits * level;
+    const size_t index = (next_tick >> shift) & kSlotMask;
+    if (index == 0) {
+        cascade(level + 1);
+    }
+    auto timers_in_slot = std::move(slots[level][index]);
+    slots[level][index].clear();
+    for (const auto& timer : timers_in_slot) {
+        auto it = timers.find(timer.id);
+        if (it != timers.end() && it->second == timer.generation) {
+            place(timer);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical timing wheel over abstract ticks: four levels of 256 slots,
+// so adding, removing and expiring a timer are O(1) however many are set.
+// A timer lands on the level whose span covers its delay and moves one
+// level down each time the level below wraps around, which happens at most
+// three times per timer. Timers further out than 2^32 ticks are parked at
+// the top and placed again when they come up.
+class TimingWheel {
+   public:
+    explicit TimingWheel(uint64_t startTick = 0) : next_tick(startTick) {}
+
+    // Sets the timer with this id to fire at tick, replacing the one it had.
+    // Ticks already passed fire on the next advance().
+    void add(uint64_t id, uint64_t tick);
+    void remove(uint64_t id);
+
+    // Processes every tick up to and including tick, calling fire(id) for
+    // each timer that expires; fired timers are removed.
+    template <typename Fire>
+    void advance(uint64_t tick, Fire&& fire) {
+        for (; next_tick <= tick; next_tick++) {
+            const size_t index = next_tick & kSlotMask;
+            if (index == 0) {
+                cascade(1);
+            }
+            auto expired = std::move(slots[0][index]);
+            slots[0][index].clear();
+            for (const auto& timer : expired) {
+                auto it = timers.find(timer.id);
+                if (it == timers.end() || it->second != timer.generation) {
+                    continue;
+                }
+                if (timer.tick > next_tick) {
+                    place(timer);
+                    continue;
+                }
+                timers.erase(it);
+                fire(timer.id);
+            }
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return timers.size(); }
+    // The first tick the next advance() processes.
+    [[nodiscard]] uint64_t nextTick() const { return next_tick; }
+
+   private:
+    static constexpr size_t kLevels = 4;
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+
+    struct Timer {
+        uint64_t id;
+        uint64_t tick;
+        // Removed or replaced timers stay in their slot until it is
+        // processed and are told apart by this.
+        uint64_t generation;
+    };
+
+    void place(const Timer& timer);
+    void cascade(size_t level);
+
+    uint64_t next_tick;
+    uint64_t next_generation = 0;
+    std::array<std::array<std::vector<Timer>, kSlots>, kLevels> slots;
+    // Generation of the live timer of every id.
+    std::unordered_map<uint64_t, uint64_t> timers;
+};
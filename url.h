@@ -1,7 +1,33 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <string>
+#include <string_view>
+#include <utility>
+
+// When each phase of a check ended, in microseconds since the check started,
+// as curl reports them; 0 for a phase the check never reached (appconnect
+// without TLS, everything after a failed lookup).
+struct PhaseTimings {
+    long long namelookup_us = 0;
+    long long connect_us = 0;
+    long long appconnect_us = 0;
+    long long pretransfer_us = 0;
+    long long starttransfer_us = 0;
+    long long total_us = 0;
+};
+
+// Column, JSON field and query parameter suffix of each phase, in the order
+// a check goes through them.
+inline constexpr std::array<std::pair<std::string_view, long long PhaseTimings::*>, 6> kPhases{{
+    {"namelookup_us", &PhaseTimings::namelookup_us},
+    {"connect_us", &PhaseTimings::connect_us},
+    {"appconnect_us", &PhaseTimings::appconnect_us},
+    {"pretransfer_us", &PhaseTimings::pretransfer_us},
+    {"starttransfer_us", &PhaseTimings::starttransfer_us},
+    {"total_us", &PhaseTimings::total_us},
+}};
 
 struct Url {
     int request_id;
@@ -9,4 +35,7 @@ struct Url {
     int http_status = 0;
     int response_time = 0;
     std::string created_at = "";
+    // Row id; results of a request are ordered by it.
+    long long id = 0;
+    PhaseTimings timings = {};
 };
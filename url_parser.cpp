@@ -4,20 +4,46 @@ UrlParser::UrlParser(const size_t numThreads, size_t timeout,
                      const std::shared_ptr<DatabaseInterface>& dB,
                      std::function<std::unique_ptr<HttpClientInterface>(
                          const std::string&, size_t)>
-                         httpClientFactory)
+                         httpClientFactory,
+                     const HostLimits& hostLimits,
+                     std::chrono::milliseconds resultTtl)
     : m_num_threads(numThreads),
       m_timeout(timeout),
+      m_scheduler(hostLimits),
+      m_coalescer(resultTtl),
       db(dB),
       http_client_factory(std::move(httpClientFactory)) {
     for (size_t i = 0; i < m_num_threads; i++) {
         threads.emplace_back(&UrlParser::worker, this);
     }
 }
+UrlParser::UrlParser(const size_t numThreads, size_t timeout,
+                     const std::shared_ptr<DatabaseInterface>& dB,
+                     const std::shared_ptr<AsyncHttpClientInterface>& asyncHttpClient,
+                     size_t maxInFlight,
+                     const HostLimits& hostLimits,
+                     std::chrono::milliseconds resultTtl)
+    : m_num_threads(numThreads),
+      m_timeout(timeout),
+      m_scheduler(hostLimits),
+      m_max_in_flight(maxInFlight),
+      m_coalescer(resultTtl),
+      db(dB),
+      async_http_client(asyncHttpClient) {
+    for (size_t i = 0; i < m_num_threads; i++) {
+        threads.emplace_back(&UrlParser::asyncWorker, this);
+    }
+}
 UrlParser::~UrlParser() {
+    size_t permits = 0;
     {
         std::lock_guard<std::mutex> lock(mtx);
         m_stop = true;
+        if (http_client_factory) {
+            permits = refill(true);
+        }
     }
+    m_ready_permits.release(permits);
     cv.notify_all();
     for (auto& thread : threads) {
         if (thread.joinable()) {
@@ -27,30 +53,235 @@ UrlParser::~UrlParser() {
 }
 void UrlParser::addUrls(const int requestId,
                         const std::vector<std::string>& url) {
+    m_tracker->add(requestId, url.size());
+    size_t permits = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < url.size(); i++) {
+            m_scheduler.push(Url{requestId, url.at(i)});
+        }
+        if (http_client_factory) {
+            permits = refill(true);
+        }
+    }
+    if (http_client_factory) {
+        m_ready_permits.release(permits);
+    } else {
+        cv.notify_all();
+    }
+}
+size_t UrlParser::queueDepth() const {
     std::lock_guard<std::mutex> lock(mtx);
-    for (size_t i = 0; i < url.size(); i++) {
-        m_queue.push(Url{requestId, url.at(i)});
+    return m_scheduler.size() + m_ready.sizeApprox();
+}
+bool UrlParser::isComplete(const int requestId) const {
+    return m_tracker->isComplete(requestId);
+}
+// Moves URLs the scheduler lets go from it to the ready ring and returns the
+// permits to release once mtx, which the caller holds, is unlocked. Every
+// critical section in blocking mode ends with a refill and releases only
+// after unlocking, so a worker whose try_lock failed never strands work.
+// wakeTimer adds a permit even without URLs, so that a worker wakes up to
+// wait for a rate-limited host.
+size_t UrlParser::refill(bool wakeTimer) {
+    const auto now = HostScheduler::Clock::now();
+    size_t permits = 0;
+    while (m_ready.sizeApprox() < m_ready.capacity()) {
+        auto next = m_scheduler.pop(now);
+        if (!next) {
+            break;
+        }
+        // The ring is not full, so this only spins while a consumer that
+        // already claimed the slot finishes reading it.
+        while (!m_ready.tryPush(std::move(*next))) {
+            std::this_thread::yield();
+        }
+        permits++;
     }
-    cv.notify_all();
+    m_backlog.store(m_scheduler.size(), std::memory_order_relaxed);
+    auto ready = m_scheduler.empty() ? std::nullopt : m_scheduler.nextReady(now);
+    m_next_ready.store(ready ? ready->time_since_epoch().count() : 0, std::memory_order_relaxed);
+    if (m_stop && m_scheduler.empty() && !m_stop_released) {
+        // One permit per worker to let them see the empty ring and exit.
+        m_stop_released = true;
+        permits += m_num_threads;
+    } else if (permits == 0 && ready && wakeTimer) {
+        permits = 1;
+    }
+    return permits;
+}
+// Permits outnumber the URLs in the ring only by wakeups and the stop
+// permits, so a permit with an empty ring means one of those.
+bool UrlParser::nextUrl(Url& url) {
+    while (true) {
+        const auto nextReady = m_next_ready.load(std::memory_order_relaxed);
+        if (nextReady == 0) {
+            m_ready_permits.acquire();
+        } else if (!m_ready_permits.tryAcquireUntil(
+                       HostScheduler::Clock::time_point(HostScheduler::Clock::duration(nextReady)))) {
+            refillAndRelease();
+            continue;
+        }
+        if (m_ready.tryPop(url)) {
+            if (m_ready.sizeApprox() < m_ready.capacity() / 2 &&
+                m_backlog.load(std::memory_order_relaxed) > 0) {
+                size_t permits = 0;
+                if (std::unique_lock lock(mtx, std::try_to_lock); lock) {
+                    permits = refill(false);
+                }
+                m_ready_permits.release(permits);
+            }
+            return true;
+        }
+        size_t permits = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (m_stop_released && m_ready.sizeApprox() == 0) {
+                return false;
+            }
+            permits = refill(false);
+        }
+        m_ready_permits.release(permits);
+    }
+}
+void UrlParser::refillAndRelease() {
+    size_t permits = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        permits = refill(false);
+    }
+    m_ready_permits.release(permits);
+}
+void UrlParser::releaseAdmissionOnCommit(BatchWriter& writer) {
+    m_release_on_commit = true;
+    writer.onDone([admission = m_admission](const std::vector<Url>& rows) {
+        for (const auto& row : rows) {
+            admission->finished(row);
+        }
+    });
+}
+// The room goes back before the request completes, so a client told it is
+// complete finds it free.
+void UrlParser::store(const Url& url) {
+    db->insert(url);
+    if (!m_release_on_commit) {
+        m_admission->finished(url);
+    }
+    m_tracker->finished(url);
 }
+// A URL that joins a check in flight gives its host slot back right away;
+// its result is stored by the worker that runs the check.
 void UrlParser::worker() {
+    Url url;
+    while (nextUrl(url)) {
+        const auto started = std::chrono::steady_clock::now();
+        m_tracker->started(url.request_id);
+        const auto outcome = m_coalescer.begin(url);
+        if (outcome == CheckCoalescer::Outcome::Check) {
+            auto httpClient = http_client_factory(url.url, m_timeout);
+            url.http_status = httpClient->getHttpStatus();
+            url.response_time = httpClient->getRequestTime();
+            url.timings = httpClient->getTimings();
+            m_url_stats->record(url);
+            metrics().checks.add();
+            metrics().check_duration.observe(std::chrono::steady_clock::now() - started);
+        }
+        if (m_scheduler.capsConcurrency()) {
+            size_t permits = 0;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                m_scheduler.done(url);
+                permits = refill(false);
+            }
+            m_ready_permits.release(permits);
+        }
+        if (outcome != CheckCoalescer::Outcome::Joined) {
+            store(url);
+        }
+        if (outcome == CheckCoalescer::Outcome::Check) {
+            for (const auto& waiter : m_coalescer.finish(url)) {
+                store(waiter);
+            }
+        }
+        metrics().worker_busy_micros.add(microsSince(started));
+    }
+}
+void UrlParser::asyncWorker() {
     while (true) {
         Url url;
+        bool isResult = false;
         {
             std::unique_lock lock(mtx);
-            cv.wait(lock, [this] { return !m_queue.empty() || m_stop; });
-            if (m_stop && m_queue.empty()) {
-                break;
+            while (true) {
+                if (!m_results.empty()) {
+                    url = std::move(m_results.front());
+                    m_results.pop();
+                    isResult = true;
+                    break;
+                }
+                const auto now = HostScheduler::Clock::now();
+                const bool canDispatch = m_in_flight < m_max_in_flight;
+                if (canDispatch) {
+                    if (auto next = m_scheduler.pop(now)) {
+                        url = std::move(*next);
+                        m_in_flight++;
+                        break;
+                    }
+                }
+                if (m_stop && m_scheduler.empty() && m_in_flight == 0) {
+                    return;
+                }
+                if (auto ready = canDispatch ? m_scheduler.nextReady(now) : std::nullopt) {
+                    cv.wait_until(lock, *ready);
+                } else {
+                    cv.wait(lock);
+                }
+            }
+        }
+        const auto started = std::chrono::steady_clock::now();
+        if (isResult) {
+            m_url_stats->record(url);
+            store(url);
+            for (const auto& waiter : m_coalescer.finish(url)) {
+                store(waiter);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                m_in_flight--;
+            }
+            cv.notify_all();
+            metrics().worker_busy_micros.add(microsSince(started));
+            continue;
+        }
+        m_tracker->started(url.request_id);
+        if (const auto outcome = m_coalescer.begin(url); outcome != CheckCoalescer::Outcome::Check) {
+            if (outcome == CheckCoalescer::Outcome::Cached) {
+                store(url);
             }
-            if (m_queue.empty()) {
-                continue;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                m_scheduler.done(url);
+                m_in_flight--;
             }
-            url = m_queue.front();
-            m_queue.pop();
+            cv.notify_all();
+            metrics().worker_busy_micros.add(microsSince(started));
+            continue;
         }
-        auto httpClient = http_client_factory(url.url, m_timeout);
-        url.http_status = httpClient->getHttpStatus();
-        url.response_time = httpClient->getRequestTime();
-        db->insert(url);
+        async_http_client->check(
+            url.url, m_timeout,
+            [this, url, started](size_t httpStatus, const PhaseTimings& timings) mutable {
+                url.http_status = httpStatus;
+                url.response_time = timings.total_us / 1000;
+                url.timings = timings;
+                metrics().checks.add();
+                metrics().check_duration.observe(std::chrono::steady_clock::now() - started);
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    m_scheduler.done(url);
+                    m_results.push(std::move(url));
+                }
+                cv.notify_one();
+            });
+        metrics().worker_busy_micros.add(microsSince(started));
     }
 }
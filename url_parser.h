@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -8,8 +10,18 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include "admission_control.h"
+#include "async_http_client_interface.h"
+#include "batch_writer.h"
+#include "check_coalescer.h"
 #include "database_interface.h"
+#include "host_scheduler.h"
 #include "http_client_interface.h"
+#include "light_semaphore.h"
+#include "metrics.h"
+#include "mpmc_queue.h"
+#include "request_tracker.h"
+#include "url_stats.h"
 #include "url.h"
 
 class UrlParser {
@@ -18,19 +30,73 @@ class UrlParser {
                        const std::shared_ptr<DatabaseInterface>& dB,
                        std::function<std::unique_ptr<HttpClientInterface>(
                            const std::string&, size_t)>
-                           httpClientFactory);
+                           httpClientFactory,
+                       const HostLimits& hostLimits = {},
+                       std::chrono::milliseconds resultTtl = {});
+    // Event-driven mode: worker threads only dispatch checks to the async
+    // client and store their results, up to maxInFlight checks at a time.
+    explicit UrlParser(const size_t numThreads, size_t timeout,
+                       const std::shared_ptr<DatabaseInterface>& dB,
+                       const std::shared_ptr<AsyncHttpClientInterface>& asyncHttpClient,
+                       size_t maxInFlight,
+                       const HostLimits& hostLimits = {},
+                       std::chrono::milliseconds resultTtl = {});
     ~UrlParser();
     void addUrls(const int requestId, const std::vector<std::string>& url);
+    // True once the results of every URL added for the request are stored;
+    // requests the parser never saw count as complete.
+    [[nodiscard]] bool isComplete(const int requestId) const;
+    [[nodiscard]] const std::shared_ptr<RequestTracker>& tracker() const { return m_tracker; }
+    // Bounds the URLs added through the API; each stored result gives back
+    // the room its URL took.
+    [[nodiscard]] const std::shared_ptr<AdmissionControl>& admission() const { return m_admission; }
+    // Gives the room of each result back once the writer has committed it
+    // rather than once it is queued, so results waiting for their commit
+    // still count against the limits. Must precede the first URL.
+    void releaseAdmissionOnCommit(BatchWriter& writer);
+    // Rolling latency and success aggregates of every checked URL; only
+    // checks actually made count, not results shared or cached.
+    [[nodiscard]] const std::shared_ptr<UrlStats>& urlStats() const { return m_url_stats; }
+    [[nodiscard]] CheckCoalescer::Stats checkStats() const { return m_coalescer.stats(); }
+    // URLs waiting for a worker.
+    [[nodiscard]] size_t queueDepth() const;
+    [[nodiscard]] size_t threadCount() const { return m_num_threads; }
 
    private:
+    // Blocking mode hands URLs to workers through a lock-free ring that is
+    // refilled from the scheduler in bulk; one semaphore permit per URL (or
+    // wakeup) wakes exactly as many workers as there is work for.
+    static constexpr size_t kReadyCapacity = 1024;
+
+    bool nextUrl(Url& url);
+    size_t refill(bool wakeTimer);
+    void refillAndRelease();
+    void store(const Url& url);
     void worker();
+    void asyncWorker();
     size_t m_num_threads;
     size_t m_timeout;
-    std::queue<Url> m_queue;
-    std::mutex mtx;
+    HostScheduler m_scheduler;
+    MpmcQueue<Url> m_ready{kReadyCapacity};
+    LightSemaphore m_ready_permits;
+    // Scheduler size as of the last refill, read without the lock.
+    std::atomic<size_t> m_backlog = 0;
+    // When a rate-limited host can go next, in steady_clock ticks; 0 - none.
+    std::atomic<HostScheduler::Clock::rep> m_next_ready = 0;
+    bool m_stop_released = false;
+    std::queue<Url> m_results;
+    size_t m_in_flight = 0;
+    size_t m_max_in_flight = 0;
+    CheckCoalescer m_coalescer;
+    std::shared_ptr<RequestTracker> m_tracker = std::make_shared<RequestTracker>();
+    std::shared_ptr<AdmissionControl> m_admission = std::make_shared<AdmissionControl>();
+    bool m_release_on_commit = false;
+    std::shared_ptr<UrlStats> m_url_stats = std::make_shared<UrlStats>();
+    mutable std::mutex mtx;
     std::condition_variable cv;
     bool m_stop = false;
     std::shared_ptr<DatabaseInterface> db;
     std::function<std::unique_ptr<HttpClientInterface>(const std::string&, size_t)> http_client_factory;
+    std::shared_ptr<AsyncHttpClientInterface> async_http_client;
     std::vector<std::thread> threads;
 };
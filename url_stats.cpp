@@ -0,0 +1,286 @@
+#include "url_stats.h"
+#include <cstring>
+#include <functional>
+
+namespace {
+
+// Bumped whenever the layout written by Entry::write changes; rows of
+// another version are ignored on load.
+constexpr uint8_t kFormatVersion = 1;
+
+template <typename T>
+void writeValue(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::string_view& data, T& value) {
+    if (data.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(T));
+    data.remove_prefix(sizeof(T));
+    return true;
+}
+
+bool isSuccess(int httpStatus) {
+    return httpStatus >= 200 && httpStatus < 400;
+}
+
+// Falls back to the millisecond response time for clients that do not
+// report phase timings.
+uint64_t latencyOf(const Url& url) {
+    if (url.timings.total_us > 0) {
+        return static_cast<uint64_t>(url.timings.total_us);
+    }
+    return url.response_time > 0 ? static_cast<uint64_t>(url.response_time) * 1000 : 0;
+}
+
+}  // namespace
+
+UrlStats::Entry::Entry() {
+    for (size_t w = 0; w < kStatsWindows.size(); w++) {
+        windows[w].resize(kStatsWindows[w].slots);
+    }
+}
+
+void UrlStats::Entry::write(std::string& out) const {
+    writeValue(out, kFormatVersion);
+    for (const auto& slots : windows) {
+        uint32_t used = 0;
+        for (const auto& slot : slots) {
+            used += slot.index >= 0 ? 1 : 0;
+        }
+        writeValue(out, used);
+        for (const auto& slot : slots) {
+            if (slot.index < 0) {
+                continue;
+            }
+            writeValue(out, slot.index);
+            writeValue(out, slot.checks);
+            writeValue(out, slot.successes);
+            slot.latency.write(out);
+        }
+    }
+}
+
+bool UrlStats::Entry::read(std::string_view data) {
+    uint8_t version = 0;
+    if (!readValue(data, version) || version != kFormatVersion) {
+        return false;
+    }
+    for (auto& slots : windows) {
+        uint32_t used = 0;
+        if (!readValue(data, used) || used > slots.size()) {
+            return false;
+        }
+        for (uint32_t i = 0; i < used; i++) {
+            Slot slot;
+            if (!readValue(data, slot.index) || slot.index < 0 || !readValue(data, slot.checks) ||
+                !readValue(data, slot.successes) || !slot.latency.read(data)) {
+                return false;
+            }
+            slots[static_cast<size_t>(slot.index) % slots.size()] = std::move(slot);
+        }
+    }
+    return data.empty();
+}
+
+bool UrlStats::Entry::live(Clock::time_point now) const {
+    const auto& window = kStatsWindows.back();
+    const int64_t current = slotIndex(window, now);
+    for (const auto& slot : windows.back()) {
+        if (slot.index >= 0 && slot.index > current - static_cast<int64_t>(window.slots)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+UrlStats::~UrlStats() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(checkpoint_mtx);
+            m_stop = true;
+        }
+        checkpoint_cv.notify_all();
+        thread.join();
+        checkpoint();
+    }
+}
+
+int64_t UrlStats::slotIndex(const StatsWindow& window, Clock::time_point now) {
+    return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()) / window.slot;
+}
+
+UrlStats::Shard& UrlStats::shardOf(const std::string& url) {
+    return shards[std::hash<std::string>{}(url) % kShards];
+}
+
+const UrlStats::Shard& UrlStats::shardOf(const std::string& url) const {
+    return shards[std::hash<std::string>{}(url) % kShards];
+}
+
+void UrlStats::sweep(Shard& shard, Clock::time_point now) {
+    const bool persisting = m_persisting.load(std::memory_order_relaxed);
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+        if (it->second.live(now)) {
+            ++it;
+            continue;
+        }
+        if (persisting) {
+            shard.removed.push_back(it->first);
+        }
+        it = shard.entries.erase(it);
+    }
+}
+
+void UrlStats::record(const Url& url, Clock::time_point now) {
+    const bool success = isSuccess(url.http_status);
+    const uint64_t latency = latencyOf(url);
+    auto& shard = shardOf(url.url);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    // Expired URLs are swept once per slot of the longest window, so the
+    // sweep costs nothing per check.
+    if (const int64_t current = slotIndex(kStatsWindows.back(), now); current != shard.swept) {
+        sweep(shard, now);
+        shard.swept = current;
+    }
+    auto& entry = shard.entries[url.url];
+    for (size_t w = 0; w < kStatsWindows.size(); w++) {
+        const int64_t index = slotIndex(kStatsWindows[w], now);
+        auto& slot = entry.windows[w][static_cast<size_t>(index) % kStatsWindows[w].slots];
+        if (slot.index != index) {
+            slot.index = index;
+            slot.checks = 0;
+            slot.successes = 0;
+            slot.latency.clear();
+        }
+        slot.checks++;
+        slot.successes += success ? 1 : 0;
+        if (url.http_status != 0) {
+            slot.latency.add(latency);
+        }
+    }
+    entry.dirty = true;
+}
+
+std::optional<UrlStats::Summary> UrlStats::summary(const std::string& url, Clock::time_point now) const {
+    const auto& shard = shardOf(url);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    const auto it = shard.entries.find(url);
+    if (it == shard.entries.end()) {
+        return std::nullopt;
+    }
+    Summary summary;
+    for (size_t w = 0; w < kStatsWindows.size(); w++) {
+        const auto& window = kStatsWindows[w];
+        const int64_t current = slotIndex(window, now);
+        auto& result = summary[w];
+        result.name = window.name;
+        LatencySketch latency;
+        for (const auto& slot : it->second.windows[w]) {
+            if (slot.index < 0 || slot.index > current || slot.index <= current - static_cast<int64_t>(window.slots)) {
+                continue;
+            }
+            result.checks += slot.checks;
+            result.successes += slot.successes;
+            latency.merge(slot.latency);
+        }
+        result.p50_us = latency.quantile(0.5);
+        result.p95_us = latency.quantile(0.95);
+        result.p99_us = latency.quantile(0.99);
+    }
+    if (summary.back().checks == 0) {
+        return std::nullopt;
+    }
+    return summary;
+}
+
+size_t UrlStats::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+void UrlStats::persistTo(const std::shared_ptr<UrlStatsStore>& statsStore, std::chrono::seconds interval) {
+    store = statsStore;
+    const auto now = Clock::now();
+    std::vector<std::string> stale;
+    for (auto& [url, data] : store->load()) {
+        Entry entry;
+        if (!entry.read(data) || !entry.live(now)) {
+            stale.push_back(std::move(url));
+            continue;
+        }
+        auto& shard = shardOf(url);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        // Checks recorded before the load are newer than the checkpoint.
+        shard.entries.try_emplace(std::move(url), std::move(entry));
+    }
+    if (!stale.empty()) {
+        store->save({}, stale);
+    }
+    m_persisting = true;
+    if (interval.count() > 0) {
+        thread = std::thread(&UrlStats::checkpointer, this, interval);
+    }
+}
+
+bool UrlStats::checkpoint(Clock::time_point now) {
+    if (!store) {
+        return false;
+    }
+    std::vector<std::pair<std::string, std::string>> changed;
+    std::vector<std::string> removed;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        sweep(shard, now);
+        removed.insert(removed.end(), std::make_move_iterator(shard.removed.begin()),
+                       std::make_move_iterator(shard.removed.end()));
+        shard.removed.clear();
+        for (auto& [url, entry] : shard.entries) {
+            if (!entry.dirty) {
+                continue;
+            }
+            std::string data;
+            entry.write(data);
+            changed.emplace_back(url, std::move(data));
+            entry.dirty = false;
+        }
+    }
+    if (changed.empty() && removed.empty()) {
+        return true;
+    }
+    if (store->save(changed, removed)) {
+        return true;
+    }
+    // Retried with the next checkpoint.
+    for (const auto& [url, data] : changed) {
+        auto& shard = shardOf(url);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (auto it = shard.entries.find(url); it != shard.entries.end()) {
+            it->second.dirty = true;
+        }
+    }
+    for (auto& url : removed) {
+        auto& shard = shardOf(url);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.removed.push_back(std::move(url));
+    }
+    return false;
+}
+
+void UrlStats::checkpointer(std::chrono::seconds interval) {
+    std::unique_lock<std::mutex> lock(checkpoint_mtx);
+    while (!checkpoint_cv.wait_for(lock, interval, [this] { return m_stop; })) {
+        lock.unlock();
+        checkpoint();
+        lock.lock();
+    }
+}
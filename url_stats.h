@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "latency_sketch.h"
+#include "url.h"
+#include "url_stats_store.h"
+
+// A sliding window made of slots of fixed length; it covers the current,
+// partly filled slot and the slots - 1 before it.
+struct StatsWindow {
+    std::string_view name;
+    std::chrono::seconds slot;
+    size_t slots;
+};
+
+inline constexpr std::array<StatsWindow, 3> kStatsWindows{{
+    {"1m", std::chrono::seconds(10), 6},
+    {"1h", std::chrono::minutes(5), 12},
+    {"24h", std::chrono::hours(1), 24},
+}};
+
+// Rolling aggregates of the checks of every URL: per window, the number of
+// checks, the share that got a 2xx or 3xx answer and a latency sketch of
+// those that got any answer. Recording and reading a URL touch only its own
+// slots, so both cost the same however many URLs are tracked. URLs are
+// spread over shards with a lock each; a URL with no check in the longest
+// window is dropped.
+class UrlStats {
+   public:
+    using Clock = std::chrono::system_clock;
+
+    struct WindowSummary {
+        std::string_view name;
+        uint64_t checks = 0;
+        uint64_t successes = 0;
+        uint64_t p50_us = 0;
+        uint64_t p95_us = 0;
+        uint64_t p99_us = 0;
+
+        [[nodiscard]] double successRatio() const {
+            return checks == 0 ? 0.0 : static_cast<double>(successes) / static_cast<double>(checks);
+        }
+    };
+    using Summary = std::array<WindowSummary, kStatsWindows.size()>;
+
+    UrlStats() = default;
+    ~UrlStats();
+    UrlStats(const UrlStats&) = delete;
+    UrlStats& operator=(const UrlStats&) = delete;
+
+    void record(const Url& url, Clock::time_point now = Clock::now());
+    // nullopt for a URL without checks in the longest window.
+    [[nodiscard]] std::optional<Summary> summary(const std::string& url, Clock::time_point now = Clock::now()) const;
+    // URLs tracked.
+    [[nodiscard]] size_t size() const;
+
+    // Loads the aggregates checkpointed in the store, then checkpoints the
+    // URLs changed since the last checkpoint every interval and once more
+    // on destruction.
+    void persistTo(const std::shared_ptr<UrlStatsStore>& store, std::chrono::seconds interval);
+    // Writes the URLs changed since the last checkpoint and deletes the
+    // expired ones.
+    bool checkpoint(Clock::time_point now = Clock::now());
+
+   private:
+    static constexpr size_t kShards = 16;
+
+    struct Slot {
+        // Slot number since the epoch; -1 while unused.
+        int64_t index = -1;
+        uint64_t checks = 0;
+        uint64_t successes = 0;
+        LatencySketch latency;
+    };
+    struct Entry {
+        std::array<std::vector<Slot>, kStatsWindows.size()> windows;
+        bool dirty = false;
+
+        Entry();
+        void write(std::string& out) const;
+        bool read(std::string_view data);
+        // True if any slot is within its window at now.
+        [[nodiscard]] bool live(Clock::time_point now) const;
+    };
+    struct Shard {
+        mutable std::mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+        // Slot of the longest window at the last sweep for expired URLs.
+        int64_t swept = -1;
+        // URLs swept since the last checkpoint, while persisting.
+        std::vector<std::string> removed;
+    };
+
+    static int64_t slotIndex(const StatsWindow& window, Clock::time_point now);
+    Shard& shardOf(const std::string& url);
+    const Shard& shardOf(const std::string& url) const;
+    // Drops the URLs of the shard that are not live at now; called with
+    // its lock held.
+    void sweep(Shard& shard, Clock::time_point now);
+    void checkpointer(std::chrono::seconds interval);
+
+    std::array<Shard, kShards> shards;
+    std::shared_ptr<UrlStatsStore> store;
+    std::atomic<bool> m_persisting = false;
+    std::mutex checkpoint_mtx;
+    std::condition_variable checkpoint_cv;
+    bool m_stop = false;
+    std::thread thread;
+};
@@ -0,0 +1,88 @@
+#include "url_stats_store.h"
+#include <stdexcept>
+
+UrlStatsStore::UrlStatsStore(const std::string& databasePath)
+    : db(std::make_unique<SqliteConnection>(databasePath, false)) {
+    createTable();
+}
+
+bool UrlStatsStore::save(const std::vector<std::pair<std::string, std::string>>& changed,
+                         const std::vector<std::string>& removed) {
+    const char* upsert_sql = R"(
+        INSERT OR REPLACE INTO url_stats (url, data)
+        VALUES (?, ?);
+    )";
+    const char* delete_sql = R"(
+        DELETE FROM url_stats WHERE url = ?;
+    )";
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db->exec("BEGIN;")) {
+        return false;
+    }
+    for (const auto& [url, data] : changed) {
+        auto stmt = db->prepare(upsert_sql);
+        if (!stmt) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+        sqlite3_bind_text(stmt.get(), 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+        sqlite3_bind_blob(stmt.get(), 2, data.data(), static_cast<int>(data.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+    }
+    for (const auto& url : removed) {
+        auto stmt = db->prepare(delete_sql);
+        if (!stmt) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+        sqlite3_bind_text(stmt.get(), 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            db->exec("ROLLBACK;");
+            return false;
+        }
+    }
+    // A transaction left open would make every later checkpoint fail.
+    if (!db->exec("COMMIT;")) {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::pair<std::string, std::string>> UrlStatsStore::load() {
+    std::vector<std::pair<std::string, std::string>> rows;
+    const char* select_sql = R"(
+        SELECT url, data FROM url_stats;
+    )";
+    std::lock_guard<std::mutex> lock(mtx);
+    auto stmt = db->prepare(select_sql);
+    if (!stmt) {
+        return rows;
+    }
+    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+        std::string url = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        std::string data(static_cast<const char*>(sqlite3_column_blob(stmt.get(), 1)),
+                         static_cast<size_t>(sqlite3_column_bytes(stmt.get(), 1)));
+        rows.emplace_back(std::move(url), std::move(data));
+    }
+    return rows;
+}
+
+void UrlStatsStore::createTable() {
+    const char* create_table_sql = R"(
+        CREATE TABLE IF NOT EXISTS url_stats (
+            url TEXT PRIMARY KEY,
+            data BLOB NOT NULL
+        ) WITHOUT ROWID;)";
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(db->get(), create_table_sql, nullptr, nullptr, &err_msg);
+
+    if (rc != SQLITE_OK) {
+        std::string error_msg = "SQL error: " + std::string(err_msg);
+        sqlite3_free(err_msg);
+        throw std::runtime_error(error_msg);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sqlite_connection.h"
+
+// Checkpoints of the per-URL aggregates of UrlStats, one serialized row per
+// URL in the url_stats table, so a restart does not begin with empty
+// windows.
+class UrlStatsStore {
+   public:
+    explicit UrlStatsStore(const std::string& databasePath);
+
+    // Replaces the rows of the changed URLs and deletes the removed ones in
+    // one transaction.
+    bool save(const std::vector<std::pair<std::string, std::string>>& changed,
+              const std::vector<std::string>& removed);
+    std::vector<std::pair<std::string, std::string>> load();
+
+   private:
+    void createTable();
+
+    std::mutex mtx;
+    std::unique_ptr<SqliteConnection> db;
+};
@@ -0,0 +1,426 @@
+#include "url_stream_parser.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Characters a number or a literal is made of; any other ends it.
+bool isScalarChar(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '+' || c == '-' || c == '.';
+}
+
+int hexValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isNumber(std::string_view value) {
+    size_t i = 0;
+    auto digits = [&] {
+        const size_t start = i;
+        while (i < value.size() && isDigit(value[i])) {
+            i++;
+        }
+        return i > start;
+    };
+    if (i < value.size() && value[i] == '-') {
+        i++;
+    }
+    if (i < value.size() && value[i] == '0') {
+        i++;
+    } else if (!digits()) {
+        return false;
+    }
+    if (i < value.size() && value[i] == '.') {
+        i++;
+        if (!digits()) {
+            return false;
+        }
+    }
+    if (i < value.size() && (value[i] == 'e' || value[i] == 'E')) {
+        i++;
+        if (i < value.size() && (value[i] == '+' || value[i] == '-')) {
+            i++;
+        }
+        if (!digits()) {
+            return false;
+        }
+    }
+    return i == value.size();
+}
+
+// Well-formed UTF-8 without overlong forms or surrogates, as JSON strings
+// must be.
+bool isUtf8(std::string_view value) {
+    size_t i = 0;
+    while (i < value.size()) {
+        const auto lead = static_cast<unsigned char>(value[i]);
+        size_t length = 0;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead < 0x80) {
+            i++;
+            continue;
+        } else if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            low = lead == 0xE0 ? 0xA0 : 0x80;
+            high = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            low = lead == 0xF0 ? 0x90 : 0x80;
+            high = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+        if (value.size() - i < length) {
+            return false;
+        }
+        for (size_t k = 1; k < length; k++) {
+            const auto next = static_cast<unsigned char>(value[i + k]);
+            if (next < (k == 1 ? low : 0x80) || next > (k == 1 ? high : 0xBF)) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+}  // namespace
+
+UrlStreamParser::Result UrlStreamParser::feed(std::string_view data) {
+    if (m_result == Result::Bad) {
+        return m_result;
+    }
+    for (size_t i = 0; i < data.size(); i++) {
+        // Plain characters of a string are taken in a run rather than one
+        // step each.
+        if (m_lexer == Lexer::String && m_high_surrogate == 0) {
+            const size_t start = i;
+            while (i < data.size() && data[i] != '"' && data[i] != '\\' &&
+                   static_cast<unsigned char>(data[i]) >= 0x20) {
+                i++;
+            }
+            if (m_capture) {
+                m_string.append(data.substr(start, i - start));
+            }
+            if (i == data.size()) {
+                break;
+            }
+        }
+        if (!step(data[i])) {
+            m_result = Result::Bad;
+            break;
+        }
+    }
+    return m_result;
+}
+
+std::vector<std::string> UrlStreamParser::take(size_t limit) {
+    const size_t count = limit == 0 ? m_urls.size() : std::min(limit, m_urls.size());
+    std::vector<std::string> taken(std::make_move_iterator(m_urls.begin()),
+                                   std::make_move_iterator(m_urls.begin() + static_cast<std::ptrdiff_t>(count)));
+    m_urls.erase(m_urls.begin(), m_urls.begin() + static_cast<std::ptrdiff_t>(count));
+    for (const auto& url : taken) {
+        m_pending_bytes -= url.size();
+    }
+    return taken;
+}
+
+bool UrlStreamParser::step(char c) {
+    switch (m_lexer) {
+        case Lexer::String:
+            if (m_high_surrogate != 0 && c != '\\') {
+                return false;
+            }
+            if (c == '"') {
+                m_lexer = Lexer::Between;
+                return endString();
+            }
+            if (c == '\\') {
+                m_lexer = Lexer::Escape;
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return false;
+            }
+            if (m_capture) {
+                m_string += c;
+            }
+            return true;
+        case Lexer::Escape: {
+            if (m_high_surrogate != 0 && c != 'u') {
+                return false;
+            }
+            char unescaped = 0;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':
+                    unescaped = c;
+                    break;
+                case 'b':
+                    unescaped = '\b';
+                    break;
+                case 'f':
+                    unescaped = '\f';
+                    break;
+                case 'n':
+                    unescaped = '\n';
+                    break;
+                case 'r':
+                    unescaped = '\r';
+                    break;
+                case 't':
+                    unescaped = '\t';
+                    break;
+                case 'u':
+                    m_lexer = Lexer::Unicode;
+                    m_code = 0;
+                    m_hex_digits = 0;
+                    return true;
+                default:
+                    return false;
+            }
+            if (m_capture) {
+                m_string += unescaped;
+            }
+            m_lexer = Lexer::String;
+            return true;
+        }
+        case Lexer::Unicode: {
+            const int value = hexValue(c);
+            if (value < 0) {
+                return false;
+            }
+            m_code = m_code * 16 + static_cast<uint32_t>(value);
+            if (++m_hex_digits < 4) {
+                return true;
+            }
+            m_lexer = Lexer::String;
+            return appendCodePoint(m_code);
+        }
+        case Lexer::Scalar:
+            if (isScalarChar(c)) {
+                m_scalar += c;
+                return true;
+            }
+            m_lexer = Lexer::Between;
+            if (!endScalar()) {
+                return false;
+            }
+            break;
+        case Lexer::Between:
+            break;
+    }
+
+    if (isWhitespace(c)) {
+        return true;
+    }
+    if (m_stack.empty()) {
+        // Nothing may follow the root object.
+        return m_result != Result::Complete && beginValue(c);
+    }
+    Frame& top = m_stack.back();
+    switch (top.expect) {
+        case Expect::FirstKey:
+            if (c == '}') {
+                return closeContainer(true);
+            }
+            [[fallthrough]];
+        case Expect::Key:
+            if (c != '"') {
+                return false;
+            }
+            // Only the keys of the root and of the entries are looked at.
+            m_capture = top.role == Role::Root || top.role == Role::Entry;
+            m_is_key = true;
+            m_string.clear();
+            m_lexer = Lexer::String;
+            return true;
+        case Expect::Colon:
+            if (c != ':') {
+                return false;
+            }
+            top.expect = Expect::Value;
+            return true;
+        case Expect::FirstValue:
+            if (c == ']') {
+                return closeContainer(false);
+            }
+            return beginValue(c);
+        case Expect::Value:
+            return beginValue(c);
+        case Expect::Next:
+            if (c == ',') {
+                top.expect = top.object ? Expect::Key : Expect::Value;
+                return true;
+            }
+            if (c == (top.object ? '}' : ']')) {
+                return closeContainer(top.object);
+            }
+            return false;
+    }
+    return false;
+}
+
+bool UrlStreamParser::beginValue(char c) {
+    const Frame* parent = m_stack.empty() ? nullptr : &m_stack.back();
+    const bool is_root = parent == nullptr;
+    const bool is_urls = parent != nullptr && parent->role == Role::Root && parent->key == Key::Urls;
+    const bool is_entry = parent != nullptr && parent->role == Role::Urls;
+    const bool is_url = parent != nullptr && parent->role == Role::Entry && parent->key == Key::Url;
+
+    if (c == '{') {
+        if (is_urls || is_url) {
+            return false;
+        }
+        if (is_entry) {
+            m_url.clear();
+            m_has_url = false;
+        }
+        m_stack.push_back(Frame{true, is_root ? Role::Root : is_entry ? Role::Entry : Role::Other, Expect::FirstKey});
+        return true;
+    }
+    if (is_root || is_entry) {
+        return false;
+    }
+    if (c == '[') {
+        if (is_url) {
+            return false;
+        }
+        m_stack.push_back(Frame{false, is_urls ? Role::Urls : Role::Other, Expect::FirstValue});
+        return true;
+    }
+    if (c == '"') {
+        if (is_urls) {
+            return false;
+        }
+        m_capture = is_url;
+        m_is_key = false;
+        m_string.clear();
+        m_lexer = Lexer::String;
+        return true;
+    }
+    // "urls": null stands for no URLs.
+    if (isDigit(c) || c == '-' || c == 't' || c == 'f' || c == 'n') {
+        if (is_url || (is_urls && c != 'n')) {
+            return false;
+        }
+        m_scalar.assign(1, c);
+        m_lexer = Lexer::Scalar;
+        return true;
+    }
+    return false;
+}
+
+bool UrlStreamParser::endString() {
+    Frame& top = m_stack.back();
+    if (m_is_key) {
+        top.key = Key::Other;
+        if (top.role == Role::Root && m_string == "urls") {
+            top.key = Key::Urls;
+        } else if (top.role == Role::Entry && m_string == "url") {
+            top.key = Key::Url;
+        }
+        top.expect = Expect::Colon;
+        return true;
+    }
+    if (m_capture) {
+        if (!isUtf8(m_string)) {
+            return false;
+        }
+        // The last "url" of an entry wins, as it would in a parsed object.
+        m_url = std::move(m_string);
+        m_string.clear();
+        m_has_url = true;
+    }
+    return endValue();
+}
+
+bool UrlStreamParser::endScalar() {
+    if (m_scalar != "true" && m_scalar != "false" && m_scalar != "null" && !isNumber(m_scalar)) {
+        return false;
+    }
+    const Frame& top = m_stack.back();
+    if (top.role == Role::Root && top.key == Key::Urls && m_scalar != "null") {
+        return false;
+    }
+    return endValue();
+}
+
+bool UrlStreamParser::endValue() {
+    if (m_stack.empty()) {
+        m_result = Result::Complete;
+    } else {
+        m_stack.back().expect = Expect::Next;
+    }
+    return true;
+}
+
+bool UrlStreamParser::closeContainer(bool object) {
+    if (object && m_stack.back().role == Role::Entry) {
+        if (!m_has_url) {
+            return false;
+        }
+        m_pending_bytes += m_url.size();
+        m_urls.push_back(std::move(m_url));
+        m_url.clear();
+        m_has_url = false;
+    }
+    m_stack.pop_back();
+    return endValue();
+}
+
+bool UrlStreamParser::appendCodePoint(uint32_t code) {
+    if (m_high_surrogate != 0) {
+        if (code < 0xDC00 || code > 0xDFFF) {
+            return false;
+        }
+        code = 0x10000 + ((m_high_surrogate - 0xD800) << 10) + (code - 0xDC00);
+        m_high_surrogate = 0;
+    } else if (code >= 0xD800 && code <= 0xDBFF) {
+        m_high_surrogate = code;
+        return true;
+    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+        return false;
+    }
+    if (!m_capture) {
+        return true;
+    }
+    if (code < 0x80) {
+        m_string += static_cast<char>(code);
+    } else if (code < 0x800) {
+        m_string += static_cast<char>(0xC0 | (code >> 6));
+        m_string += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        m_string += static_cast<char>(0xE0 | (code >> 12));
+        m_string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        m_string += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        m_string += static_cast<char>(0xF0 | (code >> 18));
+        m_string += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        m_string += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        m_string += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    return true;
+}
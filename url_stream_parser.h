@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Incremental scanner of a /check_urls body, {"urls": [{"url": "..."}, ...]}.
+// The body is fed in pieces as they arrive, split anywhere, and each URL can
+// be taken as soon as its object is closed; nothing but the URLs not taken
+// yet and the state of the open containers is kept. The rest of the
+// document is validated as JSON and skipped.
+class UrlStreamParser {
+   public:
+    enum class Result {
+        Incomplete,
+        // The root object is closed; only whitespace may follow.
+        Complete,
+        Bad,
+    };
+
+    Result feed(std::string_view data);
+    [[nodiscard]] Result result() const { return m_result; }
+
+    // URLs scanned and not taken yet, and their total length.
+    [[nodiscard]] size_t pending() const { return m_urls.size(); }
+    [[nodiscard]] size_t pendingBytes() const { return m_pending_bytes; }
+    // Takes up to limit of the pending URLs, oldest first (0 - all).
+    std::vector<std::string> take(size_t limit = 0);
+
+   private:
+    // What a container is to the document.
+    enum class Role : uint8_t { Root, Urls, Entry, Other };
+    // Key of the member being read, among the ones that matter.
+    enum class Key : uint8_t { Other, Urls, Url };
+    enum class Expect : uint8_t { FirstKey, Key, Colon, FirstValue, Value, Next };
+    enum class Lexer : uint8_t { Between, String, Escape, Unicode, Scalar };
+
+    struct Frame {
+        bool object;
+        Role role;
+        Expect expect;
+        Key key = Key::Other;
+    };
+
+    bool step(char c);
+    bool beginValue(char c);
+    bool endString();
+    bool endScalar();
+    bool endValue();
+    bool closeContainer(bool object);
+    bool appendCodePoint(uint32_t code);
+
+    Result m_result = Result::Incomplete;
+    std::vector<Frame> m_stack;
+    Lexer m_lexer = Lexer::Between;
+    // The string being read is kept only when it is a key of the root or
+    // of an entry, or the URL of an entry.
+    bool m_capture = false;
+    bool m_is_key = false;
+    std::string m_string;
+    std::string m_scalar;
+    uint32_t m_code = 0;
+    int m_hex_digits = 0;
+    // High half of a surrogate pair waiting for its low half.
+    uint32_t m_high_surrogate = 0;
+
+    std::string m_url;
+    bool m_has_url = false;
+    std::vector<std::string> m_urls;
+    size_t m_pending_bytes = 0;
+};